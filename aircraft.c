@@ -11,113 +11,291 @@ static inline uint32_t aircraftHash(uint32_t addr) {
     return addrHash(addr, AIRCRAFT_HASH_BITS);
 }
 
+// aircraft index: open addressing table of (addr, pointer) pairs containing every aircraft
+// in the Modes.aircraft hash chains
+//
+// slots are grouped by 16, the 16 addresses of a group are one cache line and are compared
+// at once (SSE2 / NEON), a lookup usually touches that cache line and the one holding the
+// pointer, the hash chains are never walked unless the index is frozen (see below)
+//
+// removal only marks the slot as deleted, this way freeAircraft() can run concurrently
+// for different aircraft (trackRemoveStale), slots are reused by inserts and the
+// deleted markers are cleared when the index is rebuilt in aircraftIndexMaintain()
+//
+// lookups happen in other threads (json / api) while the decode thread inserts:
+// a resized table is filled completely before it's published, the old table is only freed
+// by aircraftIndexMaintain() which is called while all other threads are locked (trackRemoveStale)
+//
+// while aircraft are created by several threads (tracking shards, loading state),
+// the index isn't modified and lookups that miss fall back to the hash chains,
+// the aircraft created meanwhile are added afterwards (aircraftIndexAdd / aircraftIndexRebuild)
+
 #define EMPTY 0xFFFFFFFF
-#define quickMinBits 8
-#define quickMaxBits 16
-#define quickStride 8
-static int quickBits;
-static int quickBuckets;
-static int quickSize;
-
-struct ap {
-    uint32_t addr;
-    struct aircraft *ptr;
+#define DELETED 0xFFFFFFFE
+#define indexGroupSlots 16
+#define indexMinBits 4 // 256 slots
+
+struct indexGroup {
+    uint32_t addr[indexGroupSlots];
+    struct aircraft *ptr[indexGroupSlots];
+} __attribute__((aligned(64)));
+
+struct indexTable {
+    int bits;
+    uint32_t mask; // number of groups - 1
+    int64_t slots;
+    int64_t used; // slots not EMPTY, includes DELETED
+    struct indexTable *retiredNext;
+    struct indexGroup groups[];
 };
 
-static struct ap *quick;
+static struct {
+    struct indexTable *table;
+    struct indexTable *retired; // replaced tables, other threads might still be reading them
+    int frozen;
+} aIndex;
+
+// bit i set: addr[i] == value
+#if defined(__SSE2__)
+#include <emmintrin.h>
+static inline uint32_t groupMatch(const struct indexGroup *g, uint32_t value) {
+    const __m128i v = _mm_set1_epi32(value);
+    const __m128i *p = (const __m128i *) g->addr;
+    uint32_t m0 = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_load_si128(p + 0), v)));
+    uint32_t m1 = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_load_si128(p + 1), v)));
+    uint32_t m2 = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_load_si128(p + 2), v)));
+    uint32_t m3 = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_load_si128(p + 3), v)));
+    return m0 | (m1 << 4) | (m2 << 8) | (m3 << 12);
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+static inline uint32_t groupMatch(const struct indexGroup *g, uint32_t value) {
+    static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    const uint32x4_t v = vdupq_n_u32(value);
+    // narrow the 32 bit compare results to one byte per slot and sum up the slot weights
+    uint16x8_t lo = vcombine_u16(vmovn_u32(vceqq_u32(vld1q_u32(g->addr + 0), v)), vmovn_u32(vceqq_u32(vld1q_u32(g->addr + 4), v)));
+    uint16x8_t hi = vcombine_u16(vmovn_u32(vceqq_u32(vld1q_u32(g->addr + 8), v)), vmovn_u32(vceqq_u32(vld1q_u32(g->addr + 12), v)));
+    uint8x16_t eq = vandq_u8(vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)), vld1q_u8(weights));
+    return vaddv_u8(vget_low_u8(eq)) | ((uint32_t) vaddv_u8(vget_high_u8(eq)) << 8);
+}
+#else
+static inline uint32_t groupMatch(const struct indexGroup *g, uint32_t value) {
+    uint32_t mask = 0;
+    for (int i = 0; i < indexGroupSlots; i++) {
+        mask |= (uint32_t) (g->addr[i] == value) << i;
+    }
+    return mask;
+}
+#endif
 
-static void quickResize(int bits) {
-    quickBits = bits;
-    quickBuckets = (1LL << bits) + quickStride;
-    quickSize = sizeof(struct ap) * quickBuckets;
+static struct aircraft *indexGet(uint32_t addr) {
+    struct indexTable *t = __atomic_load_n(&aIndex.table, __ATOMIC_ACQUIRE);
+    if (!t)
+        return NULL;
+    uint32_t g = addrHash(addr, t->bits);
+    for (uint32_t probe = 0; probe <= t->mask; probe++) {
+        struct indexGroup *group = &t->groups[(g + probe) & t->mask];
+        uint32_t match = groupMatch(group, addr);
+        if (match) {
+            // pairs with the release store of the address in indexInsert
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            return group->ptr[__builtin_ctz(match)];
+        }
+        // an EMPTY slot ends the probe sequence
+        if (groupMatch(group, EMPTY)) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
 
-    if (quickBuckets > 256000)
-        fprintf(stderr, "quickLookup: changing size to %d!\n", (int) quickBuckets);
+// the caller makes sure addr isn't in the table yet
+static void indexInsert(struct indexTable *t, struct aircraft *a) {
+    uint32_t g = addrHash(a->addr, t->bits);
+    for (uint32_t probe = 0; probe <= t->mask; probe++) {
+        struct indexGroup *group = &t->groups[(g + probe) & t->mask];
+        uint32_t avail = groupMatch(group, EMPTY) | groupMatch(group, DELETED);
+        if (avail) {
+            int slot = __builtin_ctz(avail);
+            if (group->addr[slot] == EMPTY)
+                t->used++;
+            // pointer first, a concurrent lookup matching the address must see it
+            group->ptr[slot] = a;
+            __atomic_store_n(&group->addr[slot], a->addr, __ATOMIC_RELEASE);
+            return;
+        }
+    }
+    fprintf(stderr, "FATAL: aircraft index full, this shouldn't happen!\n");
+    abort();
+}
+
+// empty table with room for at least count aircraft at less than half fill
+static struct indexTable *indexAlloc(int64_t count) {
+    int bits = indexMinBits;
+    while (((int64_t) indexGroupSlots << bits) < 2 * count)
+        bits++;
+
+    size_t bytes = sizeof(struct indexTable) + (sizeof(struct indexGroup) << bits);
+    struct indexTable *t = aligned_alloc(64, bytes);
+    if (!t) {
+        fprintf(stderr, "FATAL: out of memory allocating the aircraft index!\n");
+        abort();
+    }
+    memset(t, 0x0, sizeof(struct indexTable));
+    memset(t->groups, 0xFF, sizeof(struct indexGroup) << bits);
+    t->bits = bits;
+    t->mask = (1u << bits) - 1;
+    t->slots = (int64_t) indexGroupSlots << bits;
+    t->used = 0;
+    return t;
+}
 
-    sfree(quick);
-    quick = cmalloc(quickSize);
-    memset(quick, 0xFF, quickSize);
+// publish a completely filled table, the old one is freed by aircraftIndexMaintain()
+static void indexPublish(struct indexTable *t) {
+    struct indexTable *old = aIndex.table;
+    __atomic_store_n(&aIndex.table, t, __ATOMIC_RELEASE);
+    if (old) {
+        old->retiredNext = aIndex.retired;
+        aIndex.retired = old;
+    }
 }
 
-static struct ap *quickGet(uint32_t addr) {
-    uint32_t hash = addrHash(addr, quickBits);
-    for (unsigned i = 0; i < quickStride; i++) {
-        struct ap *q = &(quick[hash + i]);
-        if (q->addr == addr) {
-            return q;
+static void indexResize(int64_t count) {
+    struct indexTable *old = aIndex.table;
+    struct indexTable *t = indexAlloc(count);
+
+    if (old) {
+        for (int64_t k = 0; k <= old->mask; k++) {
+            struct indexGroup *group = &old->groups[k];
+            for (int i = 0; i < indexGroupSlots; i++) {
+                if (group->addr[i] != EMPTY && group->addr[i] != DELETED)
+                    indexInsert(t, group->ptr[i]);
+            }
         }
     }
-    return NULL;
+    indexPublish(t);
+}
+
+static int64_t indexCountLive() {
+    struct indexTable *t = aIndex.table;
+    int64_t live = 0;
+    for (int64_t k = 0; k <= t->mask; k++) {
+        struct indexGroup *group = &t->groups[k];
+        live += indexGroupSlots - __builtin_popcount(groupMatch(group, EMPTY) | groupMatch(group, DELETED));
+    }
+    return live;
 }
-void quickRemove(struct aircraft *a) {
-    struct ap *q = quickGet(a->addr);
-    if (q) {
-        q->addr = EMPTY;
-        q->ptr = NULL;
+
+static void indexAddNew(struct aircraft *a) {
+    // keep at least one EMPTY slot in most groups so misses end quickly
+    if (4 * (aIndex.table->used + 1) > 3 * aIndex.table->slots) {
+        indexResize(indexCountLive() + 1);
     }
-    //fprintf(stderr, "r: %06x\n", a->addr);
+    indexInsert(aIndex.table, a);
 }
-void quickAdd(struct aircraft *a) {
-    struct ap *q = quickGet(a->addr);
-    if (q)
+
+static void indexFreeRetired() {
+    while (aIndex.retired) {
+        struct indexTable *next = aIndex.retired->retiredNext;
+        free(aIndex.retired);
+        aIndex.retired = next;
+    }
+}
+
+// resize to the live aircraft count and clear the DELETED markers, called periodically
+// no other thread may be looking up aircraft (modesInit / trackRemoveStale)
+void aircraftIndexMaintain() {
+    indexFreeRetired();
+    struct indexTable *t = aIndex.table;
+    if (!t) {
+        indexResize(0);
         return;
+    }
+    int64_t live = indexCountLive();
+    int grow = 4 * t->used > 3 * t->slots;
+    int shrink = t->bits > indexMinBits && 8 * live < t->slots;
+    int purge = 4 * (t->used - live) > t->slots;
+    if (grow || shrink || purge) {
+        indexResize(live);
+        indexFreeRetired();
+    }
+}
 
-    uint32_t hash = addrHash(a->addr, quickBits);
+void aircraftIndexDestroy() {
+    indexFreeRetired();
+    free(aIndex.table);
+    memset(&aIndex, 0, sizeof(aIndex));
+}
+
+void aircraftIndexAdd(struct aircraft *a) {
+    if (!indexGet(a->addr))
+        indexAddNew(a);
+}
 
-    for (unsigned i = 0; i < quickStride; i++) {
-        q = &quick[hash + i];
-        if (q->addr == EMPTY) {
-            q->addr = a->addr;
-            q->ptr = a;
+void aircraftIndexRemove(struct aircraft *a) {
+    struct indexTable *t = aIndex.table;
+    if (!t)
+        return;
+    uint32_t g = addrHash(a->addr, t->bits);
+    for (uint32_t probe = 0; probe <= t->mask; probe++) {
+        struct indexGroup *group = &t->groups[(g + probe) & t->mask];
+        uint32_t match = groupMatch(group, a->addr);
+        if (match) {
+            int slot = __builtin_ctz(match);
+            group->addr[slot] = DELETED;
+            group->ptr[slot] = NULL;
+            return;
+        }
+        if (groupMatch(group, EMPTY)) {
             return;
         }
     }
 }
 
-void quickInit() {
-    if (quickBits > quickMinBits && Modes.aircraftActive.len < quickBuckets / 9) {
-        quickResize(quickBits - 1);
-    } else if (quickBits < quickMinBits) {
-        quickResize(quickMinBits);
-    } else if (quickBits < quickMaxBits && Modes.aircraftActive.len > quickBuckets / 3) {
-        quickResize(quickBits + 1);
-    }
+// aircraft will be created by several threads, don't touch the index until aircraftIndexRebuild()
+void aircraftIndexFreeze() {
+    aIndex.frozen = 1;
+}
 
-    /*
-    for (int i = 0; i < quickBuckets; i++) {
-        if (quick[i].addr == EMPTY)
-            fprintf(stderr, " ");
-        else
-            fprintf(stderr, ".");
+// rebuild the index from the hash chains
+void aircraftIndexRebuild() {
+    int64_t count = 0;
+    for (int j = 0; j < AIRCRAFT_BUCKETS; j++) {
+        for (struct aircraft *a = Modes.aircraft[j]; a; a = a->next) {
+            count++;
+        }
     }
-    fprintf(stderr, "\n");
-    */
-}
-void quickDestroy() {
-    sfree(quick);
+    struct indexTable *t = indexAlloc(count);
+    for (int j = 0; j < AIRCRAFT_BUCKETS; j++) {
+        for (struct aircraft *a = Modes.aircraft[j]; a; a = a->next) {
+            indexInsert(t, a);
+        }
+    }
+    indexPublish(t);
+    aIndex.frozen = 0;
 }
 
+static inline int indexFrozen() {
+    return aIndex.frozen || Modes.trackShardsRunning;
+}
 
 struct aircraft *aircraftGet(uint32_t addr) {
 
-    struct ap *q = quickGet(addr);
-    if (q) {
-        return q->ptr;
+    struct aircraft *a = indexGet(addr);
+    if (a || !indexFrozen()) {
+        return a;
     }
 
-    struct aircraft *a = Modes.aircraft[aircraftHash(addr)];
-
+    // aircraft created by other threads while frozen are only in the hash chains
+    a = Modes.aircraft[aircraftHash(addr)];
     while (a && a->addr != addr) {
         a = a->next;
     }
-    if (a) {
-        quickAdd(a);
-    }
     return a;
 }
 
 void freeAircraft(struct aircraft *a) {
-    quickRemove(a);
+    aircraftIndexRemove(a);
 
     // remove from the globeList
     set_globe_index(a, -5);
@@ -128,24 +306,22 @@ void freeAircraft(struct aircraft *a) {
     traceCleanup(a);
 
     memset(a, 0xff, sizeof (struct aircraft));
-    free(a);
+    aircraftFree(a);
 }
 
 void aircraftZeroTail(struct aircraft *a) {
     memset(&a->zeroStart, 0x0, &a->zeroEnd - &a->zeroStart);
 }
 
-struct aircraft *aircraftCreate(uint32_t addr) {
-    struct aircraft *a = aircraftGet(addr);
-    if (a) {
-        return a;
-    }
-    a = cmalloc(sizeof(struct aircraft));
+// reset everything but the hash chain link to the values of a new aircraft
+void aircraftDefaults(struct aircraft *a, uint32_t addr) {
+    struct aircraft *next = a->next;
 
     // Default everything to zero/NULL
     memset(a, 0, sizeof (struct aircraft));
 
     // Now initialise things that should not be 0/NULL to their defaults
+    a->next = next;
     a->addr = addr;
     a->addrtype = ADDR_UNKNOWN;
 
@@ -158,16 +334,30 @@ struct aircraft *aircraftCreate(uint32_t addr) {
         a->globe_index = -5;
     }
 
+    updateTypeReg(a);
+}
+
+struct aircraft *aircraftCreate(uint32_t addr) {
+    struct aircraft *a = aircraftGet(addr);
+    if (a) {
+        return a;
+    }
+    a = aircraftAlloc();
+
+    aircraftDefaults(a, addr);
+
     // initialize data validity ages
     //adjustExpire(a, 58);
-    Modes.stats_current.unique_aircraft++;
-
-    updateTypeReg(a);
+    STATS_CURRENT->unique_aircraft++;
 
     uint32_t hash = aircraftHash(addr);
     a->next = Modes.aircraft[hash];
     Modes.aircraft[hash] = a;
 
+    if (!indexFrozen()) {
+        indexAddNew(a);
+    }
+
     return a;
 }
 
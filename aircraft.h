@@ -26,13 +26,16 @@ static inline uint32_t addrHash(uint32_t addr, uint32_t bits) {
     return (uint32_t) res;
 }
 
-void quickInit();
-void quickDestroy();
-void quickAdd(struct aircraft *a);
-void quickRemove(struct aircraft *a);
+void aircraftIndexMaintain();
+void aircraftIndexDestroy();
+void aircraftIndexAdd(struct aircraft *a);
+void aircraftIndexRemove(struct aircraft *a);
+void aircraftIndexFreeze();
+void aircraftIndexRebuild();
 
 void aircraftZeroTail(struct aircraft *a);
 struct aircraft *aircraftGet(uint32_t addr);
+void aircraftDefaults(struct aircraft *a, uint32_t addr);
 struct aircraft *aircraftCreate(uint32_t addr);
 void freeAircraft(struct aircraft *a);
 
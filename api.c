@@ -3,7 +3,23 @@
 #define API_HASH_BITS (16)
 #define API_BUCKETS (1 << API_HASH_BITS)
 
+// 1 degree grid cells for box / circle queries
+#define API_GRID_RES (1000000)
+#define API_GRID_ROWS (180)
+#define API_GRID_COLS (360)
+#define API_GRID_CELLS (API_GRID_ROWS * API_GRID_COLS)
+
+// --api-update-threads: minimum number of aircraft per part
+#define API_UPDATE_MIN_PART (1024)
+
+// posting list buckets for type / squawk / dbFlags filters
+#define API_TYPE_BUCKETS (1024)
+#define API_SQUAWK_BUCKETS (4096) // one per squawk
+#define API_FLAG_BUCKETS (4) // mil, interesting, pia, ladd
+
 static int apiUpdate();
+static void apiStreamSend(struct apiCon *con, struct apiThread *thread);
+static void apiProcessRequests(struct apiCon *con, struct apiThread *thread);
 static inline uint32_t hexHash(uint32_t addr) {
     return addrHash(addr, API_HASH_BITS);
 }
@@ -54,6 +70,74 @@ static int antiSpam(int64_t *nextPrint, int64_t interval) {
     }
 }
 
+static const char *apiQueryTypeNames[API_QUERY_TYPES] = {
+    [API_QUERY_BOX] = "box",
+    [API_QUERY_CIRCLE] = "circle",
+    [API_QUERY_CLOSEST] = "closest",
+    [API_QUERY_HEXLIST] = "hexList",
+    [API_QUERY_REGLIST] = "regList",
+    [API_QUERY_CALLSIGN] = "callsign",
+    [API_QUERY_TYPELIST] = "typeList",
+    [API_QUERY_ALL] = "all",
+};
+
+const char *apiQueryTypeName(int type) {
+    return apiQueryTypeNames[type];
+}
+
+static int apiQueryType(struct apiOptions *options) {
+    if (options->is_box)
+        return API_QUERY_BOX;
+    if (options->is_circle)
+        return options->closest ? API_QUERY_CLOSEST : API_QUERY_CIRCLE;
+    if (options->is_hexList)
+        return API_QUERY_HEXLIST;
+    if (options->is_regList)
+        return API_QUERY_REGLIST;
+    if (options->is_callsignList)
+        return API_QUERY_CALLSIGN;
+    if (options->is_typeList)
+        return API_QUERY_TYPELIST;
+    return API_QUERY_ALL;
+}
+
+// log-linear buckets: values below 4 us get their own bucket,
+// above that every doubling is split into 4 buckets (max. 25% relative error)
+static int apiLatencyBucket(int64_t micro) {
+    if (micro < 4)
+        return micro < 0 ? 0 : micro;
+    int msb = 63 - __builtin_clzll(micro);
+    int bucket = (msb - 1) * 4 + ((micro >> (msb - 2)) & 3);
+    return (int) imin(bucket, API_LATENCY_BUCKETS - 1);
+}
+
+int64_t apiLatencyBucketMax(int bucket) {
+    if (bucket < 4)
+        return bucket;
+    int shift = bucket / 4 - 1;
+    return ((int64_t) (4 + bucket % 4 + 1) << shift) - 1;
+}
+
+static void apiRecordLatency(struct apiThread *thread, struct apiOptions *options, char *url, int urlLen) {
+    int64_t elapsed = microtime() - options->request_received;
+    int type = apiQueryType(options);
+    thread->latency[type][apiLatencyBucket(elapsed)]++;
+
+    if (Modes.apiSlowQuery && elapsed > Modes.apiSlowQuery) {
+        if (antiSpam(&thread->antiSpam[9], 5 * SECONDS)) {
+            fprintf(stderr, "API slow query: %.1f ms (%s) %.*s",
+                    elapsed / 1000.0, apiQueryTypeName(type), urlLen, url);
+            if (thread->slowQueries) {
+                fprintf(stderr, " (%u more slow queries not shown)", thread->slowQueries);
+            }
+            fprintf(stderr, "\n");
+            thread->slowQueries = 0;
+        } else {
+            thread->slowQueries++;
+        }
+    }
+}
+
 static int compareLon(const void *p1, const void *p2) {
     struct apiEntry *a1 = (struct apiEntry*) p1;
     struct apiEntry *a2 = (struct apiEntry*) p2;
@@ -111,17 +195,22 @@ static struct range findLonRange(int32_t ref_from, int32_t ref_to, struct apiEnt
     return res;
 }
 
+// INT32_MIN: no altitude
+static inline int32_t entryAltBaro(struct apiEntry *e) {
+    float reverse_alt_factor = 1.0f / BINCRAFT_ALT_FACTOR;
+    if (e->bin.baro_alt_valid) {
+        return e->bin.baro_alt * reverse_alt_factor;
+    } else if (e->bin.airground == AG_GROUND) {
+        return 0;
+    }
+    return INT32_MIN;
+}
+
 static int filter_alt_baro(struct apiEntry *haystack, int haylen, struct apiEntry *matches, size_t *alloc, struct apiOptions *options) {
     int count = 0;
-    float reverse_alt_factor = 1.0f / BINCRAFT_ALT_FACTOR;
     for (int i = 0; i < haylen; i++) {
         struct apiEntry *e = &haystack[i];
-        int32_t alt = INT32_MIN;
-        if (e->bin.baro_alt_valid) {
-            alt = e->bin.baro_alt * reverse_alt_factor;
-        } else if (e->bin.airground == AG_GROUND) {
-            alt = 0;
-        }
+        int32_t alt = entryAltBaro(e);
         if (alt >= options->above_alt_baro && alt <= options->below_alt_baro && alt != INT32_MIN) {
             matches[count++] = *e;
             *alloc += e->jsonOffset.len;
@@ -233,10 +322,189 @@ static int inLatRange(struct apiEntry *e, int32_t lat1, int32_t lat2, struct api
     return (e->bin.lat >= lat1 && e->bin.lat <= lat2 && (e->bin.position_valid || options->binCraft));
 }
 
-static int findInBox(struct apiEntry *haystack, int haylen, struct apiOptions *options, struct apiEntry *matches, size_t *alloc) {
+// lon1 > lon2 wraps around the antimeridian
+static inline int inLonRange(struct apiEntry *e, int32_t lon1, int32_t lon2) {
+    if (lon1 <= lon2) {
+        return (e->bin.lon >= lon1 && e->bin.lon <= lon2);
+    } else {
+        return (e->bin.lon >= lon1 || e->bin.lon <= lon2);
+    }
+}
+
+static inline int gridRow(int32_t lat) {
+    return imin(API_GRID_ROWS - 1, imax(0, (lat + 90 * API_GRID_RES) / API_GRID_RES));
+}
+
+static inline int gridCol(int32_t lon) {
+    return imin(API_GRID_COLS - 1, imax(0, (lon + 180 * API_GRID_RES) / API_GRID_RES));
+}
+
+static inline int gridCell(struct apiEntry *e) {
+    if (e->bin.lat < -90 * API_GRID_RES || e->bin.lat > 90 * API_GRID_RES
+            || e->bin.lon < -180 * API_GRID_RES || e->bin.lon > 180 * API_GRID_RES) {
+        return -1;
+    }
+    return gridRow(e->bin.lat) * API_GRID_COLS + gridCol(e->bin.lon);
+}
+
+static void gridBuild(struct apiGrid *grid, struct apiEntry *list, int len) {
+    int32_t *start = grid->cellStart;
+    memset(start, 0x0, (API_GRID_CELLS + 1) * sizeof(int32_t));
+
+    // counting sort, the list is longitude sorted and stays that way within each cell
+    for (int i = 0; i < len; i++) {
+        int cell = gridCell(&list[i]);
+        if (cell >= 0) {
+            start[cell + 1]++;
+        }
+    }
+    for (int cell = 0; cell < API_GRID_CELLS; cell++) {
+        start[cell + 1] += start[cell];
+    }
+    for (int i = 0; i < len; i++) {
+        int cell = gridCell(&list[i]);
+        if (cell >= 0) {
+            grid->entries[start[cell]++] = i;
+        }
+    }
+    // start[cell] now points to the end of the cell, shift back
+    memmove(start + 1, start, API_GRID_CELLS * sizeof(int32_t));
+    start[0] = 0;
+}
+
+// only the bytes up to the NUL are hashed, like filterTypeList() compares them (strncmp)
+// type codes shorter than 4 characters can have leftover bytes after the NUL
+static inline int typeBucket(const char *typeCode) {
+    return fasthash64(typeCode, strnlen(typeCode, 4), 0x6a09e667f3bcc909ULL) & (API_TYPE_BUCKETS - 1);
+}
+
+// squawks are 4 octal digits stored one per nibble
+static inline int squawkBucket(unsigned squawk) {
+    return ((squawk >> 3) & 07000) | ((squawk >> 2) & 0700) | ((squawk >> 1) & 070) | (squawk & 07);
+}
+
+static int typeKeys(struct apiEntry *e, int *buckets) {
+    buckets[0] = typeBucket(e->bin.typeCode);
+    return 1;
+}
+
+static int squawkKeys(struct apiEntry *e, int *buckets) {
+    if (!e->bin.squawk_valid) {
+        return 0;
+    }
+    buckets[0] = squawkBucket(e->bin.squawk);
+    return 1;
+}
+
+static int flagKeys(struct apiEntry *e, int *buckets) {
+    int n = 0;
+    for (int bit = 0; bit < API_FLAG_BUCKETS; bit++) {
+        if (e->bin.dbFlags & (1 << bit)) {
+            buckets[n++] = bit;
+        }
+    }
+    return n;
+}
+
+static int globeKeys(struct apiEntry *e, int *buckets) {
+    if (e->globe_index < 0 || e->globe_index > GLOBE_MAX_INDEX) {
+        return 0;
+    }
+    buckets[0] = e->globe_index;
+    return 1;
+}
+
+// counting sort like gridBuild, keys returns the buckets an entry belongs to (at most API_FLAG_BUCKETS)
+static void indexBuild(struct apiIndex *index, int bucketCount, struct apiEntry *list, int len, int (*keys)(struct apiEntry *, int *)) {
+    int32_t *start = index->start;
+    int buckets[API_FLAG_BUCKETS];
+    memset(start, 0x0, (bucketCount + 1) * sizeof(int32_t));
+
+    for (int i = 0; i < len; i++) {
+        int n = keys(&list[i], buckets);
+        for (int k = 0; k < n; k++) {
+            start[buckets[k] + 1]++;
+        }
+    }
+    for (int b = 0; b < bucketCount; b++) {
+        start[b + 1] += start[b];
+    }
+    for (int i = 0; i < len; i++) {
+        int n = keys(&list[i], buckets);
+        for (int k = 0; k < n; k++) {
+            index->entries[start[buckets[k]]++] = i;
+        }
+    }
+    memmove(start + 1, start, bucketCount * sizeof(int32_t));
+    start[0] = 0;
+}
+
+static int compareAlt(const void *p1, const void *p2) {
+    const struct apiAltEntry *a1 = p1;
+    const struct apiAltEntry *a2 = p2;
+    if (a1->alt != a2->alt) {
+        return (a1->alt > a2->alt) - (a1->alt < a2->alt);
+    }
+    return (a1->index > a2->index) - (a1->index < a2->index);
+}
+
+static void altBuild(struct apiBuffer *buffer) {
+    int n = 0;
+    for (int i = 0; i < buffer->len; i++) {
+        int32_t alt = entryAltBaro(&buffer->list[i]);
+        if (alt != INT32_MIN) {
+            buffer->altSorted[n++] = (struct apiAltEntry) { alt, i };
+        }
+    }
+    qsort(buffer->altSorted, n, sizeof(struct apiAltEntry), compareAlt);
+    buffer->altLen = n;
+}
+
+// first entry of altSorted with alt >= value
+static int altLowerBound(struct apiBuffer *buffer, int64_t value) {
+    int lo = 0;
+    int hi = buffer->altLen;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (buffer->altSorted[mid].alt < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// ranges of grid->entries for all cells overlapping the box, at most 2 per row
+static int gridRanges(struct apiGrid *grid, int32_t lat1, int32_t lat2, int32_t lon1, int32_t lon2, struct range *ranges) {
+    int count = 0;
+    if (lat1 > lat2) {
+        return 0;
+    }
+    int row1 = gridRow(lat1);
+    int row2 = gridRow(lat2);
+    int col1 = gridCol(lon1);
+    int col2 = gridCol(lon2);
+    for (int row = row1; row <= row2; row++) {
+        int32_t *rowStart = grid->cellStart + row * API_GRID_COLS;
+        if (lon1 <= lon2) {
+            ranges[count++] = (struct range) { rowStart[col1], rowStart[col2 + 1] };
+        } else if (col1 <= col2) {
+            // crossing the antimeridian with both ends in the same column,
+            // the box covers every column of the row, scan it once
+            ranges[count++] = (struct range) { rowStart[0], rowStart[API_GRID_COLS] };
+        } else {
+            // crossing the antimeridian
+            ranges[count++] = (struct range) { rowStart[col1], rowStart[API_GRID_COLS] };
+            ranges[count++] = (struct range) { rowStart[0], rowStart[col2 + 1] };
+        }
+    }
+    return count;
+}
+
+static int findInBox(struct apiEntry *haystack, struct apiGrid *grid, struct apiOptions *options, struct apiEntry *matches, size_t *alloc) {
     double *box = options->box;
-    struct range r[2];
-    memset(r, 0, sizeof(r));
+    struct range r[2 * API_GRID_ROWS];
     int count = 0;
 
 
@@ -245,17 +513,11 @@ static int findInBox(struct apiEntry *haystack, int haylen, struct apiOptions *o
     int32_t lon1 = (int32_t) (box[2] * 1E6);
     int32_t lon2 = (int32_t) (box[3] * 1E6);
 
-    if (lon1 <= lon2) {
-        r[0] = findLonRange(lon1, lon2, haystack, haylen);
-    } else if (lon1 > lon2) {
-        r[0] = findLonRange(lon1, 180E6, haystack, haylen);
-        r[1] = findLonRange(-180E6, lon2, haystack, haylen);
-        //fprintf(stderr, "%.1f to 180 and -180 to %1.f\n", lon1 / 1E6, lon2 / 1E6);
-    }
-    for (int k = 0; k < 2; k++) {
+    int rangeCount = gridRanges(grid, lat1, lat2, lon1, lon2, r);
+    for (int k = 0; k < rangeCount; k++) {
         for (int j = r[k].from; j < r[k].to; j++) {
-            struct apiEntry *e = &haystack[j];
-            if (inLatRange(e, lat1, lat2, options)) {
+            struct apiEntry *e = &haystack[grid->entries[j]];
+            if (inLatRange(e, lat1, lat2, options) && inLonRange(e, lon1, lon2)) {
                 matches[count++] = *e;
                 *alloc += e->jsonOffset.len;
             }
@@ -264,6 +526,7 @@ static int findInBox(struct apiEntry *haystack, int haylen, struct apiOptions *o
     //fprintf(stderr, "box: lat %.1f to %.1f, lon %.1f to %.1f, count: %d\n", box[0], box[1], box[2], box[3], count);
     return count;
 }
+
 static int findRegList(struct apiEntry **hashList, char *regList, int regCount, struct apiEntry *matches, size_t *alloc) {
     int count = 0;
     for (int k = 0; k < regCount; k++) {
@@ -329,10 +592,9 @@ static int findHexList(struct apiEntry **hashList, uint32_t *hexList, int hexCou
     }
     return count;
 }
-static int findInCircle(struct apiEntry *haystack, int haylen, struct apiOptions *options, struct apiEntry *matches, size_t *alloc) {
+static int findInCircle(struct apiEntry *haystack, struct apiGrid *grid, struct apiOptions *options, struct apiEntry *matches, size_t *alloc) {
     struct apiCircle *circle = &options->circle;
-    struct range r[2];
-    memset(r, 0, sizeof(r));
+    struct range r[2 * API_GRID_ROWS];
     int count = 0;
     double lat = circle->lat;
     double lon = circle->lon;
@@ -368,20 +630,14 @@ static int findInCircle(struct apiEntry *haystack, int haylen, struct apiOptions
     int32_t lon2 = (int32_t) (o2 * 1E6);
 
     //fprintf(stderr, "radius:%8.0f latdiff: %8.0f londiff: %8.0f\n", radius, greatcircle(a1, lon, lat, lon), greatcircle(lat, o1, lat, lon, 0));
-    if (lon1 <= lon2) {
-        r[0] = findLonRange(lon1, lon2, haystack, haylen);
-    } else if (lon1 > lon2) {
-        r[0] = findLonRange(lon1, 180E6, haystack, haylen);
-        r[1] = findLonRange(-180E6, lon2, haystack, haylen);
-        //fprintf(stderr, "%.1f to 180 and -180 to %1.f\n", lon1 / 1E6, lon2 / 1E6);
-    }
+    int rangeCount = gridRanges(grid, lat1, lat2, lon1, lon2, r);
     if (onlyClosest) {
         bool found = false;
         double minDistance = 300E6; // larger than any distances we encounter, also how far light travels in a second
-        for (int k = 0; k < 2; k++) {
+        for (int k = 0; k < rangeCount; k++) {
             for (int j = r[k].from; j < r[k].to; j++) {
-                struct apiEntry *e = &haystack[j];
-                if (inLatRange(e, lat1, lat2, options)) {
+                struct apiEntry *e = &haystack[grid->entries[j]];
+                if (inLatRange(e, lat1, lat2, options) && inLonRange(e, lon1, lon2)) {
                     double dist = greatcircle(lat, lon, e->bin.lat / 1E6, e->bin.lon / 1E6, 0);
                     if (dist < radius && dist < minDistance) {
                         // first match is overwritten repeatedly
@@ -402,10 +658,10 @@ static int findInCircle(struct apiEntry *haystack, int haylen, struct apiOptions
         }
     }
     if (!onlyClosest) {
-        for (int k = 0; k < 2; k++) {
+        for (int k = 0; k < rangeCount; k++) {
             for (int j = r[k].from; j < r[k].to; j++) {
-                struct apiEntry *e = &haystack[j];
-                if (inLatRange(e, lat1, lat2, options)) {
+                struct apiEntry *e = &haystack[grid->entries[j]];
+                if (inLatRange(e, lat1, lat2, options) && inLonRange(e, lon1, lon2)) {
                     double dist = greatcircle(lat, lon, e->bin.lat / 1E6, e->bin.lon / 1E6, 0);
                     if (dist < radius) {
                         matches[count] = *e;
@@ -432,18 +688,485 @@ static struct apiEntry *apiAlloc(int count) {
     return buf;
 }
 
-static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *options) {
+static int compareStrings(const void *p1, const void *p2) {
+    return strcmp(*(char **) p1, *(char **) p2);
+}
 
-    int flip = atomic_load(&Modes.apiFlip[thread->index]);
+// cache key: the query parameters sorted, reordered parameters result in the same key
+// returns the key length, 0 if the query isn't cached
+static int apiCacheKey(char *query, char *eoq, char *key) {
+    int len = eoq - query;
+    // leave room for the encoding suffix added in apiReq
+    if (len <= 0 || len >= API_CACHE_KEY_MAX - 16) {
+        return 0;
+    }
+    char tmp[API_CACHE_KEY_MAX];
+    memcpy(tmp, query, len);
+    tmp[len] = '\0';
 
-    struct apiBuffer *buffer = &Modes.apiBuffer[flip];
+    char *tokens[64];
+    int count = 0;
+    char *p = tmp;
+    char *token;
+    while ((token = strsep(&p, "&"))) {
+        if (!*token) {
+            continue;
+        }
+        if (count == 64) {
+            return 0;
+        }
+        tokens[count++] = token;
+    }
+    qsort(tokens, count, sizeof(char *), compareStrings);
+
+    char *k = key;
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            *k++ = '&';
+        }
+        size_t tlen = strlen(tokens[i]);
+        memcpy(k, tokens[i], tlen);
+        k += tlen;
+    }
+    *k = '\0';
+    return k - key;
+}
+
+static void apiCacheFlush(struct apiCache *cache, int64_t timestamp) {
+    for (int i = 0; i < cache->len; i++) {
+        struct apiCacheEntry *e = &cache->entries[i];
+        sfree(e->key);
+        sfree(e->body.buffer);
+    }
+    cache->len = 0;
+    cache->bytes = 0;
+    cache->timestamp = timestamp;
+}
+
+static struct apiCacheEntry *apiCacheGet(struct apiCache *cache, int64_t timestamp, char *key, int keyLen, uint64_t hash) {
+    if (cache->timestamp != timestamp) {
+        // the cached responses are for another apiBuffer
+        return NULL;
+    }
+    for (int i = 0; i < cache->len; i++) {
+        struct apiCacheEntry *e = &cache->entries[i];
+        if (e->hash == hash && e->keyLen == keyLen && memcmp(e->key, key, keyLen) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void apiCachePut(struct apiCache *cache, int64_t timestamp, char *key, int keyLen, uint64_t hash, char *body, size_t len) {
+    if (cache->timestamp != timestamp) {
+        if (timestamp < cache->timestamp) {
+            // response for an older apiBuffer
+            return;
+        }
+        apiCacheFlush(cache, timestamp);
+    }
+    size_t budget = Modes.apiCacheSize / Modes.apiThreadCount;
+    if (cache->len == API_CACHE_ENTRIES || cache->bytes + len + keyLen > budget) {
+        return;
+    }
+    struct apiCacheEntry *e = &cache->entries[cache->len];
+    e->key = cmalloc(keyLen);
+    e->body.buffer = cmalloc(len);
+    if (!e->key || !e->body.buffer) {
+        sfree(e->key);
+        sfree(e->body.buffer);
+        return;
+    }
+    memcpy(e->key, key, keyLen);
+    memcpy(e->body.buffer, body, len);
+    e->keyLen = keyLen;
+    e->body.len = len;
+    e->hash = hash;
+    cache->bytes += len + keyLen;
+    cache->len++;
+}
+
+// response buffers are kept per api thread and reused, most responses are small
+static struct char_buffer apiPoolGet(struct apiThread *thread, size_t size) {
+    struct char_buffer cb = { 0 };
+    int best = -1;
+    for (int i = 0; i < thread->poolLen; i++) {
+        size_t alloc = thread->pool[i].alloc;
+        if (alloc >= size && (best < 0 || alloc < thread->pool[best].alloc)) {
+            best = i;
+        }
+    }
+    if (best >= 0) {
+        cb = thread->pool[best];
+        thread->pool[best] = thread->pool[--thread->poolLen];
+        cb.len = 0;
+        return cb;
+    }
+    cb.alloc = imax(size, API_POOL_MIN_ALLOC);
+    cb.buffer = cmalloc(cb.alloc);
+    if (!cb.buffer) {
+        cb.alloc = 0;
+    }
+    return cb;
+}
+
+// cb may be empty, it is cleared
+static void apiPoolPut(struct apiThread *thread, struct char_buffer *cb) {
+    if (cb->buffer && cb->alloc <= API_POOL_MAX_ALLOC && thread->poolLen < API_POOL_BUFFERS) {
+        thread->pool[thread->poolLen++] = *cb;
+    } else {
+        sfree(cb->buffer);
+    }
+    cb->buffer = NULL;
+    cb->len = 0;
+    cb->alloc = 0;
+}
+
+static void apiPoolDestroy(struct apiThread *thread) {
+    for (int i = 0; i < thread->poolLen; i++) {
+        sfree(thread->pool[i].buffer);
+    }
+    thread->poolLen = 0;
+}
+
+// queue a response on the connection, sending starts at offset start
+static void apiQueueReply(struct apiCon *con, struct apiThread *thread, struct char_buffer cb, size_t start) {
+    if (con->replyCount >= API_PIPELINE_MAX) {
+        fprintf(stderr, "apiQueueReply: too many responses queued, this shouldn't happen\n");
+        apiPoolPut(thread, &cb);
+        return;
+    }
+    struct apiReply *reply = &con->replies[con->replyCount++];
+    reply->cb = cb;
+    reply->sent = start;
+    thread->responseBytesBuffered += cb.len;
+}
+
+// first element of a binCraft response, returns the position of the first aircraft
+// dummy: unused by regular responses, stream updates put the number of removed aircraft there
+static char *apiBinCraftHeader(char *p, char *end, struct apiBuffer *buffer, struct apiOptions *options, uint32_t resultCount, int32_t dummy) {
+    uint32_t elementSize = sizeof(struct binCraft);
+    char *start = p;
+    memset(p, 0, elementSize);
+
+#define memWrite(p, var) do { if (p + sizeof(var) > end) { break; }; memcpy(p, &var, sizeof(var)); p += sizeof(var); } while(0)
+
+    int64_t now = buffer->timestamp;
+    memWrite(p, now);
+
+    memWrite(p, elementSize);
+
+    uint32_t ac_count_pos = Modes.globalStatsCount.readsb_aircraft_with_position;
+    memWrite(p, ac_count_pos);
+
+    uint32_t index = 0;
+    memWrite(p, index);
+
+    int16_t south = -90;
+    int16_t west = -180;
+    int16_t north = 90;
+    int16_t east = 180;
+    if (options->is_box) {
+        south = nearbyint(options->box[0]);
+        north = nearbyint(options->box[1]);
+        west = nearbyint(options->box[2]);
+        east = nearbyint(options->box[3]);
+    }
+
+    memWrite(p, south);
+    memWrite(p, west);
+    memWrite(p, north);
+    memWrite(p, east);
+
+    uint32_t messageCount = Modes.stats_current.messages_total + Modes.stats_alltime.messages_total;
+    memWrite(p, messageCount);
+
+    memWrite(p, resultCount);
+
+    memWrite(p, dummy);
+
+    memWrite(p, Modes.binCraftVersion);
+
+    uint32_t messageRate = nearbyint(Modes.messageRate * 10);
+    memWrite(p, messageRate);
+
+#undef memWrite
+    if (p - start > (int) elementSize) {
+        fprintf(stderr, "apiBin: too many details in first element\n");
+    }
+
+    return start + elementSize;
+}
+
+// columns available for &fields=, names are lower case as the request is lower cased before parsing
+struct apiField {
+    const char *name;
+    uint16_t offset; // in struct binCraft
+    uint16_t size;
+};
+
+#define API_FIELD(name, member) { name, offsetof(struct binCraft, member), sizeof(((struct binCraft *) 0)->member) }
+static const struct apiField apiFields[] = {
+    API_FIELD("hex", hex),
+    API_FIELD("seen", seen),
+    API_FIELD("lon", lon),
+    API_FIELD("lat", lat),
+    API_FIELD("baro_rate", baro_rate),
+    API_FIELD("geom_rate", geom_rate),
+    API_FIELD("baro_alt", baro_alt),
+    API_FIELD("geom_alt", geom_alt),
+    API_FIELD("nav_altitude_mcp", nav_altitude_mcp),
+    API_FIELD("nav_altitude_fms", nav_altitude_fms),
+    API_FIELD("nav_qnh", nav_qnh),
+    API_FIELD("nav_heading", nav_heading),
+    API_FIELD("squawk", squawk),
+    API_FIELD("gs", gs),
+    API_FIELD("mach", mach),
+    API_FIELD("roll", roll),
+    API_FIELD("track", track),
+    API_FIELD("track_rate", track_rate),
+    API_FIELD("mag_heading", mag_heading),
+    API_FIELD("true_heading", true_heading),
+    API_FIELD("wind_direction", wind_direction),
+    API_FIELD("wind_speed", wind_speed),
+    API_FIELD("oat", oat),
+    API_FIELD("tat", tat),
+    API_FIELD("tas", tas),
+    API_FIELD("ias", ias),
+    API_FIELD("pos_rc", pos_rc),
+    API_FIELD("messages", messages),
+    // the bit fields from category to the validity bits, same layout as in binCraft
+    { "flags", offsetof(struct binCraft, messages) + 2, offsetof(struct binCraft, callsign) - offsetof(struct binCraft, messages) - 2 },
+    API_FIELD("callsign", callsign),
+    API_FIELD("dbflags", dbFlags),
+    API_FIELD("typecode", typeCode),
+    API_FIELD("registration", registration),
+    API_FIELD("receivercount", receiverCount),
+    API_FIELD("signal", signal),
+    API_FIELD("extraflags", extraFlags),
+    API_FIELD("seen_pos", seen_pos),
+};
+#undef API_FIELD
+
+static int apiFieldIndex(const char *name) {
+    for (int i = 0; i < (int) (sizeof(apiFields) / sizeof(apiFields[0])); i++) {
+        if (strcmp(apiFields[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// each column is padded to a multiple of 4 bytes so typed arrays can be used on it directly
+static inline size_t apiColumnBytes(const struct apiField *field, int count) {
+    return (field->size * (size_t) count + 3) & ~((size_t) 3);
+}
+
+static size_t apiColumnsBytes(struct apiOptions *options, int count) {
+    size_t bytes = API_COLUMNS_HEADER + options->fieldCount * sizeof(uint32_t);
+    for (int k = 0; k < options->fieldCount; k++) {
+        bytes += apiColumnBytes(&apiFields[options->fields[k]], count);
+    }
+    return bytes;
+}
+
+// &fields= response: header followed by one array per requested column, in request order
+// header: int64_t now (ms), uint32_t resultCount, uint32_t columnCount,
+// then columnCount uint32_t offsets of the columns from the start of the response
+// column values are the binCraft values (same scaling, little endian)
+static char *apiWriteColumns(char *p, struct apiBuffer *buffer, struct apiOptions *options, struct apiEntry *matches, int count) {
+    char *start = p;
+    int64_t now = buffer->timestamp;
+    uint32_t resultCount = count;
+    uint32_t columnCount = options->fieldCount;
+    memcpy(p, &now, sizeof(now));
+    memcpy(p + 8, &resultCount, sizeof(resultCount));
+    memcpy(p + 12, &columnCount, sizeof(columnCount));
+    uint32_t *offsets = (uint32_t *) (p + API_COLUMNS_HEADER);
+    p += API_COLUMNS_HEADER + columnCount * sizeof(uint32_t);
+
+    for (int k = 0; k < options->fieldCount; k++) {
+        const struct apiField *field = &apiFields[options->fields[k]];
+        uint32_t offset = p - start;
+        memcpy(&offsets[k], &offset, sizeof(offset));
+
+        size_t columnBytes = apiColumnBytes(field, count);
+        char *col = p;
+        switch (field->size) {
+            case 4:
+                for (int i = 0; i < count; i++) {
+                    memcpy(col + 4 * i, (char *) &matches[i].bin + field->offset, 4);
+                }
+                break;
+            case 2:
+                for (int i = 0; i < count; i++) {
+                    memcpy(col + 2 * i, (char *) &matches[i].bin + field->offset, 2);
+                }
+                break;
+            default:
+                for (int i = 0; i < count; i++) {
+                    memcpy(col + field->size * i, (char *) &matches[i].bin + field->offset, field->size);
+                }
+                break;
+        }
+        memset(col + field->size * count, 0, columnBytes - field->size * count);
+        p += columnBytes;
+    }
+    return p;
+}
+
+// run the query in options against buffer
+// returns the number of matches or -1 if out of memory, *alloc is increased by the json length of the matches
+// *doFreeOut is set if *matchesOut needs to be freed by the caller
+static int compareInt32(const void *p1, const void *p2) {
+    int32_t a = *(const int32_t *) p1;
+    int32_t b = *(const int32_t *) p2;
+    return (a > b) - (a < b);
+}
+
+static int indexBucketLen(struct apiIndex *index, int bucket) {
+    return index->start[bucket + 1] - index->start[bucket];
+}
+
+static int indexCollect(struct apiIndex *index, int bucket, int32_t *out) {
+    int n = indexBucketLen(index, bucket);
+    memcpy(out, index->entries + index->start[bucket], n * sizeof(int32_t));
+    return n;
+}
+
+// queries over all aircraft with a type / squawk / dbFlags / altitude filter:
+// start from the smallest posting list instead of the whole list
+// the candidates are a superset of the result in list order, the filters still need to be applied
+// returns the number of candidates, -1 if no index applies or none is smaller than the list
+static int indexCandidates(struct apiBuffer *buffer, struct apiOptions *options, struct apiEntry **matchesOut, size_t *alloc) {
+    enum { SEED_NONE, SEED_SQUAWK, SEED_TYPE, SEED_FLAG, SEED_ALT };
+    int seed = SEED_NONE;
+    int seedLen = buffer->len;
+
+    if (options->filter_squawk) {
+        int n = indexBucketLen(&buffer->squawkIndex, squawkBucket(options->squawk));
+        if (n < seedLen) {
+            seed = SEED_SQUAWK;
+            seedLen = n;
+        }
+    }
+    int typeBuckets[API_REQ_LIST_MAX];
+    int typeBucketCount = 0;
+    if (options->is_typeList || options->filter_typeList) {
+        int n = 0;
+        for (int k = 0; k < options->typeCount; k++) {
+            char typeCode[4];
+            for (int i = 0; i < 4; i++) {
+                typeCode[i] = toupper(options->typeList[4 * k + i]);
+            }
+            int bucket = typeBucket(typeCode);
+            // several types in one bucket are collected once
+            int dup = 0;
+            for (int j = 0; j < typeBucketCount; j++) {
+                dup |= (typeBuckets[j] == bucket);
+            }
+            if (!dup) {
+                typeBuckets[typeBucketCount++] = bucket;
+                n += indexBucketLen(&buffer->typeIndex, bucket);
+            }
+        }
+        if (n < seedLen) {
+            seed = SEED_TYPE;
+            seedLen = n;
+        }
+    }
+    int flagBuckets[API_FLAG_BUCKETS];
+    int flagBucketCount = 0;
+    if (options->filter_dbFlag) {
+        int wanted[API_FLAG_BUCKETS] = { options->filter_mil, options->filter_interesting, options->filter_pia, options->filter_ladd };
+        int n = 0;
+        for (int bit = 0; bit < API_FLAG_BUCKETS; bit++) {
+            if (wanted[bit]) {
+                flagBuckets[flagBucketCount++] = bit;
+                n += indexBucketLen(&buffer->flagIndex, bit);
+            }
+        }
+        if (n < seedLen) {
+            seed = SEED_FLAG;
+            seedLen = n;
+        }
+    }
+    int altFrom = 0;
+    if (options->filter_alt_baro) {
+        altFrom = altLowerBound(buffer, options->above_alt_baro);
+        int altTo = altLowerBound(buffer, (int64_t) options->below_alt_baro + 1);
+        int n = imax(0, altTo - altFrom);
+        if (n < seedLen) {
+            seed = SEED_ALT;
+            seedLen = n;
+        }
+    }
+
+    if (seed == SEED_NONE) {
+        return -1;
+    }
+
+    int32_t *indexes = cmalloc(seedLen * sizeof(int32_t) + 1);
+    struct apiEntry *matches = apiAlloc(seedLen);
+    if (!indexes || !matches) {
+        sfree(indexes);
+        sfree(matches);
+        return -2;
+    }
+
+    int n = 0;
+    int merge = 0; // collected from several lists, sort and deduplicate
+    if (seed == SEED_SQUAWK) {
+        n = indexCollect(&buffer->squawkIndex, squawkBucket(options->squawk), indexes);
+    } else if (seed == SEED_TYPE) {
+        for (int j = 0; j < typeBucketCount; j++) {
+            n += indexCollect(&buffer->typeIndex, typeBuckets[j], indexes + n);
+        }
+        merge = (typeBucketCount > 1);
+    } else if (seed == SEED_FLAG) {
+        for (int j = 0; j < flagBucketCount; j++) {
+            n += indexCollect(&buffer->flagIndex, flagBuckets[j], indexes + n);
+        }
+        merge = (flagBucketCount > 1);
+    } else if (seed == SEED_ALT) {
+        for (int j = 0; j < seedLen; j++) {
+            indexes[n++] = buffer->altSorted[altFrom + j].index;
+        }
+        merge = 1;
+    }
+
+    if (merge && n > 1) {
+        qsort(indexes, n, sizeof(int32_t), compareInt32);
+        int unique = 1;
+        for (int j = 1; j < n; j++) {
+            if (indexes[j] != indexes[unique - 1]) {
+                indexes[unique++] = indexes[j];
+            }
+        }
+        n = unique;
+    }
+
+    for (int j = 0; j < n; j++) {
+        struct apiEntry *e = &buffer->list[indexes[j]];
+        matches[j] = *e;
+        *alloc += e->jsonOffset.len;
+    }
+    sfree(indexes);
+
+    *matchesOut = matches;
+    return n;
+}
+
+static int apiMatch(struct apiBuffer *buffer, struct apiOptions *options, struct apiEntry **matchesOut, int *doFreeOut, size_t *alloc) {
     struct apiEntry *haystack;
     int haylen;
     struct range pos_range;
     struct range all_range;
+    struct apiGrid *grid;
     if (options->filter_dbFlag) {
         haystack = buffer->list_flag;
         haylen = buffer->len_flag;
+        grid = &buffer->grid_flag;
 
         pos_range = buffer->list_flag_pos_range;
 
@@ -452,6 +1175,7 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
     } else {
         haystack = buffer->list;
         haylen = buffer->len;
+        grid = &buffer->grid;
 
         pos_range = buffer->list_pos_range;
 
@@ -459,16 +1183,29 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
         all_range.to = haylen;
     }
 
-    struct char_buffer cb = { 0 };
     struct apiEntry *matches = NULL;
-
-    size_t alloc_base = API_REQ_PADSTART + 1024;
-    size_t alloc = alloc_base;
+    size_t alloc_base = *alloc;
     int count = 0;
 
     int doFree = 0;
 
-    if (options->is_box) {
+    // queries over all aircraft with filters covered by a posting list
+    int candidates = -1;
+    if (options->all || options->all_with_pos || options->is_typeList) {
+        candidates = indexCandidates(buffer, options, &matches, alloc);
+        if (candidates == -2) {
+            return -1;
+        }
+    }
+
+    if (candidates >= 0) {
+        doFree = 1;
+        count = candidates;
+        if (options->is_typeList) {
+            size_t typeAlloc = 0;
+            count = filterTypeList(matches, count, options->typeList, options->typeCount, matches, &typeAlloc);
+        }
+    } else if (options->is_box) {
         int combined_len = haylen;
         if (options->is_hexList) {
             // this is a special case, in addition to the box, also return results for the hexList
@@ -477,37 +1214,37 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
             combined_len += options->hexCount;
         }
 
-        doFree = 1; matches = apiAlloc(combined_len); if (!matches) { return cb; };
+        doFree = 1; matches = apiAlloc(combined_len); if (!matches) { return -1; };
 
         // first get matches for the box
-        count = findInBox(haystack, haylen, options, matches, &alloc);
+        count = findInBox(haystack, grid, options, matches, alloc);
 
         if (options->is_hexList) {
             // optionally add matches for &find_hex
-            count += findHexList(buffer->hexHash, options->hexList, options->hexCount, matches + count, &alloc);
+            count += findHexList(buffer->hexHash, options->hexList, options->hexCount, matches + count, alloc);
         }
     } else if (options->is_circle) {
-        doFree = 1; matches = apiAlloc(haylen); if (!matches) { return cb; };
+        doFree = 1; matches = apiAlloc(haylen); if (!matches) { return -1; };
 
-        count = findInCircle(haystack, haylen, options, matches, &alloc);
+        count = findInCircle(haystack, grid, options, matches, alloc);
 
-        alloc += count * 30; // adding 27 characters per entry: ,"dst":1000.000, "dir":357
+        *alloc += count * 30; // adding 27 characters per entry: ,"dst":1000.000, "dir":357
     } else if (options->is_hexList) {
-        doFree = 1; matches = apiAlloc(options->hexCount); if (!matches) { return cb; };
+        doFree = 1; matches = apiAlloc(options->hexCount); if (!matches) { return -1; };
 
-        count = findHexList(buffer->hexHash, options->hexList, options->hexCount, matches, &alloc);
+        count = findHexList(buffer->hexHash, options->hexList, options->hexCount, matches, alloc);
     } else if (options->is_regList) {
-        doFree = 1; matches = apiAlloc(options->regCount); if (!matches) { return cb; };
+        doFree = 1; matches = apiAlloc(options->regCount); if (!matches) { return -1; };
 
-        count = findRegList(buffer->regHash, options->regList, options->regCount, matches, &alloc);
+        count = findRegList(buffer->regHash, options->regList, options->regCount, matches, alloc);
     } else if (options->is_callsignList) {
-        doFree = 1; matches = apiAlloc(options->callsignCount); if (!matches) { return cb; };
+        doFree = 1; matches = apiAlloc(options->callsignCount); if (!matches) { return -1; };
 
-        count = findCallsignList(buffer->callsignHash, options->callsignList, options->callsignCount, matches, &alloc);
+        count = findCallsignList(buffer->callsignHash, options->callsignList, options->callsignCount, matches, alloc);
     } else if (options->is_typeList) {
-        doFree = 1; matches = apiAlloc(haylen); if (!matches) { return cb; };
+        doFree = 1; matches = apiAlloc(haylen); if (!matches) { return -1; };
 
-        count = filterTypeList(haystack, haylen, options->typeList, options->typeCount, matches, &alloc);
+        count = filterTypeList(haystack, haylen, options->typeList, options->typeCount, matches, alloc);
     } else if (options->all || options->all_with_pos) {
         struct range range;
         if (options->all) {
@@ -517,14 +1254,14 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
         } else {
             fprintf(stderr, "FATAL: unreachablei ahchoh8R\n");
             setExit(2);
-            return cb;
+            return -1;
         }
         count = range.to - range.from;
         if (count > 0) {
             struct apiEntry *first = &haystack[range.from];
             struct apiEntry *last = &haystack[range.to - 1];
             // assume continuous allocation from generation of api buffer
-            alloc += last->jsonOffset.offset + last->jsonOffset.len - first->jsonOffset.offset;
+            *alloc += last->jsonOffset.offset + last->jsonOffset.len - first->jsonOffset.offset;
             doFree = 0;
             matches = first;
         } else {
@@ -534,70 +1271,118 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
     }
 
     if (options->filter_squawk) {
-        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return cb; }
+        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return -1; }
 
-        size_t alloc = alloc_base;
-        count = filterSquawk(matches, count, filtered, &alloc, options->squawk);
+        size_t filterAlloc = alloc_base;
+        count = filterSquawk(matches, count, filtered, &filterAlloc, options->squawk);
 
         if (doFree) { sfree(matches); }; doFree = 1; matches = filtered;
     }
     // filter all_with_pos as pos_range unreliable due do gpsOkBefore f***ery
     if (options->filter_with_pos || options->all_with_pos) {
-        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return cb; }
+        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return -1; }
 
-        size_t alloc = alloc_base;
-        count = filterWithPos(matches, count, filtered, &alloc);
+        size_t filterAlloc = alloc_base;
+        count = filterWithPos(matches, count, filtered, &filterAlloc);
 
         if (doFree) { sfree(matches); }; doFree = 1; matches = filtered;
     }
     if (options->filter_dbFlag) {
-        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return cb; }
+        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return -1; }
 
-        size_t alloc = alloc_base;
-        count = filter_dbFlags(matches, count, filtered, &alloc, options);
+        size_t filterAlloc = alloc_base;
+        count = filter_dbFlags(matches, count, filtered, &filterAlloc, options);
 
         if (doFree) { sfree(matches); }; doFree = 1; matches = filtered;
     }
     if (options->filter_alt_baro) {
-        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return cb; }
+        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return -1; }
 
-        size_t alloc = alloc_base;
-        count = filter_alt_baro(matches, count, filtered, &alloc, options);
+        size_t filterAlloc = alloc_base;
+        count = filter_alt_baro(matches, count, filtered, &filterAlloc, options);
 
         if (doFree) { sfree(matches); }; doFree = 1; matches = filtered;
     }
     if (options->filter_callsign_prefix) {
-        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return cb; }
+        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return -1; }
 
-        size_t alloc = alloc_base;
-        count = filterCallsignPrefix(matches, count, filtered, &alloc, options->callsign_prefix);
+        size_t filterAlloc = alloc_base;
+        count = filterCallsignPrefix(matches, count, filtered, &filterAlloc, options->callsign_prefix);
 
         if (doFree) { sfree(matches); }; doFree = 1; matches = filtered;
     }
     if (options->filter_callsign_exact) {
-        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return cb; }
+        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return -1; }
 
-        size_t alloc = alloc_base;
-        count = filterCallsignExact(matches, count, filtered, &alloc, options->callsign_exact);
+        size_t filterAlloc = alloc_base;
+        count = filterCallsignExact(matches, count, filtered, &filterAlloc, options->callsign_exact);
 
         if (doFree) { sfree(matches); }; doFree = 1; matches = filtered;
     }
     if (options->filter_typeList) {
-        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return cb; }
+        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return -1; }
 
-        size_t alloc = alloc_base;
-        count = filterTypeList(matches, count, options->typeList, options->typeCount, filtered, &alloc);
+        size_t filterAlloc = alloc_base;
+        count = filterTypeList(matches, count, options->typeList, options->typeCount, filtered, &filterAlloc);
 
         if (doFree) { sfree(matches); }; doFree = 1; matches = filtered;
     }
 
+    *matchesOut = matches;
+    *doFreeOut = doFree;
+    return count;
+}
+
+static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *options) {
+
+    int flip = atomic_load(&Modes.apiFlip[thread->index]);
+
+    struct apiBuffer *buffer = &Modes.apiBuffer[flip];
+
+    struct char_buffer cb = { 0 };
+
+    // only compressed responses are cached, compression is what's expensive
+    // json responses aren't, they contain the processing time of the request (ptime)
+    int cacheable = (Modes.apiCacheSize > 0 && options->cacheKeyLen > 0 && (options->zstd || options->zstd_encode)
+            && (options->binCraft || options->fieldCount));
+    uint64_t cacheHash = 0;
+    if (cacheable) {
+        if (options->zstd_encode) {
+            options->cacheKeyLen += sprintf(options->cacheKey + options->cacheKeyLen, "|zstd_encode");
+        }
+        cacheHash = fasthash64(options->cacheKey, options->cacheKeyLen, 0x3a2c1f5e);
+        struct apiCacheEntry *hit = apiCacheGet(&thread->cache, buffer->timestamp, options->cacheKey, options->cacheKeyLen, cacheHash);
+        if (hit) {
+            thread->cacheHits++;
+            cb = apiPoolGet(thread, API_REQ_PADSTART + hit->body.len);
+            if (!cb.buffer) {
+                return cb;
+            }
+            memcpy(cb.buffer + API_REQ_PADSTART, hit->body.buffer, hit->body.len);
+            cb.len = API_REQ_PADSTART + hit->body.len;
+            return cb;
+        }
+        thread->cacheMisses++;
+    }
+
+    size_t alloc_base = API_REQ_PADSTART + 1024;
+    size_t alloc = alloc_base;
+    struct apiEntry *matches = NULL;
+    int doFree = 0;
+    int count = apiMatch(buffer, options, &matches, &doFree, &alloc);
+    if (count < 0) {
+        return cb;
+    }
+
     // elementSize only applies to binCraft output
     uint32_t elementSize = sizeof(struct binCraft);
-    if (options->binCraft) {
+    if (options->fieldCount) {
+        alloc = API_REQ_PADSTART + apiColumnsBytes(options, count);
+    } else if (options->binCraft) {
         alloc = API_REQ_PADSTART + 2 * elementSize + count * elementSize;
     }
 
-    cb.buffer = cmalloc(alloc);
+    cb = apiPoolGet(thread, alloc);
     if (!cb.buffer)
         return cb;
 
@@ -606,58 +1391,10 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
     char *end = cb.buffer + alloc;
 
 
-    if (options->binCraft) {
-        memset(p, 0, elementSize);
-
-#define memWrite(p, var) do { if (p + sizeof(var) > end) { break; }; memcpy(p, &var, sizeof(var)); p += sizeof(var); } while(0)
-
-        int64_t now = buffer->timestamp;
-        memWrite(p, now);
-
-        memWrite(p, elementSize);
-
-        uint32_t ac_count_pos = Modes.globalStatsCount.readsb_aircraft_with_position;
-        memWrite(p, ac_count_pos);
-
-        uint32_t index = 0;
-        memWrite(p, index);
-
-        int16_t south = -90;
-        int16_t west = -180;
-        int16_t north = 90;
-        int16_t east = 180;
-        if (options->is_box) {
-            south = nearbyint(options->box[0]);
-            north = nearbyint(options->box[1]);
-            west = nearbyint(options->box[2]);
-            east = nearbyint(options->box[3]);
-        }
-
-        memWrite(p, south);
-        memWrite(p, west);
-        memWrite(p, north);
-        memWrite(p, east);
-
-        uint32_t messageCount = Modes.stats_current.messages_total + Modes.stats_alltime.messages_total;
-        memWrite(p, messageCount);
-
-        uint32_t resultCount = count;
-        memWrite(p, resultCount);
-
-        int32_t dummy = 0;
-        memWrite(p, dummy);
-
-        memWrite(p, Modes.binCraftVersion);
-
-        uint32_t messageRate = nearbyint(Modes.messageRate * 10);
-        memWrite(p, messageRate);
-
-#undef memWrite
-        if (p - payload > (int) elementSize) {
-            fprintf(stderr, "apiBin: too many details in first element\n");
-        }
-
-        p = payload + elementSize;
+    if (options->fieldCount) {
+        p = apiWriteColumns(p, buffer, options, matches, count);
+    } else if (options->binCraft) {
+        p = apiBinCraftHeader(p, end, buffer, options, count, 0);
 
         for (int i = 0; i < count; i++) {
             if (unlikely(p + elementSize > end)) {
@@ -730,8 +1467,11 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
     if (options->zstd || options->zstd_encode) {
         struct char_buffer new = { 0 };
         size_t new_alloc = API_REQ_PADSTART + ZSTD_compressBound(alloc);
-        new.buffer = cmalloc(new_alloc);
-        memset(new.buffer, 0x0, new_alloc);
+        new = apiPoolGet(thread, new_alloc);
+        if (!new.buffer) {
+            apiPoolPut(thread, &cb);
+            return cb;
+        }
 
         struct char_buffer dst;
         dst.buffer = new.buffer + API_REQ_PADSTART;
@@ -744,36 +1484,185 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
                 payload, payload_len,
                 API_ZSTD_LVL);
 
-        dst.len = compressedSize;
-        new.len = API_REQ_PADSTART + compressedSize;
-        ident(dst);
+        dst.len = compressedSize;
+        new.len = API_REQ_PADSTART + compressedSize;
+        ident(dst);
+
+        // uncompressed buffer goes back to the pool
+        apiPoolPut(thread, &cb);
+
+        cb = new;
+
+        if (ZSTD_isError(compressedSize)) {
+            fprintf(stderr, "API zstd error: %s\n", ZSTD_getErrorName(compressedSize));
+            apiPoolPut(thread, &cb);
+            return cb;
+        }
+        //fprintf(stderr, "first 4 bytes: %08x len: %ld\n", *((uint32_t *) cb.buffer), (long) cb.len);
+
+        if (cacheable) {
+            apiCachePut(&thread->cache, buffer->timestamp, options->cacheKey, options->cacheKeyLen, cacheHash,
+                    cb.buffer + API_REQ_PADSTART, compressedSize);
+        }
+    }
+
+    return cb;
+}
+
+static int compareStreamEntry(const void *p1, const void *p2) {
+    const struct apiStreamEntry *a1 = p1;
+    const struct apiStreamEntry *a2 = p2;
+    return (a1->hex > a2->hex) - (a1->hex < a2->hex);
+}
+
+// one stream update: the aircraft added or changed since the previous update and the ones no longer matching
+// json: one line per update {"now": ..,"aircraft":[..],"removed":["hex",..],"resultCount": ..}
+// binCraft: uint32_t length followed by a binCraft response with the added / changed aircraft,
+// the number of removed aircraft in the int32 of the first element that is otherwise unused,
+// followed by the removed hex ids as uint32_t
+// pad bytes are left free in front of the payload and 2 bytes after it, for the chunked encoding framing
+static struct char_buffer apiStreamDelta(struct apiThread *thread, struct apiBuffer *buffer, struct apiStream *stream, int pad) {
+    struct char_buffer cb = { 0 };
+    struct apiOptions *options = &stream->options;
+
+    size_t alloc = 0;
+    struct apiEntry *matches = NULL;
+    int doFree = 0;
+    int count = apiMatch(buffer, options, &matches, &doFree, &alloc);
+    if (count < 0) {
+        return cb;
+    }
+
+    struct apiStreamEntry *current = cmalloc((count + 1) * sizeof(struct apiStreamEntry));
+    int32_t *changed = cmalloc((count + 1) * sizeof(int32_t));
+    uint32_t *removed = cmalloc((stream->len + 1) * sizeof(uint32_t));
+    if (!current || !changed || !removed) {
+        goto out;
+    }
+
+    for (int i = 0; i < count; i++) {
+        current[i].hex = matches[i].bin.hex;
+        current[i].messages = matches[i].messages;
+        current[i].index = i;
+    }
+    qsort(current, count, sizeof(struct apiStreamEntry), compareStreamEntry);
+
+    // box combined with find_hex can return an aircraft twice
+    int len = 0;
+    for (int i = 0; i < count; i++) {
+        if (len == 0 || current[len - 1].hex != current[i].hex) {
+            current[len++] = current[i];
+        }
+    }
+
+    int changedCount = 0;
+    int removedCount = 0;
+    struct apiStreamEntry *sent = stream->sent;
+    int i = 0;
+    int j = 0;
+    while (i < len || j < stream->len) {
+        if (j >= stream->len || (i < len && current[i].hex < sent[j].hex)) {
+            changed[changedCount++] = current[i++].index;
+        } else if (i >= len || sent[j].hex < current[i].hex) {
+            removed[removedCount++] = sent[j++].hex;
+        } else {
+            if (current[i].messages != sent[j].messages) {
+                changed[changedCount++] = current[i].index;
+            }
+            i++;
+            j++;
+        }
+    }
+
+    uint32_t elementSize = sizeof(struct binCraft);
+    if (options->binCraft) {
+        alloc = pad + sizeof(uint32_t) + (changedCount + 1) * elementSize + removedCount * sizeof(uint32_t) + 2;
+    } else {
+        alloc = pad + 1024 + removedCount * 12 + 2;
+        for (int k = 0; k < changedCount; k++) {
+            alloc += matches[changed[k]].jsonOffset.len + 30;
+        }
+    }
+
+    cb = apiPoolGet(thread, alloc);
+    if (!cb.buffer) {
+        goto out;
+    }
 
-        //free uncompressed buffer
-        sfree(cb.buffer);
+    char *payload = cb.buffer + pad;
+    char *p = payload;
+    char *end = cb.buffer + alloc - 2;
 
-        cb = new;
+    if (options->binCraft) {
+        p += sizeof(uint32_t);
+        p = apiBinCraftHeader(p, end, buffer, options, changedCount, removedCount);
+        for (int k = 0; k < changedCount; k++) {
+            memcpy(p, &matches[changed[k]].bin, elementSize);
+            p += elementSize;
+        }
+        memcpy(p, removed, removedCount * sizeof(uint32_t));
+        p += removedCount * sizeof(uint32_t);
 
-        if (ZSTD_isError(compressedSize)) {
-            fprintf(stderr, "API zstd error: %s\n", ZSTD_getErrorName(compressedSize));
-            sfree(cb.buffer);
-            cb.buffer = NULL;
-            cb.len = 0;
-            return cb;
+        uint32_t length = p - (payload + sizeof(uint32_t));
+        memcpy(payload, &length, sizeof(uint32_t));
+    } else {
+        p = safe_snprintf(p, end, "{\"now\": %.3f,\"aircraft\":[", buffer->timestamp / 1000.0);
+
+        char *json = buffer->json;
+        for (int k = 0; k < changedCount; k++) {
+            struct apiEntry *e = &matches[changed[k]];
+            struct offset off = e->jsonOffset;
+            if (off.len < 2) {
+                continue;
+            }
+            // json objects in cache are \n{ .... }, drop the newline so each update is a single line
+            memcpy(p, json + off.offset + 1, off.len - 1);
+            p += off.len - 1;
+            if (options->is_circle) {
+                p -= 2;
+                p = safe_snprintf(p, end, ",\"dst\":%.3f,\"dir\":%.1f},", e->distance / 1852.0, e->direction);
+            }
         }
-        //fprintf(stderr, "first 4 bytes: %08x len: %ld\n", *((uint32_t *) cb.buffer), (long) cb.len);
+        if (*(p - 1) == ',')
+            p--;
+
+        p = safe_snprintf(p, end, "],\"removed\":[");
+        for (int k = 0; k < removedCount; k++) {
+            p = safe_snprintf(p, end, "\"%s%06x\",", (removed[k] & MODES_NON_ICAO_ADDRESS) ? "~" : "", removed[k] & 0xFFFFFF);
+        }
+        if (*(p - 1) == ',')
+            p--;
+
+        p = safe_snprintf(p, end, "],\"resultCount\": %d}\n", len);
     }
+    cb.len = p - cb.buffer;
+
+    sfree(stream->sent);
+    stream->sent = current;
+    current = NULL;
+    stream->len = len;
+    stream->timestamp = buffer->timestamp;
 
+out:
+    sfree(current);
+    sfree(changed);
+    sfree(removed);
+    if (doFree) {
+        sfree(matches);
+    }
     return cb;
 }
 
-static inline void apiAdd(struct apiBuffer *buffer, struct aircraft *a, int64_t now) {
+static inline void apiAdd(struct apiEntry *list, int *len, struct aircraft *a, int64_t now) {
     if (!(includeAircraftJson(now, a)))
         return;
 
-    struct apiEntry *entry = &(buffer->list[buffer->len]);
+    struct apiEntry *entry = &list[*len];
     memset(entry, 0, sizeof(struct apiEntry));
 
     toBinCraft(a, &entry->bin, now);
+    entry->binLat = entry->bin.lat;
+    entry->binLon = entry->bin.lon;
 
     if (trackDataValid(&a->pos_reliable_valid)) {
         // position valid
@@ -786,41 +1675,97 @@ static inline void apiAdd(struct apiBuffer *buffer, struct aircraft *a, int64_t
         entry->bin.lon = INT32_MAX;
     }
 
-    buffer->aircraftJsonCount++;
-
     entry->globe_index = a->globe_index;
+    entry->messages = a->messages;
 
-    buffer->len++;
+    (*len)++;
 }
 
-static inline void apiGenerateJson(struct apiBuffer *buffer, int64_t now) {
-    sfree(buffer->json);
-    buffer->json = NULL;
+// entry of the previous buffer that can be used unchanged for this aircraft
+static inline struct apiEntry *apiReusable(struct apiBuffer *prev, struct aircraft *a, int64_t now) {
+    struct apiEntry *e = prev->hexHash[hexHash(a->addr)];
+    while (e && e->bin.hex != a->addr) {
+        e = e->nextHex;
+    }
+    if (!e || e->messages != a->messages || now - e->jsonTime >= Modes.apiIncremental) {
+        return NULL;
+    }
+    if (!includeAircraftJson(now, a)) {
+        return NULL;
+    }
+    return e;
+}
 
-    size_t alloc = buffer->len * 1024 + 4096; // The initial buffer is resized as needed
-    buffer->json = (char *) cmalloc(alloc);
-    char *p = buffer->json;
-    char *end = buffer->json + alloc;
+// convert a slice of the active aircraft and sort the entries, parts run in parallel
+static void apiSerializePart(void *arg, threadpool_threadbuffers_t *buffer_group) {
+    MODES_NOTUSED(buffer_group);
+    struct apiUpdatePart *part = arg;
+    struct apiBuffer *prev = part->prev;
+    int64_t now = part->now;
 
-    for (int i = 0; i < buffer->len; i++) {
-        if ((p + 16 * 1024) >= end) {
-            int used = p - buffer->json;
-            alloc *= 2;
-            buffer->json = (char *) realloc(buffer->json, alloc);
-            p = buffer->json + used;
-            end = buffer->json + alloc;
+    part->len = 0;
+    part->merged = 0;
+    for (int i = 0; i < part->aircraftCount; i++) {
+        struct aircraft *a = part->aircraft[i];
+
+        if (a == NULL)
+            continue;
+
+        if (prev) {
+            struct apiEntry *e = apiReusable(prev, a, now);
+            if (e) {
+                // an aircraft has only one entry, the parts never set the same flag
+                prev->reused[e - prev->list] = 1;
+                continue;
+            }
         }
 
-        struct apiEntry *entry = &buffer->list[i];
-        struct aircraft *a = aircraftGet(entry->bin.hex);
+        apiAdd(part->list, &part->len, a, now);
+    }
 
-        if (!a) {
-            fprintf(stderr, "FATAL: apiGenerateJson: aircraft missing, this shouldn't happen.");
-            setExit(2);
-            entry->jsonOffset.offset = 0;
-            entry->jsonOffset.len = 0;
-            continue;
+    qsort(part->list, part->len, sizeof(struct apiEntry), compareLon);
+}
+
+// merge the parts and the entries of the previous buffer reused by --api-incremental, all are sorted by longitude
+static void apiMergeParts(struct apiBuffer *buffer, struct apiBuffer *prev, struct apiUpdatePart *parts, int partCount) {
+    int i = 0;
+    int len = 0;
+    while (1) {
+        while (prev && i < prev->len && !prev->reused[i]) {
+            i++;
+        }
+        struct apiEntry *next = NULL;
+        struct apiUpdatePart *from = NULL;
+        if (prev && i < prev->len) {
+            next = &prev->list[i];
+        }
+        for (int k = 0; k < partCount; k++) {
+            struct apiUpdatePart *part = &parts[k];
+            if (part->merged < part->len) {
+                struct apiEntry *e = &part->list[part->merged];
+                if (!next || e->bin.lon < next->bin.lon) {
+                    next = e;
+                    from = part;
+                }
+            }
+        }
+        if (!next) {
+            break;
+        }
+        buffer->list[len++] = *next;
+        if (from) {
+            from->merged++;
+        } else {
+            i++;
         }
+    }
+    buffer->len = len;
+}
+
+static void apiHashEntries(struct apiBuffer *buffer) {
+    for (int i = 0; i < buffer->len; i++) {
+        struct apiEntry *entry = &buffer->list[i];
+
         uint32_t hash;
 
         hash = hexHash(entry->bin.hex);
@@ -835,24 +1780,139 @@ static inline void apiGenerateJson(struct apiBuffer *buffer, int64_t now) {
         entry->nextCallsign = buffer->callsignHash[hash];
         buffer->callsignHash[hash] = entry;
         //fprintf(stderr, "callsign: %8s hash: %u\n", entry->bin.callsign, hash);
+    }
+}
+
+// print buffer->list[from, to) into *json, it's resized as needed
+// jsonOffset is set relative to *json, returns the length
+// prevJson: json fragments of reused entries are copied from there
+static size_t apiJsonRange(struct apiBuffer *buffer, char *prevJson, int from, int to, char **json, size_t *alloc, int64_t now) {
+    char *p = *json;
+    char *end = *json + *alloc;
+
+    for (int i = from; i < to; i++) {
+        if ((p + 16 * 1024) >= end) {
+            size_t used = p - *json;
+            *alloc *= 2;
+            *json = (char *) realloc(*json, *alloc);
+            p = *json + used;
+            end = *json + *alloc;
+        }
+
+        struct apiEntry *entry = &buffer->list[i];
 
         char *start = p;
 
-        *p++ = '\n';
-        p = sprintAircraftObject(p, end, a, now, 0, NULL);
-        *p++ = ',';
+        if (entry->jsonTime && prevJson) {
+            // reused entry, jsonOffset still refers to the previous buffer
+            memcpy(p, prevJson + entry->jsonOffset.offset, entry->jsonOffset.len);
+            p += entry->jsonOffset.len;
+        } else {
+            struct aircraft *a = aircraftGet(entry->bin.hex);
+
+            if (!a) {
+                fprintf(stderr, "FATAL: apiGenerateJson: aircraft missing, this shouldn't happen.");
+                setExit(2);
+                entry->jsonOffset.offset = 0;
+                entry->jsonOffset.len = 0;
+                continue;
+            }
+
+            *p++ = '\n';
+            p = sprintAircraftObject(p, end, a, now, 0, NULL);
+            *p++ = ',';
 
+            entry->jsonTime = now;
+        }
 
-        entry->jsonOffset.offset = start - buffer->json;
+        entry->jsonOffset.offset = start - *json;
         entry->jsonOffset.len = p - start;
     }
 
-    buffer->jsonLen = p - buffer->json;
-
     if (p >= end) {
         fprintf(stderr, "FATAL: buffer full apiAdd\n");
         setExit(2);
     }
+
+    return p - *json;
+}
+
+static void apiJsonPart(void *arg, threadpool_threadbuffers_t *buffer_group) {
+    MODES_NOTUSED(buffer_group);
+    struct apiUpdatePart *part = arg;
+    char *prevJson = part->prev ? part->prev->json : NULL;
+
+    part->jsonLen = apiJsonRange(part->buffer, prevJson, part->from, part->to, &part->json, &part->jsonAlloc, part->now);
+}
+
+static void apiRunParts(struct apiUpdatePart *parts, int partCount, threadpool_function_t func) {
+    if (partCount == 1) {
+        func(&parts[0], NULL);
+        return;
+    }
+
+    threadpool_task_t *tasks = Modes.apiUpdateTasks->tasks;
+    for (int k = 0; k < partCount; k++) {
+        tasks[k].function = func;
+        tasks[k].argument = &parts[k];
+    }
+
+    struct timespec before = threadpool_get_cumulative_thread_time(Modes.apiUpdatePool);
+    threadpool_run(Modes.apiUpdatePool, tasks, partCount);
+    struct timespec after = threadpool_get_cumulative_thread_time(Modes.apiUpdatePool);
+    timespec_add_elapsed(&before, &after, &Modes.stats_current.api_update_cpu);
+}
+
+// prev: json fragments of reused entries are copied from there
+static void apiGenerateJson(struct apiBuffer *buffer, struct apiBuffer *prev, struct apiUpdatePart *parts, int partCount, int64_t now) {
+    sfree(buffer->json);
+
+    apiHashEntries(buffer);
+
+    if (partCount == 1) {
+        size_t alloc = buffer->len * 1024 + 4096; // The initial buffer is resized as needed
+        buffer->json = (char *) cmalloc(alloc);
+        buffer->jsonLen = apiJsonRange(buffer, prev ? prev->json : NULL, 0, buffer->len, &buffer->json, &alloc, now);
+        return;
+    }
+
+    int section = buffer->len / partCount;
+    int extra = buffer->len % partCount;
+    int from = 0;
+    for (int k = 0; k < partCount; k++) {
+        struct apiUpdatePart *part = &parts[k];
+        part->from = from;
+        part->to = from + section + (k < extra ? 1 : 0);
+        from = part->to;
+
+        size_t alloc = (part->to - part->from) * 1024 + 4096;
+        if (part->jsonAlloc < alloc) {
+            sfree(part->json);
+            part->jsonAlloc = alloc;
+            part->json = (char *) cmalloc(alloc);
+        }
+    }
+
+    apiRunParts(parts, partCount, apiJsonPart);
+
+    size_t total = 0;
+    for (int k = 0; k < partCount; k++) {
+        total += parts[k].jsonLen;
+    }
+    buffer->json = (char *) cmalloc(total + 1);
+
+    // concatenate, offsets were relative to the part
+    char *p = buffer->json;
+    for (int k = 0; k < partCount; k++) {
+        struct apiUpdatePart *part = &parts[k];
+        int32_t base = p - buffer->json;
+        memcpy(p, part->json, part->jsonLen);
+        p += part->jsonLen;
+        for (int i = part->from; i < part->to; i++) {
+            buffer->list[i].jsonOffset.offset += base;
+        }
+    }
+    buffer->jsonLen = p - buffer->json;
 }
 
 
@@ -862,11 +1922,16 @@ static int apiUpdate() {
     // always clear and update the inactive apiBuffer
     int flip = (atomic_load(&Modes.apiFlip[0]) + 1) % 2;
     struct apiBuffer *buffer = &Modes.apiBuffer[flip];
+    // the buffer currently used by the api threads, only read from it
+    struct apiBuffer *prev = &Modes.apiBuffer[(flip + 1) % 2];
 
     // reset buffer lengths
     buffer->len = 0;
     buffer->len_flag = 0;
 
+    // ca_add() appends while we hold the read lock, only look at the aircraft the list is sized for
+    ca_lock_read(ca);
+
     int acCount = ca->len;
     if (buffer->alloc < acCount) {
         if (acCount > 100000) {
@@ -875,9 +1940,30 @@ static int apiUpdate() {
         buffer->alloc = acCount + 128;
         sfree(buffer->list);
         sfree(buffer->list_flag);
+        sfree(buffer->list_fresh);
+        sfree(buffer->reused);
+        sfree(buffer->grid.entries);
+        sfree(buffer->grid_flag.entries);
         buffer->list = cmalloc(buffer->alloc * sizeof(struct apiEntry));
         buffer->list_flag = cmalloc(buffer->alloc * sizeof(struct apiEntry));
-        if (!buffer->list || !buffer->list_flag) {
+        buffer->list_fresh = cmalloc(buffer->alloc * sizeof(struct apiEntry));
+        buffer->reused = cmalloc(buffer->alloc * sizeof(uint8_t));
+        buffer->grid.entries = cmalloc(buffer->alloc * sizeof(int32_t));
+        buffer->grid_flag.entries = cmalloc(buffer->alloc * sizeof(int32_t));
+        sfree(buffer->typeIndex.entries);
+        sfree(buffer->squawkIndex.entries);
+        sfree(buffer->flagIndex.entries);
+        sfree(buffer->globeIndex.entries);
+        sfree(buffer->altSorted);
+        buffer->typeIndex.entries = cmalloc(buffer->alloc * sizeof(int32_t));
+        buffer->squawkIndex.entries = cmalloc(buffer->alloc * sizeof(int32_t));
+        buffer->flagIndex.entries = cmalloc(API_FLAG_BUCKETS * buffer->alloc * sizeof(int32_t));
+        buffer->globeIndex.entries = cmalloc(buffer->alloc * sizeof(int32_t));
+        buffer->altSorted = cmalloc(buffer->alloc * sizeof(struct apiAltEntry));
+        if (!buffer->list || !buffer->list_flag || !buffer->list_fresh || !buffer->reused
+                || !buffer->grid.entries || !buffer->grid_flag.entries
+                || !buffer->typeIndex.entries || !buffer->squawkIndex.entries || !buffer->flagIndex.entries
+                || !buffer->globeIndex.entries || !buffer->altSorted) {
             fprintf(stderr, "apiList alloc: out of memory!\n");
             exit(1);
         }
@@ -888,28 +1974,52 @@ static int apiUpdate() {
     memset(buffer->regHash, 0x0, API_BUCKETS * sizeof(struct apiEntry*));
     memset(buffer->callsignHash, 0x0, API_BUCKETS * sizeof(struct apiEntry*));
 
-    // reset api list, just in case we don't set the entries completely due to oversight
-    memset(buffer->list, 0x0, buffer->alloc * sizeof(struct apiEntry));
-    memset(buffer->list_flag, 0x0, buffer->alloc * sizeof(struct apiEntry));
+    // apiAdd() and apiMergeParts() write complete entries, no need to clear the lists
 
-    buffer->aircraftJsonCount = 0;
+    // --api-incremental: aircraft without new messages since the previous update keep their entry and json
+    int incremental = (Modes.apiIncremental > 0 && prev->len > 0 && prev->json && prev->reused);
+    if (incremental) {
+        memset(prev->reused, 0x0, prev->len * sizeof(uint8_t));
+    }
 
     int64_t now = mstime();
-    ca_lock_read(ca);
-    for (int i = 0; i < ca->len; i++) {
-        struct aircraft *a = ca->list[i];
 
-        if (a == NULL)
-            continue;
-
-        apiAdd(buffer, a, now);
-    }
+    // --api-update-threads: split the aircraft into parts, small numbers aren't worth it
+    int partCount = imax(1, imin(Modes.apiUpdateThreads, acCount / API_UPDATE_MIN_PART));
+    struct apiUpdatePart *parts = Modes.apiUpdateParts;
+    int section = acCount / partCount;
+    int extra = acCount % partCount;
+    int from = 0;
+    for (int k = 0; k < partCount; k++) {
+        struct apiUpdatePart *part = &parts[k];
+        part->buffer = buffer;
+        part->prev = incremental ? prev : NULL;
+        part->aircraft = ca->list + from;
+        part->aircraftCount = section + (k < extra ? 1 : 0);
+        // a single part without reused entries is written to the list directly, otherwise the parts are merged into it
+        part->list = (partCount == 1 && !incremental) ? buffer->list : buffer->list_fresh + from;
+        part->now = now;
+        from += part->aircraftCount;
+    }
+
+    apiRunParts(parts, partCount, apiSerializePart);
     ca_unlock_read(ca);
 
-    // sort api lists
-    qsort(buffer->list, buffer->len, sizeof(struct apiEntry), compareLon);
+    if (partCount == 1 && !incremental) {
+        buffer->len = parts[0].len;
+    } else {
+        apiMergeParts(buffer, incremental ? prev : NULL, parts, partCount);
+    }
+    buffer->aircraftJsonCount = buffer->len;
 
-    apiGenerateJson(buffer, now);
+    if (Modes.api || Modes.onlyBin < 2) {
+        apiGenerateJson(buffer, incremental ? prev : NULL, parts, partCount, now);
+    } else {
+        // only binCraft is written, skip the json fragments
+        sfree(buffer->json);
+        buffer->jsonLen = 0;
+        apiHashEntries(buffer);
+    }
 
     for (int i = 0; i < buffer->len; i++) {
         struct apiEntry entry = buffer->list[i];
@@ -923,6 +2033,15 @@ static int apiUpdate() {
     buffer->list_pos_range = findLonRange(-180 * 1E6, 180 * 1E6, buffer->list, buffer->len);
     buffer->list_flag_pos_range = findLonRange(-180 * 1E6, 180 * 1E6, buffer->list_flag, buffer->len_flag);
 
+    gridBuild(&buffer->grid, buffer->list, buffer->len);
+    gridBuild(&buffer->grid_flag, buffer->list_flag, buffer->len_flag);
+
+    indexBuild(&buffer->typeIndex, API_TYPE_BUCKETS, buffer->list, buffer->len, typeKeys);
+    indexBuild(&buffer->squawkIndex, API_SQUAWK_BUCKETS, buffer->list, buffer->len, squawkKeys);
+    indexBuild(&buffer->flagIndex, API_FLAG_BUCKETS, buffer->list, buffer->len, flagKeys);
+    indexBuild(&buffer->globeIndex, GLOBE_MAX_INDEX + 1, buffer->list, buffer->len, globeKeys);
+    altBuild(buffer);
+
     buffer->timestamp = now;
 
     // doesn't matter which of the 2 buffers the api req will use they are both pretty current
@@ -930,6 +2049,16 @@ static int apiUpdate() {
         atomic_store(&Modes.apiFlip[i], flip);
     }
 
+    // wake api threads that have stream subscribers
+    for (int i = 0; i < Modes.apiThreadCount; i++) {
+        struct apiThread *thread = &Modes.apiThread[i];
+        if (atomic_load(&thread->streamCount) > 0) {
+            uint64_t one = 1;
+            ssize_t res = write(thread->eventfd, &one, sizeof(one));
+            MODES_NOTUSED(res);
+        }
+    }
+
     pthread_cond_signal(&Threads.json.cond);
     pthread_cond_signal(&Threads.globeJson.cond);
 
@@ -969,13 +2098,18 @@ static void apiCloseCon(struct apiCon *con, struct apiThread *thread) {
     con->request.len = 0;
     con->request.alloc = 0;
 
-    struct char_buffer *reply = &con->reply;
-
-    thread->responseBytesBuffered -= reply->len;
+    for (int i = 0; i < con->replyCount; i++) {
+        struct char_buffer *reply = &con->replies[i].cb;
+        thread->responseBytesBuffered -= reply->len;
+        apiPoolPut(thread, reply);
+    }
+    con->replyCount = 0;
 
-    sfree(reply->buffer);
-    reply->len = 0;
-    reply->alloc = 0;
+    if (con->stream) {
+        sfree(con->stream->sent);
+        sfree(con->stream);
+        atomic_fetch_sub(&thread->streamCount, 1);
+    }
 
     con->open = 0;
     thread->conCount--;
@@ -984,41 +2118,9 @@ static void apiCloseCon(struct apiCon *con, struct apiThread *thread) {
     //fprintf(stderr, "%2d %5d\n", thread->index, thread->conCount);
 }
 
-static void apiResetCon(struct apiCon *con, struct apiThread *thread) {
-    if (!con->open) {
-        fprintf(stderr, "apiResetCon called on closed connection!\n");
-        return;
-    }
-    if (!con->keepalive) {
-        apiCloseCon(con, thread);
-        return;
-    }
-
-    if (Modes.debug_api) {
-        fprintf(stderr, "%d %d apiResetCon\n", thread->index, con->fd);
-    }
-
-    // not freeing request buffer, rather reusing it
-    con->request.len = 0;
-
-    con->bytesSent = 0;
-
-    struct char_buffer *reply = &con->reply;
-
-    thread->responseBytesBuffered -= reply->len;
-
-    // free reply buffer
-    sfree(reply->buffer);
-    reply->len = 0;
-    reply->alloc = 0;
-
-    con->lastReset = mstime();
-}
-
-static void sendStatus(int fd, int keepalive, const char *http_status) {
-    char buf[256];
+static int formatStatus(char *buf, size_t len, int keepalive, const char *http_status) {
     char *p = buf;
-    char *end = buf + sizeof(buf);
+    char *end = buf + len;
 
     p = safe_snprintf(p, end,
     "HTTP/1.1 %s\r\n"
@@ -1029,27 +2131,45 @@ static void sendStatus(int fd, int keepalive, const char *http_status) {
     http_status,
     keepalive ? "keep-alive" : "close");
 
-    int res = send(fd, buf, strlen(buf), 0);
+    return p - buf;
+}
+
+// send a status directly, only used before closing the connection
+static void sendStatus(int fd, const char *http_status) {
+    char buf[256];
+    int len = formatStatus(buf, sizeof(buf), 0, http_status);
+
+    int res = send(fd, buf, len, 0);
     MODES_NOTUSED(res);
 }
 
-static void send200(int fd, int keepalive) {
-    sendStatus(fd, keepalive, "200 OK");
+// queue a status response behind the responses to previous pipelined requests
+static void queueStatus(struct apiCon *con, struct apiThread *thread, const char *http_status) {
+    struct char_buffer cb = apiPoolGet(thread, 256);
+    if (!cb.buffer) {
+        return;
+    }
+    cb.len = formatStatus(cb.buffer, cb.alloc, con->keepalive, http_status);
+    apiQueueReply(con, thread, cb, 0);
+}
+
+static void send200(struct apiCon *con, struct apiThread *thread) {
+    queueStatus(con, thread, "200 OK");
 }
-static void send400(int fd, int keepalive) {
-    sendStatus(fd, keepalive, "400 Bad Request");
+static void send400(struct apiCon *con, struct apiThread *thread) {
+    queueStatus(con, thread, "400 Bad Request");
 }
-static void send405(int fd, int keepalive) {
-    sendStatus(fd, keepalive, "405 Method Not Allowed");
+static void send405(struct apiCon *con, struct apiThread *thread) {
+    queueStatus(con, thread, "405 Method Not Allowed");
 }
-static void send505(int fd, int keepalive) {
-    sendStatus(fd, keepalive, "505 HTTP Version Not Supported");
+static void send505(struct apiCon *con, struct apiThread *thread) {
+    queueStatus(con, thread, "505 HTTP Version Not Supported");
 }
-static void send503(int fd, int keepalive) {
-    sendStatus(fd, keepalive, "503 Service Unavailable");
+static void send503(struct apiCon *con, struct apiThread *thread) {
+    queueStatus(con, thread, "503 Service Unavailable");
 }
-static void send500(int fd, int keepalive) {
-    sendStatus(fd, keepalive, "500 Internal Server Error");
+static void send500(struct apiCon *con, struct apiThread *thread) {
+    queueStatus(con, thread, "500 Internal Server Error");
 }
 
 
@@ -1078,6 +2198,31 @@ static int parseDoubles(char *start, char *end, double *results, int max) {
 }
 
 // expects lower cased input
+// subscribe the connection to stream updates, the reply is only the HTTP header
+// the first update sent by apiStreamSend contains all matching aircraft
+static struct char_buffer apiStreamStart(struct apiCon *con, struct apiOptions *options, struct apiThread *thread) {
+    struct char_buffer cb = { 0 };
+
+    struct apiStream *stream = cmalloc(sizeof(struct apiStream));
+    if (!stream) {
+        return cb;
+    }
+    memset(stream, 0, sizeof(struct apiStream));
+    stream->options = *options;
+    stream->chunked = (con->http_minor_version == 1);
+
+    cb = apiPoolGet(thread, API_REQ_PADSTART);
+    if (!cb.buffer) {
+        sfree(stream);
+        return cb;
+    }
+    cb.len = API_REQ_PADSTART;
+
+    con->stream = stream;
+    atomic_fetch_add(&thread->streamCount, 1);
+    return cb;
+}
+
 static struct char_buffer parseFetch(struct apiCon *con, struct char_buffer *request, struct apiOptions *options, struct apiThread *thread) {
     struct char_buffer invalid = { 0 };
 
@@ -1100,6 +2245,8 @@ static struct char_buffer parseFetch(struct apiCon *con, struct char_buffer *req
     // we only want the URL
     *eoq = '\0';
 
+    options->cacheKeyLen = apiCacheKey(query, eoq, options->cacheKey);
+
     // set some option defaults:
     options->above_alt_baro = INT32_MIN;
     options->below_alt_baro = INT32_MAX;
@@ -1252,6 +2399,18 @@ static struct char_buffer parseFetch(struct apiCon *con, struct char_buffer *req
                     return invalid;
 
                 options->typeCount = typeCount;
+            } else if (byteMatchStrict(option, "fields")) {
+                char *saveptr = NULL;
+                char *tok = strtok_r(value, ",", &saveptr);
+                while (tok) {
+                    int index = apiFieldIndex(tok);
+                    if (index < 0 || options->fieldCount >= API_FIELDS_MAX)
+                        return invalid;
+                    options->fields[options->fieldCount++] = index;
+                    tok = strtok_r(NULL, ",", &saveptr);
+                }
+                if (options->fieldCount == 0)
+                    return invalid;
             } else if (byteMatchStrict(option, "filter_callsign_exact")) {
 
                 options->filter_callsign_exact = 1;
@@ -1313,6 +2472,8 @@ static struct char_buffer parseFetch(struct apiCon *con, struct char_buffer *req
                 options->filter_ladd = 1;
             } else if (byteMatchStrict(option, "include_version")) {
                 con->include_version = 1;
+            } else if (byteMatchStrict(option, "stream")) {
+                options->stream = 1;
             } else {
                 return invalid;
             }
@@ -1341,12 +2502,26 @@ static struct char_buffer parseFetch(struct apiCon *con, struct char_buffer *req
 
     //fprintf(stderr, "parseFetch calling apiReq\n");
 
+    // columns are a binary format of their own
+    if (options->fieldCount && (options->binCraft || options->jamesv2)) {
+        return invalid;
+    }
+
+    if (options->stream) {
+        // updates are small, not compressed
+        if (options->zstd || options->jamesv2 || options->fieldCount) {
+            return invalid;
+        }
+        options->zstd_encode = 0;
+        con->content_type = options->binCraft ? "application/octet-stream" : "application/x-ndjson";
+        return apiStreamStart(con, options, thread);
+    }
 
     if (options->zstd) {
         // don't double zstd compress
         options->zstd_encode = 0;
         con->content_type = "application/zstd";
-    } else if (options->binCraft) {
+    } else if (options->binCraft || options->fieldCount) {
         con->content_type = "application/octet-stream";
     } else {
         con->content_type = "application/json";
@@ -1355,173 +2530,206 @@ static struct char_buffer parseFetch(struct apiCon *con, struct char_buffer *req
     return apiReq(thread, options);
 }
 
-static void apiSendData(struct apiCon *con, struct apiThread *thread) {
-    struct char_buffer *reply = &con->reply;
-    int toSend = reply->len - con->bytesSent;
-
-    if (toSend <= 0) {
-        if ((con->events & EPOLLOUT)) {
-            con->events = EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP;
-            struct epoll_event epollEvent = { .events = con->events };
-            epollEvent.data.ptr = con;
-
-            if (epoll_ctl(thread->epfd, EPOLL_CTL_MOD, con->fd, &epollEvent)) {
-                perror("apiResetCon() epoll_ctl fail:");
-            }
-        }
-        if (toSend < 0) {
-            fprintf(stderr, "wat?! toSend < 0\n");
-        }
+static void apiSetEvents(struct apiCon *con, struct apiThread *thread, uint32_t events) {
+    if (con->events == events) {
         return;
     }
+    con->events = events;
+    struct epoll_event epollEvent = { .events = con->events };
+    epollEvent.data.ptr = con;
 
-    char *dataStart = reply->buffer + con->bytesSent;
-
-    int nwritten = send(con->fd, dataStart, toSend, 0);
-
-    if (nwritten > 0) {
-        con->bytesSent += nwritten;
+    if (epoll_ctl(thread->epfd, EPOLL_CTL_MOD, con->fd, &epollEvent)) {
+        perror("apiSetEvents() epoll_ctl fail:");
     }
+}
 
-    // all data has been sent, reset the connection
-    if (nwritten == toSend) {
-        apiResetCon(con, thread);
+// send the queued responses with a single writev
+static void apiFlush(struct apiCon *con, struct apiThread *thread) {
+    int count = con->replyCount;
+    if (count <= 0) {
+        apiSetEvents(con, thread, EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP);
         return;
     }
 
+    struct iovec iov[API_PIPELINE_MAX];
+    size_t toSend = 0;
+    for (int i = 0; i < count; i++) {
+        struct apiReply *reply = &con->replies[i];
+        iov[i].iov_base = reply->cb.buffer + reply->sent;
+        iov[i].iov_len = reply->cb.len - reply->sent;
+        toSend += iov[i].iov_len;
+    }
+
+    ssize_t nwritten = writev(con->fd, iov, count);
+
     if (nwritten < 0) {
         if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
             // no progress, make sure EPOLLOUT is set.
+            nwritten = 0;
         } else {
             // non recoverable error, close connection
             if (antiSpam(&thread->antiSpam[0], 5 * SECONDS)) {
-                fprintf(stderr, "apiSendData fail: %s (was trying to send %d bytes)\n", strerror(errno), toSend);
+                fprintf(stderr, "apiSendData fail: %s (was trying to send %ld bytes)\n", strerror(errno), (long) toSend);
             }
             apiCloseCon(con, thread);
             return;
         }
     }
 
-    //fprintf(stderr, "wrote only %d of %d\n", nwritten, toSend);
-
-    // couldn't write everything, set EPOLLOUT
-    if (!(con->events & EPOLLOUT)) {
-        con->events = EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP | EPOLLOUT;
-        struct epoll_event epollEvent = { .events = con->events };
-        epollEvent.data.ptr = con;
-
-        if (epoll_ctl(thread->epfd, EPOLL_CTL_MOD, con->fd, &epollEvent)) {
-            perror("apiSendData() epoll_ctl fail:");
+    if (nwritten > 0) {
+        // only events without progress count towards the limit in apiThreadEntryPoint
+        con->wakeups = 0;
+    }
+
+    // release the responses that were sent completely
+    size_t left = nwritten;
+    int done = 0;
+    while (done < count) {
+        struct apiReply *reply = &con->replies[done];
+        size_t len = reply->cb.len - reply->sent;
+        if (left < len) {
+            reply->sent += left;
+            break;
         }
+        left -= len;
+        thread->responseBytesBuffered -= reply->cb.len;
+        apiPoolPut(thread, &reply->cb);
+        done++;
+    }
+    if (done > 0) {
+        con->replyCount -= done;
+        memmove(con->replies, con->replies + done, con->replyCount * sizeof(struct apiReply));
     }
 
-    return;
-}
-
-static void apiShutdown(struct apiCon *con, struct apiThread *thread, int line, int err) {
-    if (con->bytesSent != con->reply.len) {
-        if (antiSpam(&thread->antiSpam[1], 5 * SECONDS)) {
-            fprintf(stderr, "Connection shutdown with incomplete or no reply sent."
-                    " (reply.len: %d, bytesSent: %d, request.len: %d open: %d line: %d errno: %s)\n",
-                    (int) con->reply.len,
-                    (int) con->bytesSent,
-                    (int) con->request.len,
-                    con->open,
-                    line,
-                    err ? strerror(err) : "-");
+    if (con->replyCount == 0) {
+        // streams stay open after each update was sent, also for HTTP/1.0
+        if (!con->keepalive && !con->stream) {
+            apiCloseCon(con, thread);
+            return;
         }
+        con->lastReset = mstime();
+        apiSetEvents(con, thread, EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP);
+    } else {
+        //fprintf(stderr, "wrote only %d of %d\n", (int) nwritten, (int) toSend);
+        // couldn't write everything, wait for EPOLLOUT
+        // further pipelined requests stay in the socket buffer until then
+        apiSetEvents(con, thread, EPOLLRDHUP | EPOLLERR | EPOLLHUP | EPOLLOUT);
     }
-    apiCloseCon(con, thread);
 }
 
-static void apiReadRequest(struct apiCon *con, struct apiThread *thread) {
-
-    // delay processing requests until we have more memory
-    if (thread->responseBytesBuffered > 512 * 1024 * 1024) {
-        if (antiSpam(&thread->antiSpam[2], 5 * SECONDS)) {
-            fprintf(stderr, "Delaying request processing due to per thread memory limit: 512 MB\n");
-        }
+static void apiSendData(struct apiCon *con, struct apiThread *thread) {
+    apiFlush(con, thread);
+    if (!con->open || con->replyCount) {
         return;
     }
+    if (con->stream) {
+        // send a newer update right away if the client was slow
+        apiStreamSend(con, thread);
+    } else {
+        // requests that were pipelined while we were sending
+        apiProcessRequests(con, thread);
+    }
+}
 
-    int nread, toRead;
-    int fd = con->fd;
-
-    struct char_buffer *request = &con->request;
+static void apiStreamSend(struct apiCon *con, struct apiThread *thread) {
+    struct apiStream *stream = con->stream;
 
-    int end_pad = 32;
-    size_t requestMax = 1024 + 13 * API_REQ_LIST_MAX + end_pad;
-    if (request->len > requestMax) {
-        send400(con->fd, con->keepalive);
-        apiResetCon(con, thread);
-        return;
-    }
-    if (!request->alloc) {
-        request->alloc = 2048;
-        request->buffer = realloc(request->buffer, request->alloc);
-    } else if (request->len + end_pad + 512 > request->alloc) {
-        request->alloc = requestMax;
-        request->buffer = realloc(request->buffer, request->alloc);
-    }
-    if (!request->buffer) {
-        fprintf(stderr, "FATAL: apiReadRequest request->buffer malloc fail\n");
-        setExit(2);
-        send503(con->fd, con->keepalive);
-        apiCloseCon(con, thread);
+    // still sending the previous update, the next one will include what changed in the meantime
+    if (con->replyCount) {
         return;
     }
-    toRead = (request->alloc - end_pad) - request->len;
-    nread = recv(fd, request->buffer + request->len, toRead, 0);
-
-    if (Modes.debug_api) {
-        fprintf(stderr, "%d %d nread %d\n", thread->index, con->fd, nread);
-    }
-
-    if (nread < 0) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
-            return;
-        }
-        apiShutdown(con, thread, __LINE__, errno);
+    if (thread->responseBytesBuffered > 512 * 1024 * 1024) {
         return;
     }
 
-    if (nread == 0) {
-        apiShutdown(con, thread, __LINE__, 0);
+    int flip = atomic_load(&Modes.apiFlip[thread->index]);
+    struct apiBuffer *buffer = &Modes.apiBuffer[flip];
+    if (buffer->timestamp == stream->timestamp) {
         return;
     }
 
-    if (con->reply.buffer) {
-        int toSend = con->reply.len - con->bytesSent;
-        fprintf(stderr, "wat?! reply buffer but got new request data. toSend: %d\n", toSend);
+    int pad = 16; // room for the chunk size line
+    struct char_buffer reply = apiStreamDelta(thread, buffer, stream, pad);
+    if (reply.len == 0) {
+        if (antiSpam(&thread->antiSpam[8], 5 * SECONDS)) {
+            fprintf(stderr, "apiStreamSend: out of memory, closing stream\n");
+        }
         apiCloseCon(con, thread);
         return;
     }
 
-    int oldlen = request->len;
-
-    if (nread > 0) {
-        request->len += nread;
-        // terminate string
-        request->buffer[request->len] = '\0';
+    int start = pad;
+    if (stream->chunked) {
+        char line[16];
+        int n = snprintf(line, sizeof(line), "%x\r\n", (unsigned) (reply.len - pad));
+        start = pad - n;
+        memcpy(reply.buffer + start, line, n);
+        // apiStreamDelta leaves room for the CRLF terminating the chunk
+        memcpy(reply.buffer + reply.len, "\r\n", 2);
+        reply.len += 2;
     }
 
+    apiQueueReply(con, thread, reply, start);
+    apiFlush(con, thread);
+}
+
+// called when apiUpdate has published a new buffer
+static void apiStreamUpdate(struct apiThread *thread) {
+    uint64_t count;
+    ssize_t res = read(thread->eventfd, &count, sizeof(count));
+    MODES_NOTUSED(res);
+
+    for (int j = 0; j < Modes.api_fds_per_thread; j++) {
+        struct apiCon *con = &thread->cons[j];
+        if (con->open && con->stream) {
+            apiStreamSend(con, thread);
+        }
+    }
+}
 
-    int req_len = request->len;
-    char *req_start = request->buffer;
-    char *newline = memchr(req_start + oldlen, '\n', req_len);
-    if (!newline || !strstr(req_start + imax(0, oldlen - 4), "\r\n\r\n")) {
-        // request not complete
+// requests aren't handled on stream connections, discard anything the client sends and watch for it closing
+static void apiStreamRead(struct apiCon *con, struct apiThread *thread) {
+    char discard[512];
+    int nread = recv(con->fd, discard, sizeof(discard), 0);
+    if (nread < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
         return;
     }
+    if (nread <= 0) {
+        if (Modes.debug_api) {
+            fprintf(stderr, "%d %d stream closed\n", thread->index, con->fd);
+        }
+        apiCloseCon(con, thread);
+    }
+}
+
+static void apiShutdown(struct apiCon *con, struct apiThread *thread, int line, int err) {
+    if (con->replyCount || con->request.len) {
+        if (antiSpam(&thread->antiSpam[1], 5 * SECONDS)) {
+            fprintf(stderr, "Connection shutdown with incomplete or no reply sent."
+                    " (replies queued: %d, first reply sent: %d, request.len: %d open: %d line: %d errno: %s)\n",
+                    con->replyCount,
+                    con->replyCount ? (int) con->replies[0].sent : 0,
+                    (int) con->request.len,
+                    con->open,
+                    line,
+                    err ? strerror(err) : "-");
+        }
+    }
+    apiCloseCon(con, thread);
+}
 
+// handle one complete request, req_len includes the terminating empty line
+// the response is queued on the connection, sending is up to the caller
+static void apiHandleRequest(struct apiCon *con, struct apiThread *thread, char *req_start, int req_len) {
+    int end_pad = API_REQ_END_PAD;
+    struct char_buffer req = { .buffer = req_start, .len = req_len };
     thread->requestCount++;
 
-    char *eol = memchr(req_start, '\n', req_len) + 1; // we already know we have at least one newline
+    char *eol = memchr(req_start, '\n', req_len) + 1; // the request ends in \r\n\r\n, there is at least one newline
     char *req_end = req_start + req_len;
     char *protocol = eol - litLen("HTTP/1.x\r\n"); // points to H
     if (protocol < req_start) {
-        send505(con->fd, con->keepalive);
-        apiResetCon(con, thread);
+        send505(con, thread);
         return;
     }
 
@@ -1534,8 +2742,7 @@ static void apiReadRequest(struct apiCon *con, struct apiThread *thread) {
     int isGET = byteMatchStart(req_start, "GET");
     char *http_minor_version = protocol + litLen("HTTP/1.");
     if (!byteMatchStart(protocol, "HTTP/1.") || !((*http_minor_version == '0') || (*http_minor_version == '1'))) {
-        send505(con->fd, con->keepalive);
-        apiResetCon(con, thread);
+        send505(con, thread);
         return;
     }
     con->http_minor_version = (*http_minor_version == '1') ? 1 : 0;
@@ -1570,8 +2777,7 @@ static void apiReadRequest(struct apiCon *con, struct apiThread *thread) {
     }
 
     if (!isGET) {
-        send405(con->fd, con->keepalive);
-        apiResetCon(con, thread);
+        send405(con, thread);
         return;
     }
     //fprintf(stderr, "%s\n", request->buffer);
@@ -1587,25 +2793,30 @@ static void apiReadRequest(struct apiCon *con, struct apiThread *thread) {
     char *status = protocol - litLen("?status ");
     if (status > req_start && byteMatchStart(status, "?status ")) {
         if (Modes.exitSoon) {
-            send503(con->fd, con->keepalive);
+            send503(con, thread);
         } else {
-            send200(con->fd, con->keepalive);
+            send200(con, thread);
         }
-        apiResetCon(con, thread);
         return;
     }
 
+    // parseFetch splits the query in place, keep a copy for the slow query log
+    char url[256];
+    int urlLen = 0;
+    if (Modes.apiSlowQuery) {
+        char *urlStart = req_start + litLen("GET ");
+        urlLen = imin(sizeof(url), imax(0, (protocol - 1) - urlStart));
+        memcpy(url, urlStart, urlLen);
+    }
+
     con->content_type = "multipart/mixed";
-    struct char_buffer reply = parseFetch(con, request, options, thread);
+    struct char_buffer reply = parseFetch(con, &req, options, thread);
     if (reply.len == 0) {
         //fprintf(stderr, "parseFetch returned invalid\n");
-        send400(con->fd, con->keepalive);
-        apiResetCon(con, thread);
+        send400(con, thread);
         return;
     }
 
-    thread->responseBytesBuffered += reply.len;
-
     // at header before payload
     char header[API_REQ_PADSTART];
     char *p = header;
@@ -1613,38 +2824,178 @@ static void apiReadRequest(struct apiCon *con, struct apiThread *thread) {
 
     int content_len = reply.len - API_REQ_PADSTART;
 
-    p = safe_snprintf(p, end,
-            "HTTP/1.1 200 OK\r\n"
-            "Server: readsb/wiedehopf\r\n"
-            "%s"
-            "Content-Type: %s\r\n"
-            "Connection: %s\r\n"
-            "Cache-Control: no-store\r\n"
-            "%s"
-            "Content-Length: %d\r\n\r\n",
-            con->include_version ? "readsb_version: "MODES_READSB_VERSION"\r\n" : "",
-            con->content_type,
-            con->keepalive ? "keep-alive" : "close",
-            options->zstd_encode ? "Content-Encoding: zstd\r\n" : "",
-            content_len);
+    if (con->stream) {
+        // no Content-Length, updates are sent as they become available
+        p = safe_snprintf(p, end,
+                "HTTP/1.1 200 OK\r\n"
+                "Server: readsb/wiedehopf\r\n"
+                "%s"
+                "Content-Type: %s\r\n"
+                "Connection: %s\r\n"
+                "Cache-Control: no-store\r\n"
+                "%s\r\n",
+                con->include_version ? "readsb_version: "MODES_READSB_VERSION"\r\n" : "",
+                con->content_type,
+                con->stream->chunked ? "keep-alive" : "close",
+                con->stream->chunked ? "Transfer-Encoding: chunked\r\n" : "");
+    } else {
+        p = safe_snprintf(p, end,
+                "HTTP/1.1 200 OK\r\n"
+                "Server: readsb/wiedehopf\r\n"
+                "%s"
+                "Content-Type: %s\r\n"
+                "Connection: %s\r\n"
+                "Cache-Control: no-store\r\n"
+                "%s"
+                "Content-Length: %d\r\n\r\n",
+                con->include_version ? "readsb_version: "MODES_READSB_VERSION"\r\n" : "",
+                con->content_type,
+                con->keepalive ? "keep-alive" : "close",
+                options->zstd_encode ? "Content-Encoding: zstd\r\n" : "",
+                content_len);
+    }
+
+    if (!con->stream) {
+        apiRecordLatency(thread, options, url, urlLen);
+    }
 
     int hlen = p - header;
     //fprintf(stderr, "hlen %d\n", hlen);
     if (hlen >= API_REQ_PADSTART) {
         fprintf(stderr, "API error: API_REQ_PADSTART insufficient\n");
-        send500(con->fd, con->keepalive);
-        apiResetCon(con, thread);
+        apiPoolPut(thread, &reply);
+        send500(con, thread);
         return;
     }
 
-    // increase bytesSent counter so we don't transmit the empty buffer before the header
-    con->bytesSent = API_REQ_PADSTART - hlen;
+    // start sending after the unused part of the padding so we don't transmit the empty buffer before the header
+    size_t start = API_REQ_PADSTART - hlen;
     // copy the header into the correct position immediately before the payload (which we already have)
-    memcpy(reply.buffer + con->bytesSent, header, hlen);
+    memcpy(reply.buffer + start, header, hlen);
+
+    apiQueueReply(con, thread, reply, start);
+}
+// handle the complete requests in the request buffer, pipelined requests are answered in order
+// and their responses sent together
+static void apiProcessRequests(struct apiCon *con, struct apiThread *thread) {
+    struct char_buffer *request = &con->request;
+    while (con->open && !con->stream) {
+        int handled = 0;
+        while (con->replyCount < API_PIPELINE_MAX && request->len > 0) {
+            char *req_start = request->buffer;
+            char *eoh = memmem(req_start, request->len, "\r\n\r\n", 4);
+            if (!eoh) {
+                // request not complete
+                break;
+            }
+            int req_len = eoh + 4 - req_start;
+            int rest = request->len - req_len;
+
+            // the request is parsed in place and padded with zeros, keep the start of a pipelined request following it
+            char saved[API_REQ_END_PAD];
+            memcpy(saved, req_start + req_len, API_REQ_END_PAD);
+            apiHandleRequest(con, thread, req_start, req_len);
+            memcpy(req_start + req_len, saved, API_REQ_END_PAD);
+            handled++;
+
+            if (!con->keepalive || con->stream) {
+                // no further requests on this connection
+                rest = 0;
+            }
+            memmove(req_start, req_start + req_len, rest);
+            request->len = rest;
+            request->buffer[request->len] = '\0';
+        }
+        if (!con->replyCount) {
+            return;
+        }
+        apiFlush(con, thread);
+        if (!con->open || con->replyCount) {
+            // closed or waiting for EPOLLOUT
+            return;
+        }
+        if (con->stream) {
+            apiStreamSend(con, thread);
+            return;
+        }
+        if (!handled) {
+            return;
+        }
+    }
+}
+
+static void apiReadRequest(struct apiCon *con, struct apiThread *thread) {
+
+    if (con->stream) {
+        apiStreamRead(con, thread);
+        return;
+    }
+
+    // delay processing requests until we have more memory
+    if (thread->responseBytesBuffered > 512 * 1024 * 1024) {
+        if (antiSpam(&thread->antiSpam[2], 5 * SECONDS)) {
+            fprintf(stderr, "Delaying request processing due to per thread memory limit: 512 MB\n");
+        }
+        return;
+    }
+
+    int nread, toRead;
+    int fd = con->fd;
+
+    struct char_buffer *request = &con->request;
+
+    int end_pad = API_REQ_END_PAD;
+    size_t requestMax = 1024 + 13 * API_REQ_LIST_MAX + end_pad;
+    if (request->len > requestMax) {
+        con->keepalive = 0;
+        send400(con, thread);
+        request->len = 0;
+        apiSendData(con, thread);
+        return;
+    }
+    if (!request->alloc) {
+        request->alloc = 2048;
+        request->buffer = realloc(request->buffer, request->alloc);
+    } else if (request->len + end_pad + 512 > request->alloc) {
+        request->alloc = requestMax;
+        request->buffer = realloc(request->buffer, request->alloc);
+    }
+    if (!request->buffer) {
+        fprintf(stderr, "FATAL: apiReadRequest request->buffer malloc fail\n");
+        setExit(2);
+        sendStatus(con->fd, "503 Service Unavailable");
+        apiCloseCon(con, thread);
+        return;
+    }
+    toRead = (request->alloc - end_pad) - request->len;
+    nread = recv(fd, request->buffer + request->len, toRead, 0);
+
+    if (Modes.debug_api) {
+        fprintf(stderr, "%d %d nread %d\n", thread->index, con->fd, nread);
+    }
+
+    if (nread < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return;
+        }
+        apiShutdown(con, thread, __LINE__, errno);
+        return;
+    }
+
+    if (nread == 0) {
+        apiShutdown(con, thread, __LINE__, 0);
+        return;
+    }
+
+    if (nread > 0) {
+        request->len += nread;
+        // terminate string
+        request->buffer[request->len] = '\0';
+    }
 
-    con->reply = reply;
-    apiSendData(con, thread);
+    apiProcessRequests(con, thread);
 }
+
 static void acceptCon(struct apiCon *con, struct apiThread *thread) {
     int listen_fd = con->fd;
     struct sockaddr_storage storage;
@@ -1698,7 +3049,7 @@ static void acceptCon(struct apiCon *con, struct apiThread *thread) {
             if (antiSpam(&thread->antiSpam[4], 5 * SECONDS)) {
                 fprintf(stderr, "too many concurrent connections, rejecting new connections, sendng 503s :/\n");
             }
-            send503(fd, 0);
+            sendStatus(fd, "503 Service Unavailable");
             if (shutClose(fd) != 0) {
                 if (antiSpam(&thread->antiSpam[4], 5 * SECONDS)) {
                     perror("accept: shutClose failed when rejecting a new connection:");
@@ -1754,6 +3105,12 @@ static void *apiThreadEntryPoint(void *arg) {
 
     thread->epfd = my_epoll_create(&Modes.exitNowEventfd);
 
+    struct epoll_event streamEvent = { .events = EPOLLIN };
+    streamEvent.data.ptr = &thread->eventfd;
+    if (epoll_ctl(thread->epfd, EPOLL_CTL_ADD, thread->eventfd, &streamEvent)) {
+        perror("apiThreadEntryPoint() epoll_ctl fail:");
+    }
+
     for (int i = 0; i < Modes.apiService.listener_count; ++i) {
         struct apiCon *con = Modes.apiListeners[i];
         struct epoll_event epollEvent = { .events = con->events };
@@ -1791,6 +3148,20 @@ static void *apiThreadEntryPoint(void *arg) {
             unsigned int requestCount = thread->requestCount;
             atomic_fetch_add(&Modes.apiRequestCounter, requestCount);
             thread->requestCount = 0;
+
+            atomic_fetch_add(&Modes.apiCacheHitCounter, thread->cacheHits);
+            atomic_fetch_add(&Modes.apiCacheMissCounter, thread->cacheMisses);
+            thread->cacheHits = 0;
+            thread->cacheMisses = 0;
+
+            for (int type = 0; type < API_QUERY_TYPES; type++) {
+                for (int bucket = 0; bucket < API_LATENCY_BUCKETS; bucket++) {
+                    if (thread->latency[type][bucket]) {
+                        atomic_fetch_add(&Modes.apiLatency[type][bucket], thread->latency[type][bucket]);
+                        thread->latency[type][bucket] = 0;
+                    }
+                }
+            }
         }
 
         for (int i = 0; i < count; i++) {
@@ -1798,6 +3169,11 @@ static void *apiThreadEntryPoint(void *arg) {
             if (event.data.ptr == &Modes.exitNowEventfd)
                 continue;
 
+            if (event.data.ptr == &thread->eventfd) {
+                apiStreamUpdate(thread);
+                continue;
+            }
+
             struct apiCon *con = event.data.ptr;
             if (con->accept && (event.events & EPOLLIN)) {
                 acceptCon(con, thread);
@@ -1817,7 +3193,7 @@ static void *apiThreadEntryPoint(void *arg) {
                 if (event.events & EPOLLIN) {
                     apiReadRequest(con, thread);
                 }
-                if (event.events & EPOLLOUT) {
+                if (con->open && (event.events & EPOLLOUT)) {
                     apiSendData(con, thread);
                 }
             }
@@ -1825,15 +3201,14 @@ static void *apiThreadEntryPoint(void *arg) {
             if (con->wakeups++ > 512 * 1024) {
                 if (antiSpam(&thread->antiSpam[7], 5 * SECONDS)) {
                     fprintf(stderr, "connection triggered too many events (bad webserver logic), send 500 :/ (EPOLLIN: %d, EPOLLOUT: %d) "
-                            "(reply.len: %d, bytesSent: %d, request.len: %d open: %d)\n",
+                            "(replies queued: %d, request.len: %d open: %d)\n",
                             (event.events & EPOLLIN), (event.events & EPOLLOUT),
-                            (int) con->reply.len,
-                            (int) con->bytesSent,
+                            con->replyCount,
                             (int) con->request.len,
                             con->open);
                 }
 
-                send500(con->fd, con->keepalive);
+                sendStatus(con->fd, "500 Internal Server Error");
                 apiCloseCon(con, thread);
                 continue;
             }
@@ -1852,6 +3227,8 @@ static void *apiThreadEntryPoint(void *arg) {
     sfree(events);
 
     ZSTD_freeCCtx(thread->cctx);
+    apiCacheFlush(&thread->cache, 0);
+    apiPoolDestroy(thread);
     close(thread->epfd);
 
     sfree(thread->stack);
@@ -1925,6 +3302,18 @@ void apiBufferInit() {
     Modes.apiThread = cmalloc(size);
     memset(Modes.apiThread, 0x0, size);
 
+    for (int i = 0; i < Modes.apiThreadCount; i++) {
+        Modes.apiThread[i].eventfd = eventfd(0, EFD_NONBLOCK);
+    }
+
+    size = sizeof(struct apiUpdatePart) * Modes.apiUpdateThreads;
+    Modes.apiUpdateParts = cmalloc(size);
+    memset(Modes.apiUpdateParts, 0x0, size);
+    if (Modes.apiUpdateThreads > 1) {
+        Modes.apiUpdateTasks = allocate_task_group(Modes.apiUpdateThreads);
+        Modes.apiUpdatePool = threadpool_create(Modes.apiUpdateThreads, 0);
+    }
+
     size = sizeof(atomic_int) * Modes.apiThreadCount;
     Modes.apiFlip = cmalloc(size);
     memset(Modes.apiFlip, 0x0, size);
@@ -1934,6 +3323,12 @@ void apiBufferInit() {
         buffer->hexHash = cmalloc(API_BUCKETS * sizeof(struct apiEntry*));
         buffer->regHash = cmalloc(API_BUCKETS * sizeof(struct apiEntry*));
         buffer->callsignHash = cmalloc(API_BUCKETS * sizeof(struct apiEntry*));
+        buffer->grid.cellStart = cmalloc((API_GRID_CELLS + 1) * sizeof(int32_t));
+        buffer->grid_flag.cellStart = cmalloc((API_GRID_CELLS + 1) * sizeof(int32_t));
+        buffer->typeIndex.start = cmalloc((API_TYPE_BUCKETS + 1) * sizeof(int32_t));
+        buffer->squawkIndex.start = cmalloc((API_SQUAWK_BUCKETS + 1) * sizeof(int32_t));
+        buffer->flagIndex.start = cmalloc((API_FLAG_BUCKETS + 1) * sizeof(int32_t));
+        buffer->globeIndex.start = cmalloc((GLOBE_MAX_INDEX + 2) * sizeof(int32_t));
     }
     apiUpdate(); // run an initial apiUpdate
 
@@ -1954,12 +3349,41 @@ void apiBufferCleanup() {
     for (int i = 0; i < 2; i++) {
         sfree(Modes.apiBuffer[i].list);
         sfree(Modes.apiBuffer[i].list_flag);
+        sfree(Modes.apiBuffer[i].list_fresh);
+        sfree(Modes.apiBuffer[i].reused);
         sfree(Modes.apiBuffer[i].json);
         sfree(Modes.apiBuffer[i].hexHash);
         sfree(Modes.apiBuffer[i].regHash);
         sfree(Modes.apiBuffer[i].callsignHash);
-    }
+        sfree(Modes.apiBuffer[i].grid.cellStart);
+        sfree(Modes.apiBuffer[i].grid_flag.cellStart);
+        sfree(Modes.apiBuffer[i].grid.entries);
+        sfree(Modes.apiBuffer[i].grid_flag.entries);
+        sfree(Modes.apiBuffer[i].typeIndex.start);
+        sfree(Modes.apiBuffer[i].typeIndex.entries);
+        sfree(Modes.apiBuffer[i].squawkIndex.start);
+        sfree(Modes.apiBuffer[i].squawkIndex.entries);
+        sfree(Modes.apiBuffer[i].flagIndex.start);
+        sfree(Modes.apiBuffer[i].flagIndex.entries);
+        sfree(Modes.apiBuffer[i].globeIndex.start);
+        sfree(Modes.apiBuffer[i].globeIndex.entries);
+        sfree(Modes.apiBuffer[i].altSorted);
+    }
+
+    if (Modes.apiUpdatePool) {
+        threadpool_destroy(Modes.apiUpdatePool);
+        destroy_task_group(Modes.apiUpdateTasks);
+        Modes.apiUpdatePool = NULL;
+        Modes.apiUpdateTasks = NULL;
+    }
+    for (int k = 0; k < Modes.apiUpdateThreads; k++) {
+        sfree(Modes.apiUpdateParts[k].json);
+    }
+    sfree(Modes.apiUpdateParts);
 
+    for (int i = 0; i < Modes.apiThreadCount; i++) {
+        close(Modes.apiThread[i].eventfd);
+    }
     sfree(Modes.apiThread);
     sfree(Modes.apiFlip);
 }
@@ -2065,6 +3489,19 @@ struct char_buffer apiGenerateAircraftJson(threadpool_buffer_t *pbuffer) {
     return cb;
 }
 
+static struct tile globeTileBounds(int globe_index) {
+    if (globe_index >= GLOBE_MIN_INDEX) {
+        int grid = GLOBE_INDEX_GRID;
+        int lat = ((globe_index - GLOBE_MIN_INDEX) / GLOBE_LAT_MULT) * grid - 90;
+        int lon = ((globe_index - GLOBE_MIN_INDEX) % GLOBE_LAT_MULT) * grid - 180;
+        return (struct tile) { lat, lon, lat + grid, lon + grid };
+    }
+    if (globe_index >= 0) {
+        return Modes.json_globe_special_tiles[globe_index];
+    }
+    return (struct tile) { -90, -180, 90, 180 };
+}
+
 struct char_buffer apiGenerateGlobeJson(int globe_index, threadpool_buffer_t *pbuffer) {
     assert (globe_index <= GLOBE_MAX_INDEX);
 
@@ -2074,12 +3511,26 @@ struct char_buffer apiGenerateGlobeJson(int globe_index, threadpool_buffer_t *pb
 
     struct apiBuffer *buffer = &Modes.apiBuffer[flip];
 
-    ssize_t alloc = 16 * 1024 + buffer->jsonLen;
+    int32_t *entries = NULL;
+    int count = 0;
+    if (globe_index >= 0) {
+        entries = buffer->globeIndex.entries + buffer->globeIndex.start[globe_index];
+        count = indexBucketLen(&buffer->globeIndex, globe_index);
+    }
+
+    ssize_t alloc = 16 * 1024;
+    for (int j = 0; j < count; j++) {
+        alloc += buffer->list[entries[j]].jsonOffset.len;
+    }
 
     char *buf = check_grow_threadpool_buffer_t(pbuffer, alloc);
     char *p = buf;
     char *end = buf + alloc;
 
+    if (!buf) {
+        return cb;
+    }
+
     p = safe_snprintf(p, end,
             "{ \"now\" : %.3f,\n"
             "  \"messages\" : %u,\n",
@@ -2091,41 +3542,23 @@ struct char_buffer apiGenerateGlobeJson(int globe_index, threadpool_buffer_t *pb
             Modes.globalStatsCount.readsb_aircraft_with_position
             );
 
+    struct tile tile = globeTileBounds(globe_index);
     p = safe_snprintf(p, end, "  \"globeIndex\" : %d, ", globe_index);
-    if (globe_index >= GLOBE_MIN_INDEX) {
-        int grid = GLOBE_INDEX_GRID;
-        int lat = ((globe_index - GLOBE_MIN_INDEX) / GLOBE_LAT_MULT) * grid - 90;
-        int lon = ((globe_index - GLOBE_MIN_INDEX) % GLOBE_LAT_MULT) * grid - 180;
-        p = safe_snprintf(p, end,
-                "\"south\" : %d, "
-                "\"west\" : %d, "
-                "\"north\" : %d, "
-                "\"east\" : %d,\n",
-                lat,
-                lon,
-                lat + grid,
-                lon + grid);
-    } else {
-        struct tile *tiles = Modes.json_globe_special_tiles;
-        struct tile tile = tiles[globe_index];
-        p = safe_snprintf(p, end,
-                "\"south\" : %d, "
-                "\"west\" : %d, "
-                "\"north\" : %d, "
-                "\"east\" : %d,\n",
-                tile.south,
-                tile.west,
-                tile.north,
-                tile.east);
-    }
+    p = safe_snprintf(p, end,
+            "\"south\" : %d, "
+            "\"west\" : %d, "
+            "\"north\" : %d, "
+            "\"east\" : %d,\n",
+            tile.south,
+            tile.west,
+            tile.north,
+            tile.east);
 
     p = safe_snprintf(p, end, "  \"aircraft\" : [");
 
-    for (int j = 0; j < buffer->len; j++) {
-
-        struct apiEntry *entry = &buffer->list[j];
-        if (entry->globe_index != globe_index)
-            continue;
+    // the globe index posting list holds the entries of this tile in list order
+    for (int j = 0; j < count; j++) {
+        struct apiEntry *entry = &buffer->list[entries[j]];
 
         // check if we have enough space
         if (p + entry->jsonOffset.len >= end) {
@@ -2135,7 +3568,6 @@ struct char_buffer apiGenerateGlobeJson(int globe_index, threadpool_buffer_t *pb
 
         memcpy(p, buffer->json + entry->jsonOffset.offset, entry->jsonOffset.len);
         p += entry->jsonOffset.len;
-
     }
 
     // json objects in cache are terminated by a comma: \n{ .... },
@@ -2148,3 +3580,148 @@ struct char_buffer apiGenerateGlobeJson(int globe_index, threadpool_buffer_t *pb
     cb.buffer = buf;
     return cb;
 }
+
+#define memWrite(p, var) do { memcpy(p, &var, sizeof(var)); p += sizeof(var); } while(0)
+
+// the binCraft header has the size of one element
+static char *apiBinHeader(char *p, struct apiBuffer *buffer, uint32_t index, struct tile tile, int32_t receiver_lat, int32_t receiver_lon) {
+    char *start = p;
+    uint32_t elementSize = sizeof(struct binCraft);
+    memset(p, 0, elementSize);
+
+    int64_t now = buffer->timestamp;
+    memWrite(p, now);
+
+    memWrite(p, elementSize);
+
+    uint32_t ac_count_pos = Modes.globalStatsCount.readsb_aircraft_with_position;
+    memWrite(p, ac_count_pos);
+
+    memWrite(p, index);
+
+    int16_t south = tile.south;
+    int16_t west = tile.west;
+    int16_t north = tile.north;
+    int16_t east = tile.east;
+
+    memWrite(p, south);
+    memWrite(p, west);
+    memWrite(p, north);
+    memWrite(p, east);
+
+    uint32_t messageCount = Modes.stats_current.messages_total + Modes.stats_alltime.messages_total;
+    memWrite(p, messageCount);
+
+    memWrite(p, receiver_lat);
+    memWrite(p, receiver_lon);
+
+    memWrite(p, Modes.binCraftVersion);
+
+    if (p - start > (int) elementSize)
+        fprintf(stderr, "apiBinHeader: header too large\n");
+
+    return start + elementSize;
+}
+
+#undef memWrite
+
+static inline char *apiBinEntry(char *p, struct apiEntry *entry) {
+    struct binCraft *bin = (struct binCraft *) p;
+    *bin = entry->bin;
+    bin->lat = entry->binLat;
+    bin->lon = entry->binLon;
+    return p + sizeof(struct binCraft);
+}
+
+// aircraft.binCraft from the binCraft records of the apiBuffer
+struct char_buffer apiGenerateAircraftBin(threadpool_buffer_t *pbuffer) {
+    struct char_buffer cb = { 0 };
+
+    int flip = atomic_load(&Modes.apiFlip[0]);
+
+    struct apiBuffer *buffer = &Modes.apiBuffer[flip];
+
+    size_t alloc = (buffer->len + 1) * sizeof(struct binCraft);
+
+    char *buf = check_grow_threadpool_buffer_t(pbuffer, alloc);
+    char *p = buf;
+
+    if (!buf) {
+        return cb;
+    }
+
+    int32_t receiver_lat = 0;
+    int32_t receiver_lon = 0;
+    if (Modes.userLocationValid) {
+        if (Modes.json_location_accuracy == 1) {
+            receiver_lat = (int32_t) (1E4 * nearbyint(Modes.fUserLat * 1E2));
+            receiver_lon = (int32_t) (1E4 * nearbyint(Modes.fUserLon * 1E2));
+        } else if (Modes.json_location_accuracy == 2) {
+            receiver_lat = (int32_t) nearbyint(Modes.fUserLat * 1E6);
+            receiver_lon = (int32_t) nearbyint(Modes.fUserLon * 1E6);
+        }
+    }
+
+    p = apiBinHeader(p, buffer, 314159, globeTileBounds(-1), receiver_lat, receiver_lon);
+
+    for (int j = 0; j < buffer->len; j++) {
+        p = apiBinEntry(p, &buffer->list[j]);
+    }
+
+    cb.len = p - buf;
+    cb.buffer = buf;
+    return cb;
+}
+
+// globe_NNNN.binCraft / globeMil_NNNN.binCraft from the binCraft records of the apiBuffer
+// globe_index -1: all aircraft (globeMil_42777)
+struct char_buffer apiGenerateGlobeBin(int globe_index, int mil, threadpool_buffer_t *pbuffer) {
+    struct char_buffer cb = { 0 };
+
+    if (globe_index < -1 || globe_index > GLOBE_MAX_INDEX) {
+        fprintf(stderr, "apiGenerateGlobeBin: bad globe_index: %d\n", globe_index);
+        return cb;
+    }
+
+    int flip = atomic_load(&Modes.apiFlip[0]);
+
+    struct apiBuffer *buffer = &Modes.apiBuffer[flip];
+
+    int32_t *entries = NULL;
+    int count;
+    struct apiEntry *list;
+    if (globe_index == -1) {
+        // list_flag: entries with a dbFlag set, that's all we need for mil
+        list = mil ? buffer->list_flag : buffer->list;
+        count = mil ? buffer->len_flag : buffer->len;
+    } else {
+        list = buffer->list;
+        entries = buffer->globeIndex.entries + buffer->globeIndex.start[globe_index];
+        count = indexBucketLen(&buffer->globeIndex, globe_index);
+    }
+
+    size_t alloc = (count + 1) * sizeof(struct binCraft);
+
+    char *buf = check_grow_threadpool_buffer_t(pbuffer, alloc);
+    char *p = buf;
+
+    if (!buf) {
+        return cb;
+    }
+
+    uint32_t index = globe_index < 0 ? 42777 : globe_index;
+    p = apiBinHeader(p, buffer, index, globeTileBounds(globe_index), 0, 0);
+
+    for (int j = 0; j < count; j++) {
+        struct apiEntry *entry = &list[entries ? entries[j] : j];
+
+        if (mil && !(entry->bin.dbFlags & 1))
+            continue;
+
+        p = apiBinEntry(p, entry);
+    }
+
+    cb.len = p - buf;
+    cb.buffer = buf;
+    return cb;
+}
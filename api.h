@@ -2,16 +2,51 @@
 #define API_H
 
 #define API_REQ_PADSTART (2048)
+// zeroed bytes after a request while it's parsed
+#define API_REQ_END_PAD (32)
 
 #define API_REQ_LIST_MAX 1024
 
 #define API_ZSTD_LVL (2)
 
+// &fields= columns
+#define API_FIELDS_MAX (64)
+// int64_t now, uint32_t resultCount, uint32_t columnCount
+#define API_COLUMNS_HEADER (16)
+
+#define API_CACHE_KEY_MAX (512)
+#define API_CACHE_ENTRIES (256)
+
+// pipelined requests answered before their responses are sent with one writev
+#define API_PIPELINE_MAX (16)
+
+// per thread pool of response buffers
+#define API_POOL_BUFFERS (16)
+#define API_POOL_MIN_ALLOC (16 * 1024)
+#define API_POOL_MAX_ALLOC (1024 * 1024)
+
+// main query types for the latency histograms (API_QUERY_TYPES)
+enum apiQueryType {
+    API_QUERY_BOX,
+    API_QUERY_CIRCLE,
+    API_QUERY_CLOSEST,
+    API_QUERY_HEXLIST,
+    API_QUERY_REGLIST,
+    API_QUERY_CALLSIGN,
+    API_QUERY_TYPELIST,
+    API_QUERY_ALL,
+};
+
+struct apiReply {
+    struct char_buffer cb;
+    size_t sent; // offset of the first byte not sent yet
+};
+
 struct apiCon {
     int fd;
     int accept;
-    struct char_buffer reply;
-    size_t bytesSent;
+    struct apiReply replies[API_PIPELINE_MAX]; // queued responses in request order
+    int replyCount;
     uint32_t events;
     int open;
     int wakeups;
@@ -21,6 +56,7 @@ struct apiCon {
     struct char_buffer request;
     int64_t lastReset; // milliseconds
     char *content_type;
+    struct apiStream *stream; // set for connections subscribed with &stream
 };
 
 struct apiCircle {
@@ -73,6 +109,12 @@ struct apiOptions {
     char regList[API_REQ_LIST_MAX * 12 + 1];
     int typeCount;
     char typeList[API_REQ_LIST_MAX * 4 + 1];
+    int cacheKeyLen;
+    char cacheKey[API_CACHE_KEY_MAX];
+    int stream;
+    int fieldCount;
+    uint8_t fields[API_FIELDS_MAX]; // indexes into apiFields
+
 };
 
 struct offset {
@@ -92,6 +134,13 @@ struct apiEntry {
     float distance;
     float direction;
     int32_t globe_index;
+    // bin.lat / bin.lon as written by toBinCraft, the entry position is changed for sorting if it's not shown
+    int32_t binLat;
+    int32_t binLon;
+
+    // --api-incremental: when the json was generated and the aircraft message count at that time
+    int64_t jsonTime;
+    uint32_t messages;
 };
 
 struct range {
@@ -99,6 +148,26 @@ struct range {
     int to; // exclusive
 };
 
+// positions bucketed into API_GRID_RES sized lat / lon cells
+// cells are stored row major (by latitude, then longitude), so the cells of one latitude row
+// covering a longitude span are a single contiguous range of entries
+struct apiGrid {
+    int32_t *cellStart; // API_GRID_CELLS + 1 offsets into entries
+    int32_t *entries; // indexes into the list the grid was built for, grouped by cell, longitude sorted within a cell
+};
+
+// posting lists: indexes into apiBuffer.list grouped by a key bucket, ascending (longitude sorted) within a bucket
+// buckets can hold more than one key, the entries still need to be checked
+struct apiIndex {
+    int32_t *start; // buckets + 1 offsets into entries
+    int32_t *entries;
+};
+
+// apiBuffer.list sorted by barometric altitude (as used by above_alt_baro / below_alt_baro)
+struct apiAltEntry {
+    int32_t alt;
+    int32_t index;
+};
 
 struct apiBuffer {
     int len;
@@ -106,8 +175,18 @@ struct apiBuffer {
     int alloc;
     struct apiEntry *list;
     struct apiEntry *list_flag;
+    struct apiEntry *list_fresh; // --api-incremental: entries serialized in this update before merging
+    uint8_t *reused; // --api-incremental: entries of this buffer reused by the next update
     struct range list_pos_range;
     struct range list_flag_pos_range;
+    struct apiGrid grid;
+    struct apiGrid grid_flag;
+    struct apiIndex typeIndex;
+    struct apiIndex squawkIndex;
+    struct apiIndex flagIndex; // one bucket per dbFlags bit, entries with several flags are in several buckets
+    struct apiIndex globeIndex; // by globe_index, the aircraft of a globe tile
+    struct apiAltEntry *altSorted;
+    int altLen;
     int64_t timestamp;
     char *json;
     int jsonLen;
@@ -118,11 +197,63 @@ struct apiBuffer {
     int aircraftJsonCount;
 };
 
+// apiUpdate work split for --api-update-threads
+// serializing: each part converts a slice of the active aircraft and sorts its entries, the parts are then merged
+// json: each part prints a range of the merged list into its own buffer, the buffers are then concatenated
+struct apiUpdatePart {
+    struct apiBuffer *buffer;
+    struct apiBuffer *prev; // --api-incremental
+    struct aircraft **aircraft;
+    int aircraftCount;
+    struct apiEntry *list; // fresh entries, longitude sorted
+    int len;
+    int merged; // entries of list already merged
+    int from; // range of buffer->list for the json
+    int to;
+    char *json;
+    size_t jsonAlloc;
+    size_t jsonLen;
+    int64_t now;
+};
+
+struct apiCacheEntry {
+    uint64_t hash;
+    int keyLen;
+    char *key;
+    struct char_buffer body; // compressed payload, without API_REQ_PADSTART
+};
+
+// per api thread cache of compressed responses, only holds responses for one apiBuffer generation
+struct apiCache {
+    int64_t timestamp; // apiBuffer timestamp of the cached responses
+    size_t bytes;
+    int len;
+    struct apiCacheEntry entries[API_CACHE_ENTRIES];
+};
+
+struct apiStreamEntry {
+    uint32_t hex;
+    uint32_t messages; // aircraft message count when the entry was last sent
+    int32_t index; // into the matches of the current update
+};
+
+// &stream subscription: after each apiUpdate the connection is sent the aircraft matching options
+// that were added or changed (new messages) and the ones that no longer match
+struct apiStream {
+    struct apiOptions options;
+    int64_t timestamp; // apiBuffer timestamp of the last update sent
+    int chunked; // HTTP/1.1: chunked transfer encoding, HTTP/1.0: raw stream until the connection is closed
+    int len;
+    int alloc;
+    struct apiStreamEntry *sent; // aircraft the client currently has, sorted by hex
+};
+
 struct apiThread {
     pthread_t thread;
     int index;
     int epfd;
-    int eventfd;
+    int eventfd; // written by apiUpdate to wake the thread for stream updates
+    atomic_int streamCount;
     int responseBytesBuffered;
     uint32_t requestCount;
     int conCount;
@@ -135,6 +266,13 @@ struct apiThread {
     int64_t request_count;
     int64_t next_bounce;
     int64_t antiSpam[16];
+    struct apiCache cache;
+    uint32_t cacheHits;
+    uint32_t cacheMisses;
+    struct char_buffer pool[API_POOL_BUFFERS];
+    int poolLen;
+    uint32_t latency[API_QUERY_TYPES][API_LATENCY_BUCKETS]; // synced to Modes.apiLatency every second
+    uint32_t slowQueries; // not logged due to rate limiting
 };
 
 void apiBufferInit();
@@ -143,7 +281,13 @@ void apiBufferCleanup();
 void apiInit();
 void apiCleanup();
 
+const char *apiQueryTypeName(int type);
+// upper bound of a latency bucket in microseconds
+int64_t apiLatencyBucketMax(int bucket);
+
 struct char_buffer apiGenerateAircraftJson(threadpool_buffer_t *pbuffer);
 struct char_buffer apiGenerateGlobeJson(int globe_index, threadpool_buffer_t *pbuffer);
+struct char_buffer apiGenerateAircraftBin(threadpool_buffer_t *pbuffer);
+struct char_buffer apiGenerateGlobeBin(int globe_index, int mil, threadpool_buffer_t *pbuffer);
 
 #endif
@@ -419,47 +419,403 @@ static void convert_sc16q11_generic(void *iq_data,
     }
 }
 
+// SIMD versions of the no DC converters, selected at runtime by init_converter()
+//
+// they compute the magnitude in float for 8 (AVX2) or 4 (NEON) samples at once instead of
+// using a lookup table, the UC8 lookup table is 128 kB and the SC16Q11 table is used on ARM
+// where it doesn't fit into L1 cache
+//
+// the UC8 versions produce the same magnitudes as the lookup table (the float division
+// is exact enough for that, multiplying with the reciprocal is not)
+// the float sums for mean level / power are accumulated per lane, so they can differ in
+// the last bits from the scalar versions
+//
+// the DC blocking converters stay scalar, the DC filter is a recursive filter which
+// depends on the previous sample
+
+// scalar tail for the UC8 SIMD versions, same result as uc8_lookup
+static inline uint16_t uc8_mag(uint8_t I, uint8_t Q) {
+    float fI = (I - 127.5f) / 127.5f;
+    float fQ = (Q - 127.5f) / 127.5f;
+    float magsq = fI * fI + fQ * fQ;
+    if (magsq > 1)
+        magsq = 1;
+    return (uint16_t) (sqrtf(magsq) * 65535.0f + 0.5f);
+}
+
+// scalar tail for the SC16 / SC16Q11 SIMD versions
+static inline uint16_t sc16_mag(int16_t I, int16_t Q, float scale, float *sum_level, float *sum_power) {
+    float fI = I * scale;
+    float fQ = Q * scale;
+    float magsq = fI * fI + fQ * fQ;
+    if (magsq > 1)
+        magsq = 1;
+    float mag = sqrtf(magsq);
+    *sum_power += magsq;
+    *sum_level += mag;
+    return (uint16_t) (mag * 65535.0f + 0.5f);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+static bool cpu_has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+// magnitude of 8 samples, returns the 16 bit results packed into the low 128 bits
+__attribute__((target("avx2")))
+static inline __m128i mag_avx2(__m256 fI, __m256 fQ, __m256 *magsq_out, __m256 *mag_out) {
+    __m256 magsq = _mm256_add_ps(_mm256_mul_ps(fI, fI), _mm256_mul_ps(fQ, fQ));
+    magsq = _mm256_min_ps(magsq, _mm256_set1_ps(1.0f));
+    __m256 mag = _mm256_sqrt_ps(magsq);
+    __m256i mag32 = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(mag, _mm256_set1_ps(65535.0f)), _mm256_set1_ps(0.5f)));
+    *magsq_out = magsq;
+    *mag_out = mag;
+    return _mm_packus_epi32(_mm256_castsi256_si128(mag32), _mm256_extracti128_si256(mag32, 1));
+}
+
+__attribute__((target("avx2")))
+static void convert_uc8_nodc_avx2(void *iq_data,
+        uint16_t *mag_data,
+        unsigned nsamples,
+        struct converter_state *state,
+        double *out_mean_level,
+        double *out_mean_power) {
+    uint8_t *in = iq_data;
+    unsigned i;
+
+    MODES_NOTUSED(state);
+
+    const __m256i lowByte = _mm256_set1_epi32(0xFF);
+    const __m256 offset = _mm256_set1_ps(127.5f);
+    const __m256i low32 = _mm256_set1_epi64x(0xFFFFFFFF);
+    // 64 bit sums, even and odd 32 bit lanes
+    __m256i sum_level = _mm256_setzero_si256();
+    __m256i sum_power = _mm256_setzero_si256();
+
+    for (i = 0; i + 8 <= nsamples; i += 8) {
+        __m256i iq = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) in));
+        in += 16;
+        __m256 fI = _mm256_cvtepi32_ps(_mm256_and_si256(iq, lowByte));
+        __m256 fQ = _mm256_cvtepi32_ps(_mm256_srli_epi32(iq, 8));
+        fI = _mm256_div_ps(_mm256_sub_ps(fI, offset), offset);
+        fQ = _mm256_div_ps(_mm256_sub_ps(fQ, offset), offset);
+
+        __m256 magsq, magf;
+        __m128i mag = mag_avx2(fI, fQ, &magsq, &magf);
+        _mm_storeu_si128((__m128i *) mag_data, mag);
+        mag_data += 8;
+
+        __m256i mag32 = _mm256_cvtepu16_epi32(mag);
+        __m256i magOdd = _mm256_srli_epi64(mag32, 32);
+        sum_level = _mm256_add_epi64(sum_level, _mm256_add_epi64(_mm256_and_si256(mag32, low32), magOdd));
+        sum_power = _mm256_add_epi64(sum_power, _mm256_add_epi64(_mm256_mul_epu32(mag32, mag32), _mm256_mul_epu32(magOdd, magOdd)));
+    }
+
+    uint64_t level[4], power[4];
+    _mm256_storeu_si256((__m256i *) level, sum_level);
+    _mm256_storeu_si256((__m256i *) power, sum_power);
+    uint64_t total_level = level[0] + level[1] + level[2] + level[3];
+    uint64_t total_power = power[0] + power[1] + power[2] + power[3];
+
+    for (; i < nsamples; ++i) {
+        uint16_t mag = uc8_mag(in[0], in[1]);
+        in += 2;
+        *mag_data++ = mag;
+        total_level += mag;
+        total_power += (uint32_t) mag * (uint32_t) mag;
+    }
+
+    if (out_mean_level) {
+        *out_mean_level = total_level / 65536.0 / nsamples;
+    }
+
+    if (out_mean_power) {
+        *out_mean_power = total_power / 65535.0 / 65535.0 / nsamples;
+    }
+}
+
+// shared by SC16 and SC16Q11, they only differ in scale
+__attribute__((target("avx2")))
+static inline void convert_sc16_nodc_avx2_scale(uint16_t *in,
+        uint16_t *mag_data,
+        unsigned nsamples,
+        float scale,
+        double *out_mean_level,
+        double *out_mean_power) {
+    unsigned i;
+    const __m256 vscale = _mm256_set1_ps(scale);
+    __m256 sum_level = _mm256_setzero_ps();
+    __m256 sum_power = _mm256_setzero_ps();
+
+    for (i = 0; i + 8 <= nsamples; i += 8) {
+        __m256i iq = _mm256_loadu_si256((__m256i *) in);
+        in += 16;
+        // sign extend the low / high 16 bits of each 32 bit lane
+        __m256 fI = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(iq, 16), 16)), vscale);
+        __m256 fQ = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(iq, 16)), vscale);
+
+        __m256 magsq, mag;
+        _mm_storeu_si128((__m128i *) mag_data, mag_avx2(fI, fQ, &magsq, &mag));
+        mag_data += 8;
+
+        sum_level = _mm256_add_ps(sum_level, mag);
+        sum_power = _mm256_add_ps(sum_power, magsq);
+    }
+
+    float level[8], power[8];
+    _mm256_storeu_ps(level, sum_level);
+    _mm256_storeu_ps(power, sum_power);
+    float total_level = 0, total_power = 0;
+    for (int k = 0; k < 8; k++) {
+        total_level += level[k];
+        total_power += power[k];
+    }
+
+    for (; i < nsamples; ++i) {
+        *mag_data++ = sc16_mag((int16_t) in[0], (int16_t) in[1], scale, &total_level, &total_power);
+        in += 2;
+    }
+
+    if (out_mean_level) {
+        *out_mean_level = total_level / nsamples;
+    }
+
+    if (out_mean_power) {
+        *out_mean_power = total_power / nsamples;
+    }
+}
+
+__attribute__((target("avx2")))
+static void convert_sc16_nodc_avx2(void *iq_data,
+        uint16_t *mag_data,
+        unsigned nsamples,
+        struct converter_state *state,
+        double *out_mean_level,
+        double *out_mean_power) {
+    MODES_NOTUSED(state);
+    convert_sc16_nodc_avx2_scale(iq_data, mag_data, nsamples, 1 / 32768.0f, out_mean_level, out_mean_power);
+}
+
+__attribute__((target("avx2")))
+static void convert_sc16q11_nodc_avx2(void *iq_data,
+        uint16_t *mag_data,
+        unsigned nsamples,
+        struct converter_state *state,
+        double *out_mean_level,
+        double *out_mean_power) {
+    MODES_NOTUSED(state);
+    convert_sc16_nodc_avx2_scale(iq_data, mag_data, nsamples, 1 / 2048.0f, out_mean_level, out_mean_power);
+}
+#endif
+
+// vdivq_f32 / vsqrtq_f32 are only available on aarch64
+#if defined(__ARM_NEON) && defined(__aarch64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#define CONVERT_NEON
+
+static bool cpu_has_neon() {
+    return true;
+}
+
+static inline uint16x4_t mag_neon(float32x4_t fI, float32x4_t fQ, float32x4_t *magsq_out, float32x4_t *mag_out) {
+    float32x4_t magsq = vaddq_f32(vmulq_f32(fI, fI), vmulq_f32(fQ, fQ));
+    magsq = vminq_f32(magsq, vdupq_n_f32(1.0f));
+    float32x4_t mag = vsqrtq_f32(magsq);
+    *magsq_out = magsq;
+    *mag_out = mag;
+    // vcvtq_u32_f32 truncates like the scalar cast
+    return vmovn_u32(vcvtq_u32_f32(vaddq_f32(vmulq_f32(mag, vdupq_n_f32(65535.0f)), vdupq_n_f32(0.5f))));
+}
+
+static void convert_uc8_nodc_neon(void *iq_data,
+        uint16_t *mag_data,
+        unsigned nsamples,
+        struct converter_state *state,
+        double *out_mean_level,
+        double *out_mean_power) {
+    uint8_t *in = iq_data;
+    unsigned i;
+
+    MODES_NOTUSED(state);
+
+    const float32x4_t offset = vdupq_n_f32(127.5f);
+    uint64x2_t sum_level = vdupq_n_u64(0);
+    uint64x2_t sum_power = vdupq_n_u64(0);
+
+    for (i = 0; i + 8 <= nsamples; i += 8) {
+        // de-interleave I and Q
+        uint8x8x2_t iq = vld2_u8(in);
+        in += 16;
+        uint16x8_t I16 = vmovl_u8(iq.val[0]);
+        uint16x8_t Q16 = vmovl_u8(iq.val[1]);
+
+        for (int half = 0; half < 2; half++) {
+            uint16x4_t I = half ? vget_high_u16(I16) : vget_low_u16(I16);
+            uint16x4_t Q = half ? vget_high_u16(Q16) : vget_low_u16(Q16);
+            float32x4_t fI = vdivq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(I)), offset), offset);
+            float32x4_t fQ = vdivq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(Q)), offset), offset);
+
+            float32x4_t magsq, magf;
+            uint16x4_t mag = mag_neon(fI, fQ, &magsq, &magf);
+            vst1_u16(mag_data, mag);
+            mag_data += 4;
+
+            uint32x4_t mag32 = vmovl_u16(mag);
+            sum_level = vpadalq_u32(sum_level, mag32);
+            sum_power = vpadalq_u32(sum_power, vmulq_u32(mag32, mag32));
+        }
+    }
+
+    uint64_t total_level = vgetq_lane_u64(sum_level, 0) + vgetq_lane_u64(sum_level, 1);
+    uint64_t total_power = vgetq_lane_u64(sum_power, 0) + vgetq_lane_u64(sum_power, 1);
+
+    for (; i < nsamples; ++i) {
+        uint16_t mag = uc8_mag(in[0], in[1]);
+        in += 2;
+        *mag_data++ = mag;
+        total_level += mag;
+        total_power += (uint32_t) mag * (uint32_t) mag;
+    }
+
+    if (out_mean_level) {
+        *out_mean_level = total_level / 65536.0 / nsamples;
+    }
+
+    if (out_mean_power) {
+        *out_mean_power = total_power / 65535.0 / 65535.0 / nsamples;
+    }
+}
+
+static inline void convert_sc16_nodc_neon_scale(uint16_t *in,
+        uint16_t *mag_data,
+        unsigned nsamples,
+        float scale,
+        double *out_mean_level,
+        double *out_mean_power) {
+    unsigned i;
+    float32x4_t sum_level = vdupq_n_f32(0);
+    float32x4_t sum_power = vdupq_n_f32(0);
+
+    for (i = 0; i + 4 <= nsamples; i += 4) {
+        int16x4x2_t iq = vld2_s16((int16_t *) in);
+        in += 8;
+        float32x4_t fI = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(iq.val[0])), scale);
+        float32x4_t fQ = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(iq.val[1])), scale);
+
+        float32x4_t magsq, mag;
+        vst1_u16(mag_data, mag_neon(fI, fQ, &magsq, &mag));
+        mag_data += 4;
+
+        sum_level = vaddq_f32(sum_level, mag);
+        sum_power = vaddq_f32(sum_power, magsq);
+    }
+
+    float total_level = vaddvq_f32(sum_level);
+    float total_power = vaddvq_f32(sum_power);
+
+    for (; i < nsamples; ++i) {
+        *mag_data++ = sc16_mag((int16_t) in[0], (int16_t) in[1], scale, &total_level, &total_power);
+        in += 2;
+    }
+
+    if (out_mean_level) {
+        *out_mean_level = total_level / nsamples;
+    }
+
+    if (out_mean_power) {
+        *out_mean_power = total_power / nsamples;
+    }
+}
+
+static void convert_sc16_nodc_neon(void *iq_data,
+        uint16_t *mag_data,
+        unsigned nsamples,
+        struct converter_state *state,
+        double *out_mean_level,
+        double *out_mean_power) {
+    MODES_NOTUSED(state);
+    convert_sc16_nodc_neon_scale(iq_data, mag_data, nsamples, 1 / 32768.0f, out_mean_level, out_mean_power);
+}
+
+static void convert_sc16q11_nodc_neon(void *iq_data,
+        uint16_t *mag_data,
+        unsigned nsamples,
+        struct converter_state *state,
+        double *out_mean_level,
+        double *out_mean_power) {
+    MODES_NOTUSED(state);
+    convert_sc16_nodc_neon_scale(iq_data, mag_data, nsamples, 1 / 2048.0f, out_mean_level, out_mean_power);
+}
+#endif
+
 static struct {
     input_format_t format;
     int can_filter_dc;
     iq_convert_fn fn;
     const char *description;
     bool(*init)();
+    bool(*supported)(); // NULL: always usable, otherwise SIMD version that needs CPU support
 } converters_table[] = {
     // In order of preference
-    { INPUT_UC8, 0, convert_uc8_nodc, "UC8, integer/table path", init_uc8_lookup},
-    { INPUT_UC8, 1, convert_uc8_generic, "UC8, float path", NULL},
-    { INPUT_SC16, 0, convert_sc16_nodc, "SC16, float path, no DC", NULL},
-    { INPUT_SC16, 1, convert_sc16_generic, "SC16, float path", NULL},
+#if defined(__x86_64__) || defined(__i386__)
+    { INPUT_UC8, 0, convert_uc8_nodc_avx2, "UC8, AVX2 float path, no DC", NULL, cpu_has_avx2},
+#endif
+#ifdef CONVERT_NEON
+    { INPUT_UC8, 0, convert_uc8_nodc_neon, "UC8, NEON float path, no DC", NULL, cpu_has_neon},
+#endif
+    { INPUT_UC8, 0, convert_uc8_nodc, "UC8, integer/table path", init_uc8_lookup, NULL},
+    { INPUT_UC8, 1, convert_uc8_generic, "UC8, float path", NULL, NULL},
+#if defined(__x86_64__) || defined(__i386__)
+    { INPUT_SC16, 0, convert_sc16_nodc_avx2, "SC16, AVX2 float path, no DC", NULL, cpu_has_avx2},
+#endif
+#ifdef CONVERT_NEON
+    { INPUT_SC16, 0, convert_sc16_nodc_neon, "SC16, NEON float path, no DC", NULL, cpu_has_neon},
+#endif
+    { INPUT_SC16, 0, convert_sc16_nodc, "SC16, float path, no DC", NULL, NULL},
+    { INPUT_SC16, 1, convert_sc16_generic, "SC16, float path", NULL, NULL},
+#if defined(__x86_64__) || defined(__i386__)
+    { INPUT_SC16Q11, 0, convert_sc16q11_nodc_avx2, "SC16Q11, AVX2 float path, no DC", NULL, cpu_has_avx2},
+#endif
+#ifdef CONVERT_NEON
+    { INPUT_SC16Q11, 0, convert_sc16q11_nodc_neon, "SC16Q11, NEON float path, no DC", NULL, cpu_has_neon},
+#endif
 #if defined(SC16Q11_TABLE_BITS)
-    { INPUT_SC16Q11, 0, convert_sc16q11_table, "SC16Q11, integer/table path", init_sc16q11_lookup},
+    { INPUT_SC16Q11, 0, convert_sc16q11_table, "SC16Q11, integer/table path", init_sc16q11_lookup, NULL},
 #else
-    { INPUT_SC16Q11, 0, convert_sc16q11_nodc, "SC16Q11, float path, no DC", NULL},
+    { INPUT_SC16Q11, 0, convert_sc16q11_nodc, "SC16Q11, float path, no DC", NULL, NULL},
 #endif
-    { INPUT_SC16Q11, 1, convert_sc16q11_generic, "SC16Q11, float path", NULL},
-    { 0, 0, NULL, NULL, NULL}
+    { INPUT_SC16Q11, 1, convert_sc16q11_generic, "SC16Q11, float path", NULL, NULL},
+    { 0, 0, NULL, NULL, NULL, NULL}
 };
 
-iq_convert_fn init_converter(input_format_t format,
-        double sample_rate,
-        int filter_dc,
-        struct converter_state **out_state) {
-    int i;
+static bool converter_usable(int i) {
+    if (!converters_table[i].supported)
+        return true;
+    if (Modes.debug_no_simd)
+        return false;
+    return converters_table[i].supported();
+}
 
-    for (i = 0; converters_table[i].fn; ++i) {
-        if (converters_table[i].format != format)
+const char *converter_info(int n, input_format_t *format, int *filter_dc) {
+    for (int i = 0; converters_table[i].fn; ++i) {
+        if (!converter_usable(i))
             continue;
-        if (filter_dc && !converters_table[i].can_filter_dc)
+        if (n-- > 0)
             continue;
-        break;
-    }
-
-    if (!converters_table[i].fn) {
-        fprintf(stderr, "no suitable converter for format=%d dc=%d\n",
-                format, filter_dc);
-        return NULL;
+        *format = converters_table[i].format;
+        *filter_dc = converters_table[i].can_filter_dc;
+        return converters_table[i].description;
     }
+    return NULL;
+}
 
+static iq_convert_fn init_converter_index(int i,
+        double sample_rate,
+        int filter_dc,
+        struct converter_state **out_state) {
     if (converters_table[i].init) {
         if (!converters_table[i].init())
             return NULL;
@@ -484,11 +840,51 @@ iq_convert_fn init_converter(input_format_t format,
         (*out_state)->dc_a = 0.0;
     }
 
-    if (Modes.sdr_type == SDR_IFILE) {
+    return converters_table[i].fn;
+}
+
+iq_convert_fn init_converter_n(int n,
+        double sample_rate,
+        struct converter_state **out_state) {
+    for (int i = 0; converters_table[i].fn; ++i) {
+        if (!converter_usable(i))
+            continue;
+        if (n-- > 0)
+            continue;
+        return init_converter_index(i, sample_rate, converters_table[i].can_filter_dc, out_state);
+    }
+    return NULL;
+}
+
+iq_convert_fn init_converter(input_format_t format,
+        double sample_rate,
+        int filter_dc,
+        struct converter_state **out_state) {
+    int i;
+
+    for (i = 0; converters_table[i].fn; ++i) {
+        if (converters_table[i].format != format)
+            continue;
+        if (filter_dc && !converters_table[i].can_filter_dc)
+            continue;
+        if (!converter_usable(i))
+            continue;
+        break;
+    }
+
+    if (!converters_table[i].fn) {
+        fprintf(stderr, "no suitable converter for format=%d dc=%d\n",
+                format, filter_dc);
+        return NULL;
+    }
+
+    iq_convert_fn fn = init_converter_index(i, sample_rate, filter_dc, out_state);
+
+    if (fn && Modes.sdr_type == SDR_IFILE) {
         fprintf(stderr, "init_converter: using %s\n", converters_table[i].description);
     }
 
-    return converters_table[i].fn;
+    return fn;
 }
 
 void cleanup_converter(struct converter_state **state) {
@@ -45,4 +45,11 @@ iq_convert_fn init_converter (input_format_t format,
 
 void cleanup_converter (struct converter_state **state);
 
+// for convert_benchmark: enumerate all converters usable on this CPU, n counts from 0,
+// returns NULL after the last one
+const char *converter_info (int n, input_format_t *format, int *filter_dc);
+iq_convert_fn init_converter_n (int n,
+                                double sample_rate,
+                                struct converter_state **out_state);
+
 #endif
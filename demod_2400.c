@@ -212,24 +212,281 @@ static inline __attribute__((always_inline)) uint8_t slice_byte(uint16_t **pPtr,
     return theByte;
 }
 
-static void score_phase(int try_phase, uint16_t *pa, unsigned char **bestmsg, int *bestscore, int *bestphase, unsigned char **msg, unsigned char *msg1, unsigned char *msg2) {
-    Modes.stats_current.demod_preamblePhase[try_phase - 4]++;
-    uint16_t *pPtr;
-    int phase, score, bytelen;
-
-    pPtr = pa + 19 + (try_phase / 5);
-    phase = try_phase % 5;
-
-    (*msg)[0] = slice_byte(&pPtr, &phase);
-
-    // inspect DF field early, only continue processing
-    // messages where the DF appears valid
-    uint32_t df = ((uint8_t) (*msg)[0]) >> 3;
+// inspect DF field early, only continue processing
+// messages where the DF appears valid
+static inline __attribute__((always_inline)) int df_bytelen(uint8_t firstByte) {
+    uint32_t df = firstByte >> 3;
     if (valid_df_long_bitset & (1 << df)) {
-        bytelen = MODES_LONG_MSG_BYTES;
+        return MODES_LONG_MSG_BYTES;
     } else if (valid_df_short_bitset & (1 << df)) {
-        bytelen = MODES_SHORT_MSG_BYTES;
+        return MODES_SHORT_MSG_BYTES;
     } else {
+        return 0;
+    }
+}
+
+// slice a message with the given phase starting at the preamble pa
+// returns the message length in bytes or 0 if the DF is not valid
+static int slice_message_generic(uint16_t *pa, int try_phase, unsigned char *msg) {
+    uint16_t *pPtr = pa + 19 + (try_phase / 5);
+    int phase = try_phase % 5;
+
+    msg[0] = slice_byte(&pPtr, &phase);
+
+    int bytelen = df_bytelen(msg[0]);
+
+    for (int i = 1; i < bytelen; ++i) {
+        msg[i] = slice_byte(&pPtr, &phase);
+    }
+    return bytelen;
+}
+
+// find the next sample position starting at pa that passes the preamble pre-check
+// returns a position >= stop if there is none
+// due to plenty room in the message buffer for decoding we can read beyond stop without a buffer overrun
+static uint16_t *find_preamble_generic(uint16_t *pa, uint16_t *stop) {
+    for (; pa < stop; pa++) {
+        if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) {
+            return pa;
+        }
+    }
+    return pa;
+}
+
+// SIMD versions of the above, selected at runtime by init_dispatch()
+//
+// the preamble pre-check compares 8 (SSE2 / NEON) or 16 (AVX2) candidate positions at once
+//
+// the AVX2 slicer computes all 8 bits of a byte at once:
+// each bit is a correlation c0 * m[o] + c1 * m[o+1] + c2 * m[o+2] + c3 * m[o+3]
+// the sample pairs are gathered as 32 bit values and multiplied with the coefficient pairs using madd
+// madd works on signed 16 bit values, the samples are shifted by -32768 which doesn't change the
+// result for the DC balanced correlation functions, slice_phase2 sums to 1 and gets a correction of +32768
+//
+// the NEON slicer (AArch64) works the same way, instead of a gather the 4 samples of each bit
+// are picked from a 24 sample window with table lookups and multiplied using vmlal
+
+#if defined(__x86_64__) || defined(__i386__) || (defined(__ARM_NEON) && defined(__aarch64__))
+// per phase: sample offset and slice function for each bit of a byte (MSB first), sample advance
+static const struct {
+    int8_t offset[8];
+    int8_t func[8];
+    int8_t advance;
+} slice_layout[5] = {
+    { { 0, 2, 4, 7, 9, 12, 14, 16 }, { 0, 2, 4, 1, 3, 0, 2, 4 }, 19 },
+    { { 0, 2, 5, 7, 9, 12, 14, 17 }, { 1, 3, 0, 2, 4, 1, 3, 0 }, 19 },
+    { { 0, 2, 5, 7, 10, 12, 14, 17 }, { 2, 4, 1, 3, 0, 2, 4, 1 }, 19 },
+    { { 0, 3, 5, 7, 10, 12, 15, 17 }, { 3, 0, 2, 4, 1, 3, 0, 2 }, 19 },
+    { { 0, 3, 5, 8, 10, 12, 15, 17 }, { 4, 1, 3, 0, 2, 4, 1, 3 }, 20 },
+};
+
+// coefficients of slice_phase0 .. slice_phase4
+static const int16_t slice_coeff[5][4] = {
+    { 18, -15, -3, 0 },
+    { 14, -5, -9, 0 },
+    { 16, 5, -20, 0 },
+    { 7, 11, -18, 0 },
+    { 4, 15, -20, 1 },
+};
+
+static struct {
+    int32_t index[5][8]; // lane k holds the bit with value 1 << k
+    int16_t coeffLow[5][16];
+    int16_t coeffHigh[5][16];
+    int32_t bias[5][8];
+    uint8_t bytes[5][4][16]; // NEON: sample o + j of each lane as byte positions in the window
+    int16_t coeff[5][4][8]; // NEON: coefficient j of each lane
+} slice_tables;
+
+static void init_slice_tables() {
+    for (int phase = 0; phase < 5; phase++) {
+        for (int bit = 0; bit < 8; bit++) {
+            int lane = 7 - bit;
+            int func = slice_layout[phase].func[bit];
+            const int16_t *c = slice_coeff[func];
+            slice_tables.index[phase][lane] = slice_layout[phase].offset[bit];
+            slice_tables.coeffLow[phase][2 * lane] = c[0];
+            slice_tables.coeffLow[phase][2 * lane + 1] = c[1];
+            slice_tables.coeffHigh[phase][2 * lane] = c[2];
+            slice_tables.coeffHigh[phase][2 * lane + 1] = c[3];
+            slice_tables.bias[phase][lane] = 32768 * (c[0] + c[1] + c[2] + c[3]);
+            for (int j = 0; j < 4; j++) {
+                int sample = slice_layout[phase].offset[bit] + j;
+                slice_tables.bytes[phase][j][2 * lane] = 2 * sample;
+                slice_tables.bytes[phase][j][2 * lane + 1] = 2 * sample + 1;
+                slice_tables.coeff[phase][j][lane] = c[j];
+            }
+        }
+    }
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+static uint16_t *find_preamble_sse2(uint16_t *pa, uint16_t *stop) {
+    const __m128i zero = _mm_setzero_si128();
+    for (; pa < stop; pa += 8) {
+        __m128i p1 = _mm_loadu_si128((__m128i *) (pa + 1));
+        __m128i p7 = _mm_loadu_si128((__m128i *) (pa + 7));
+        __m128i p12 = _mm_loadu_si128((__m128i *) (pa + 12));
+        __m128i p14 = _mm_loadu_si128((__m128i *) (pa + 14));
+        __m128i p15 = _mm_loadu_si128((__m128i *) (pa + 15));
+        // unsigned a > b is a saturated a - b being non-zero
+        __m128i fail = _mm_or_si128(_mm_cmpeq_epi16(_mm_subs_epu16(p1, p7), zero),
+                _mm_or_si128(_mm_cmpeq_epi16(_mm_subs_epu16(p12, p14), zero),
+                    _mm_cmpeq_epi16(_mm_subs_epu16(p12, p15), zero)));
+        uint32_t pass = ~_mm_movemask_epi8(fail) & 0xFFFF;
+        if (pass) {
+            return pa + __builtin_ctz(pass) / 2;
+        }
+    }
+    return pa;
+}
+
+__attribute__((target("avx2")))
+static uint16_t *find_preamble_avx2(uint16_t *pa, uint16_t *stop) {
+    const __m256i zero = _mm256_setzero_si256();
+    for (; pa < stop; pa += 16) {
+        __m256i p1 = _mm256_loadu_si256((__m256i *) (pa + 1));
+        __m256i p7 = _mm256_loadu_si256((__m256i *) (pa + 7));
+        __m256i p12 = _mm256_loadu_si256((__m256i *) (pa + 12));
+        __m256i p14 = _mm256_loadu_si256((__m256i *) (pa + 14));
+        __m256i p15 = _mm256_loadu_si256((__m256i *) (pa + 15));
+        __m256i fail = _mm256_or_si256(_mm256_cmpeq_epi16(_mm256_subs_epu16(p1, p7), zero),
+                _mm256_or_si256(_mm256_cmpeq_epi16(_mm256_subs_epu16(p12, p14), zero),
+                    _mm256_cmpeq_epi16(_mm256_subs_epu16(p12, p15), zero)));
+        uint32_t pass = ~(uint32_t) _mm256_movemask_epi8(fail);
+        if (pass) {
+            return pa + __builtin_ctz(pass) / 2;
+        }
+    }
+    return pa;
+}
+
+__attribute__((target("avx2")))
+static int slice_message_avx2(uint16_t *pa, int try_phase, unsigned char *msg) {
+    uint16_t *pPtr = pa + 19 + (try_phase / 5);
+    int phase = try_phase % 5;
+    const __m256i flip = _mm256_set1_epi32(0x80008000);
+    const __m256i zero = _mm256_setzero_si256();
+
+    int bytelen = MODES_LONG_MSG_BYTES;
+    for (int i = 0; i < bytelen; ++i) {
+        __m256i index = _mm256_loadu_si256((__m256i *) slice_tables.index[phase]);
+        __m256i low = _mm256_i32gather_epi32((const int *) pPtr, index, 2);
+        __m256i high = _mm256_i32gather_epi32((const int *) (pPtr + 2), index, 2);
+        low = _mm256_xor_si256(low, flip);
+        high = _mm256_xor_si256(high, flip);
+        __m256i sum = _mm256_add_epi32(
+                _mm256_madd_epi16(low, _mm256_loadu_si256((__m256i *) slice_tables.coeffLow[phase])),
+                _mm256_madd_epi16(high, _mm256_loadu_si256((__m256i *) slice_tables.coeffHigh[phase])));
+        sum = _mm256_add_epi32(sum, _mm256_loadu_si256((__m256i *) slice_tables.bias[phase]));
+        msg[i] = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(sum, zero)));
+
+        pPtr += slice_layout[phase].advance;
+        phase = (phase + 1) % 5;
+
+        if (i == 0) {
+            bytelen = df_bytelen(msg[0]);
+        }
+    }
+    return bytelen;
+}
+#endif
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+
+static uint16_t *find_preamble_neon(uint16_t *pa, uint16_t *stop) {
+    for (; pa < stop; pa += 8) {
+        uint16x8_t p12 = vld1q_u16(pa + 12);
+        uint16x8_t pass = vandq_u16(vcgtq_u16(vld1q_u16(pa + 1), vld1q_u16(pa + 7)),
+                vandq_u16(vcgtq_u16(p12, vld1q_u16(pa + 14)), vcgtq_u16(p12, vld1q_u16(pa + 15))));
+        // narrow each 16 bit lane to 8 bits to get a 64 bit mask
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(pass)), 0);
+        if (mask) {
+            return pa + __builtin_ctzll(mask) / 8;
+        }
+    }
+    return pa;
+}
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+static int slice_message_neon(uint16_t *pa, int try_phase, unsigned char *msg) {
+    uint16_t *pPtr = pa + 19 + (try_phase / 5);
+    int phase = try_phase % 5;
+    const uint16x8_t flip = vdupq_n_u16(0x8000);
+    const uint16x8_t weight = { 1, 2, 4, 8, 16, 32, 64, 128 };
+
+    int bytelen = MODES_LONG_MSG_BYTES;
+    for (int i = 0; i < bytelen; ++i) {
+        // offsets go up to 17 and a correlation uses up to 4 samples
+        uint8x16x3_t window;
+        window.val[0] = vreinterpretq_u8_u16(veorq_u16(vld1q_u16(pPtr), flip));
+        window.val[1] = vreinterpretq_u8_u16(veorq_u16(vld1q_u16(pPtr + 8), flip));
+        window.val[2] = vreinterpretq_u8_u16(veorq_u16(vld1q_u16(pPtr + 16), flip));
+        int32x4_t low = vld1q_s32(slice_tables.bias[phase]);
+        int32x4_t high = vld1q_s32(slice_tables.bias[phase] + 4);
+        for (int j = 0; j < 4; j++) {
+            int16x8_t samples = vreinterpretq_s16_u8(vqtbl3q_u8(window, vld1q_u8(slice_tables.bytes[phase][j])));
+            int16x8_t coeff = vld1q_s16(slice_tables.coeff[phase][j]);
+            low = vmlal_s16(low, vget_low_s16(samples), vget_low_s16(coeff));
+            high = vmlal_high_s16(high, samples, coeff);
+        }
+        uint16x8_t set = vcombine_u16(vmovn_u32(vcgtzq_s32(low)), vmovn_u32(vcgtzq_s32(high)));
+        msg[i] = vaddvq_u16(vandq_u16(set, weight));
+
+        pPtr += slice_layout[phase].advance;
+        phase = (phase + 1) % 5;
+
+        if (i == 0) {
+            bytelen = df_bytelen(msg[0]);
+        }
+    }
+    return bytelen;
+}
+#endif
+
+static uint16_t *(*find_preamble)(uint16_t *pa, uint16_t *stop) = find_preamble_generic;
+static int (*slice_message)(uint16_t *pa, int try_phase, unsigned char *msg) = slice_message_generic;
+
+static void init_dispatch() {
+    const char *impl = "generic";
+#if defined(__x86_64__) || defined(__i386__)
+    init_slice_tables();
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        find_preamble = find_preamble_avx2;
+        slice_message = slice_message_avx2;
+        impl = "AVX2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        find_preamble = find_preamble_sse2;
+        impl = "SSE2";
+    }
+#endif
+#ifdef __ARM_NEON
+    find_preamble = find_preamble_neon;
+    impl = "NEON";
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    init_slice_tables();
+    slice_message = slice_message_neon;
+#endif
+    if (Modes.debug_no_simd) {
+        find_preamble = find_preamble_generic;
+        slice_message = slice_message_generic;
+        impl = "generic";
+    }
+    fprintf(stderr, "demodulate2400: using %s implementation\n", impl);
+}
+
+static void score_phase(int try_phase, uint16_t *pa, unsigned char **bestmsg, int *bestscore, int *bestphase, unsigned char **msg, unsigned char *msg1, unsigned char *msg2) {
+    int score;
+
+    int bytelen = slice_message(pa, try_phase, *msg);
+    if (!bytelen) {
         score = -2;
         if (score > *bestscore) {
             // this is only for preamble stats
@@ -238,10 +495,6 @@ static void score_phase(int try_phase, uint16_t *pa, unsigned char **bestmsg, in
         return;
     }
 
-    for (int i = 1; i < bytelen; ++i) {
-        (*msg)[i] = slice_byte(&pPtr, &phase);
-    }
-
     // Score the mode S message and see if it's any good.
     score = scoreModesMessage(*msg, bytelen * 8);
     if (score > *bestscore) {
@@ -257,11 +510,150 @@ static void score_phase(int try_phase, uint16_t *pa, unsigned char **bestmsg, in
     }
 }
 
+// phase groups tried by demod_scan() for a preamble
+#define PHASES_3_4 (1)
+#define PHASES_5_6 (2)
+#define PHASES_7 (4)
+
+// a preamble found by demod_scan() in a window, decoded later by demod_accept()
+struct demodCandidate {
+    uint32_t offset; // sample offset of the preamble in the mag_buf
+    int16_t score; // negative: no usable message, only counted in the stats
+    int8_t phase;
+    uint8_t tried; // PHASES_ bits
+    unsigned char msg[MODES_LONG_MSG_BYTES];
+};
+
+// a part of the mag_buf demodulated by one thread, see demodulate2400Parallel()
+struct demodWindow {
+    struct mag_buf *mag;
+    uint32_t from; // preamble search starts at this sample offset
+    uint32_t to; // and ends before this sample offset
+    struct demodCandidate *candidates;
+    int count;
+    int alloc;
+};
+
+// preamble stats for one sample offset, returns 1 if there is a message to decode
+static int demod_count_preamble(int tried, int bestscore) {
+    if (tried & PHASES_3_4) {
+        Modes.stats_current.demod_preamblePhase[0]++;
+        Modes.stats_current.demod_preamblePhase[1]++;
+    }
+    if (tried & PHASES_5_6) {
+        Modes.stats_current.demod_preamblePhase[2]++;
+        Modes.stats_current.demod_preamblePhase[3]++;
+    }
+    if (tried & PHASES_7) {
+        Modes.stats_current.demod_preamblePhase[4]++;
+    }
+
+    // no preamble detected
+    if (bestscore == -42)
+        return 0;
+
+    // we had at least one phase greater than the preamble threshold
+    // and used scoremodesmessage on those bytes
+    Modes.stats_current.demod_preambles++;
+
+    // Do we have a candidate?
+    if (bestscore < 0) {
+        if (bestscore == -1)
+            Modes.stats_current.demod_rejected_unknown_icao++;
+        else
+            Modes.stats_current.demod_rejected_bad++;
+        return 0; // nope.
+    }
+    return 1;
+}
+
+// Decode a candidate message and pass it to the next layer
+// returns the number of samples to skip after the preamble or -1 if the message was rejected
+static int demod_accept(struct mag_buf *mag, uint16_t *pa, unsigned char *bestmsg, int bestscore, int bestphase, uint64_t *sum_scaled_signal_power) {
+    uint16_t *m = mag->data;
+    int msglen = modesMessageLenByType(getbits(bestmsg, 1, 5));
+
+    struct modesMessage *mm = netGetMM(&Modes.netMessageBuffer[0]);
+
+    // For consistency with how the Beast / Radarcape does it,
+    // we report the timestamp at the end of bit 56 (even if
+    // the frame is a 112-bit frame)
+    mm->timestamp = mag->sampleTimestamp + (pa -m) * 5 + (8 + 56) * 12 + bestphase;
+
+    // compute message receive time as block-start-time + difference in the 12MHz clock
+    mm->sysTimestamp = mag->sysTimestamp + receiveclock_ms_elapsed(mag->sampleTimestamp, mm->timestamp);
+
+    // advance ifile artifical clock for every message received
+    if (Modes.sdr_type == SDR_IFILE && Modes.synthetic_now) {
+        Modes.synthetic_now = mm->sysTimestamp;
+    }
+
+    mm->score = bestscore;
+
+    // Decode the received message
+    {
+        memcpy(mm->msg, bestmsg, MODES_LONG_MSG_BYTES);
+        int result = decodeModesMessage(mm);
+        if (result < 0) {
+            if (result == -1)
+                Modes.stats_current.demod_rejected_unknown_icao++;
+            else
+                Modes.stats_current.demod_rejected_bad++;
+            return -1;
+        } else {
+            Modes.stats_current.demod_accepted[mm->correctedbits]++;
+        }
+    }
+
+    Modes.stats_current.demod_bestPhase[bestphase - 4]++;
+
+    // measure signal power
+    {
+        double signal_power;
+        uint64_t scaled_signal_power = 0;
+        int signal_len = msglen * 12 / 5;
+        int k;
+
+        for (k = 0; k < signal_len; ++k) {
+            uint32_t mag = pa[19 + k];
+            scaled_signal_power += mag * mag;
+        }
+
+        signal_power = scaled_signal_power / 65535.0 / 65535.0;
+        mm->signalLevel = signal_power / signal_len;
+        Modes.stats_current.signal_power_sum += signal_power;
+        Modes.stats_current.signal_power_count += signal_len;
+        *sum_scaled_signal_power += scaled_signal_power;
+
+        if (mm->signalLevel > Modes.stats_current.peak_signal_power)
+            Modes.stats_current.peak_signal_power = mm->signalLevel;
+        if (mm->signalLevel > 0.50119)
+            Modes.stats_current.strong_signal_count++; // signal power above -3dBFS
+    }
+
+    // Pass data to the next layer
+    netUseMessage(mm);
+
+    // Skip over the message:
+    // (we actually skip to 8 bits before the end of the message,
+    //  because we can often decode two messages that *almost* collide,
+    //  where the preamble of the second message clobbered the last
+    //  few bits of the first message, but the message bits didn't
+    //  overlap)
+    //pa += msglen * 12 / 5;
+    //
+    // let's test something, only jump part of the message and let the preamble detection handle the rest.
+    return msglen * 8 / 4;
+}
+
 //
-// Given 'mlen' magnitude samples in 'm', sampled at 2.4MHz,
-// try to demodulate some Mode S messages.
+// Search for preambles from sample offset 'from' up to 'to' and demodulate the messages.
+// Without a window, messages are decoded and passed on immediately,
+// with a window every preamble is only collected as a candidate (no global state is modified)
+// and the scan continues at the next sample, demodulate2400Parallel() then skips the candidates
+// within accepted messages just like the serial scan does.
 //
-void demodulate2400(struct mag_buf *mag) {
+static void demod_scan(struct mag_buf *mag, uint32_t from, uint32_t to, struct demodWindow *window, uint64_t *sum_scaled_signal_power) {
     unsigned char msg1[MODES_LONG_MSG_BYTES], msg2[MODES_LONG_MSG_BYTES], *msg;
 
     unsigned char *bestmsg = NULL;
@@ -269,27 +661,14 @@ void demodulate2400(struct mag_buf *mag) {
     int bestphase = 0;
 
     uint16_t *m = mag->data;
-    uint32_t mlen = mag->length;
-
-    uint64_t sum_scaled_signal_power = 0;
-
-    // initialize bitsets on first call
-    if (!valid_df_short_bitset)
-        init_bitsets();
 
     msg = msg1;
 
-    // advance ifile artificial clock even if we don't receive anything
-    if (Modes.sdr_type == SDR_IFILE && Modes.synthetic_now) {
-        Modes.synthetic_now = mag->sysTimestamp;
-    }
-
-    uint16_t *pa = m;
-    uint16_t *stop = m + mlen;
+    uint16_t *pa = m + from;
+    uint16_t *stop = m + to;
 
     for (; pa < stop; pa++) {
         int32_t pa_mag, base_noise, ref_level;
-        int msglen;
 
         // Look for a message starting at around sample 0 with phase offset 3..7
 
@@ -304,27 +683,11 @@ void demodulate2400(struct mag_buf *mag) {
         // phase 7: 0/3 3\1/5\0 0 0 0 1/5\0/4\2 0 0 0 0 0 0 X3
 
         // do a pre-check to reduce CPU usage
-        // some silly unrolling that cuts CPU cycles
-        // due to plenty room in the message buffer for decoding
-        // we can with pa go beyond stop without a buffer overrun ...
-
-        if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-
-        continue;
-
-after_pre:
-        // ... but we must NOT decode if have ran past stop
+        pa = find_preamble(pa, stop);
+
+        // ... we must NOT decode if have ran past stop
         if (!(pa < stop))
-            continue;
+            break;
 
         // 5 noise samples
         base_noise = pa[5] + pa[8] + pa[16] + pa[17] + pa[18];
@@ -340,6 +703,7 @@ after_pre:
         ref_level >>= 5; // divide by 32
 
         bestscore = -42;
+        int tried = 0;
 
         int32_t diff_2_3 =  pa[2] - pa[3];
         int32_t sum_1_4 = pa[1] + pa[4];
@@ -351,6 +715,7 @@ after_pre:
         // phase 4: 1/5\0/4\2 0 0 0 0/4\2 2/4\0 0 0 0 0 0 0 X0
         pa_mag = common3456 - diff_10_11;
         if (pa_mag >= ref_level) {
+            tried |= PHASES_3_4;
             // peaks at 1,3,9,11-12: phase 3
             score_phase(4, pa, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
 
@@ -363,6 +728,7 @@ after_pre:
         // phase 6: 0/4\2 2/4\0 0 0 0 2/4\0/5\1 0 0 0 0 0 0 X2
         pa_mag = common3456 + diff_10_11;
         if (pa_mag >= ref_level) {
+            tried |= PHASES_5_6;
             // peaks at 1,3-4,9-10,12: phase 5
             score_phase(6, pa, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
 
@@ -374,101 +740,147 @@ after_pre:
         // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
         // phase 7: 0/3 3\1/5\0 0 0 0 1/5\0/4\2 0 0 0 0 0 0 X3
         pa_mag = sum_1_4 + 2 * diff_2_3 + diff_10_11 + pa[12];
-        if (pa_mag >= ref_level)
+        if (pa_mag >= ref_level) {
+            tried |= PHASES_7;
             score_phase(8, pa, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
+        }
 
 
-        // no preamble detected
-        if (bestscore == -42)
+        if (window) {
+            if (!tried) {
+                continue;
+            }
+            if (window->count == window->alloc) {
+                window->alloc = imax(64, 2 * window->alloc);
+                window->candidates = realloc(window->candidates, window->alloc * sizeof(struct demodCandidate));
+                if (!window->candidates) {
+                    fprintf(stderr, "FATAL: demod_scan: out of memory\n");
+                    exit(1);
+                }
+            }
+            struct demodCandidate *cand = &window->candidates[window->count++];
+            cand->offset = pa - m;
+            cand->score = bestscore;
+            cand->phase = bestphase;
+            cand->tried = tried;
+            if (bestscore >= 0) {
+                memcpy(cand->msg, bestmsg, MODES_LONG_MSG_BYTES);
+            }
+            // whether this is skipped over depends on the messages before it, continue with the next sample
             continue;
+        }
 
-        // we had at least one phase greater than the preamble threshold
-        // and used scoremodesmessage on those bytes
-        Modes.stats_current.demod_preambles++;
-
-        // Do we have a candidate?
-        if (bestscore < 0) {
+        if (!demod_count_preamble(tried, bestscore)) {
+            continue;
+        }
 
-            if (bestscore == -1)
-                Modes.stats_current.demod_rejected_unknown_icao++;
-            else
-                Modes.stats_current.demod_rejected_bad++;
-            continue; // nope.
+        int skip = demod_accept(mag, pa, bestmsg, bestscore, bestphase, sum_scaled_signal_power);
+        if (skip < 0) {
+            continue;
         }
 
-        msglen = modesMessageLenByType(getbits(bestmsg, 1, 5));
+        pa += skip;
+    }
+}
 
-        struct modesMessage *mm = netGetMM(&Modes.netMessageBuffer[0]);
+static void demodWindowTask(void *arg, threadpool_threadbuffers_t *buffer_group) {
+    MODES_NOTUSED(buffer_group);
+    struct demodWindow *window = arg;
 
-        // For consistency with how the Beast / Radarcape does it,
-        // we report the timestamp at the end of bit 56 (even if
-        // the frame is a 112-bit frame)
-        mm->timestamp = mag->sampleTimestamp + (pa -m) * 5 + (8 + 56) * 12 + bestphase;
+    window->count = 0;
+    demod_scan(window->mag, window->from, window->to, window, NULL);
+}
 
-        // compute message receive time as block-start-time + difference in the 12MHz clock
-        mm->sysTimestamp = mag->sysTimestamp + receiveclock_ms_elapsed(mag->sampleTimestamp, mm->timestamp);
+//
+// Split the buffer into one window per thread and search the windows concurrently.
+// Each window only searches for preambles in its part of the buffer but reads the samples following it
+// (the window overlap) so messages crossing into the next window are fully demodulated.
+// The windows record a candidate for every sample offset the serial scan could stop at.
+// The candidates are then processed in sample order, skipping the ones within an accepted
+// message (also across window seams), which gives the same messages and stats as the serial scan.
+//
+static struct demodWindow *demodWindows;
+static threadpool_task_t *demodTasks;
+
+static void demodulate2400Parallel(struct mag_buf *mag, uint64_t *sum_scaled_signal_power) {
+    int count = Modes.demodThreads;
+    if (!demodWindows) {
+        demodWindows = cmalloc(count * sizeof(struct demodWindow));
+        memset(demodWindows, 0, count * sizeof(struct demodWindow));
+        demodTasks = cmalloc(count * sizeof(threadpool_task_t));
+    }
+    struct demodWindow *windows = demodWindows;
+    threadpool_task_t *tasks = demodTasks;
 
-        // advance ifile artifical clock for every message received
-        if (Modes.sdr_type == SDR_IFILE && Modes.synthetic_now) {
-            Modes.synthetic_now = mm->sysTimestamp;
-        }
+    uint32_t mlen = mag->length;
+    uint32_t windowLen = (mlen + count - 1) / count;
+    for (int k = 0; k < count; k++) {
+        struct demodWindow *window = &windows[k];
+        window->mag = mag;
+        window->from = imin(mlen, k * windowLen);
+        window->to = imin(mlen, (k + 1) * windowLen);
+        tasks[k].function = demodWindowTask;
+        tasks[k].argument = window;
+    }
 
-        mm->score = bestscore;
-
-        // Decode the received message
-        {
-            memcpy(mm->msg, bestmsg, MODES_LONG_MSG_BYTES);
-            int result = decodeModesMessage(mm);
-            if (result < 0) {
-                if (result == -1)
-                    Modes.stats_current.demod_rejected_unknown_icao++;
-                else
-                    Modes.stats_current.demod_rejected_bad++;
+    // the time spent in the worker threads counts as demodulation time
+    struct timespec before = threadpool_get_cumulative_thread_time(Modes.demodPool);
+    threadpool_run(Modes.demodPool, tasks, count);
+    struct timespec after = threadpool_get_cumulative_thread_time(Modes.demodPool);
+    timespec_add_elapsed(&before, &after, &Modes.stats_current.demod_cpu);
+
+    uint32_t next = 0; // first sample offset not covered by the last accepted message
+    for (int k = 0; k < count; k++) {
+        struct demodWindow *window = &windows[k];
+        for (int i = 0; i < window->count; i++) {
+            struct demodCandidate *cand = &window->candidates[i];
+            if (cand->offset < next) {
                 continue;
-            } else {
-                Modes.stats_current.demod_accepted[mm->correctedbits]++;
+            }
+            if (!demod_count_preamble(cand->tried, cand->score)) {
+                continue;
+            }
+            int skip = demod_accept(mag, mag->data + cand->offset, cand->msg, cand->score, cand->phase, sum_scaled_signal_power);
+            if (skip >= 0) {
+                next = cand->offset + skip + 1;
             }
         }
+    }
+}
 
-        Modes.stats_current.demod_bestPhase[bestphase - 4]++;
-
-        // measure signal power
-        {
-            double signal_power;
-            uint64_t scaled_signal_power = 0;
-            int signal_len = msglen * 12 / 5;
-            int k;
-
-            for (k = 0; k < signal_len; ++k) {
-                uint32_t mag = pa[19 + k];
-                scaled_signal_power += mag * mag;
-            }
+void demodulate2400Cleanup() {
+    if (!demodWindows) {
+        return;
+    }
+    for (int k = 0; k < Modes.demodThreads; k++) {
+        sfree(demodWindows[k].candidates);
+    }
+    sfree(demodWindows);
+    sfree(demodTasks);
+}
 
-            signal_power = scaled_signal_power / 65535.0 / 65535.0;
-            mm->signalLevel = signal_power / signal_len;
-            Modes.stats_current.signal_power_sum += signal_power;
-            Modes.stats_current.signal_power_count += signal_len;
-            sum_scaled_signal_power += scaled_signal_power;
+//
+// Given 'mlen' magnitude samples in 'm', sampled at 2.4MHz,
+// try to demodulate some Mode S messages.
+//
+void demodulate2400(struct mag_buf *mag) {
+    uint64_t sum_scaled_signal_power = 0;
 
-            if (mm->signalLevel > Modes.stats_current.peak_signal_power)
-                Modes.stats_current.peak_signal_power = mm->signalLevel;
-            if (mm->signalLevel > 0.50119)
-                Modes.stats_current.strong_signal_count++; // signal power above -3dBFS
-        }
+    // initialize bitsets on first call
+    if (!valid_df_short_bitset) {
+        init_bitsets();
+        init_dispatch();
+    }
 
-        // Skip over the message:
-        // (we actually skip to 8 bits before the end of the message,
-        //  because we can often decode two messages that *almost* collide,
-        //  where the preamble of the second message clobbered the last
-        //  few bits of the first message, but the message bits didn't
-        //  overlap)
-        //pa += msglen * 12 / 5;
-        //
-        // let's test something, only jump part of the message and let the preamble detection handle the rest.
-        pa += msglen * 8 / 4;
+    // advance ifile artificial clock even if we don't receive anything
+    if (Modes.sdr_type == SDR_IFILE && Modes.synthetic_now) {
+        Modes.synthetic_now = mag->sysTimestamp;
+    }
 
-        // Pass data to the next layer
-        netUseMessage(mm);
+    if (Modes.demodThreads > 1) {
+        demodulate2400Parallel(mag, &sum_scaled_signal_power);
+    } else {
+        demod_scan(mag, 0, mag->length, NULL, &sum_scaled_signal_power);
     }
 
     /* update noise power */
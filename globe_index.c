@@ -1,6 +1,13 @@
 #include "readsb.h"
 #define STATE_SAVE_MAGIC (0x7ba09e63757314ceULL)
 #define STATE_SAVE_MAGIC_END (STATE_SAVE_MAGIC + 1)
+#define STATE_SCHEMA_MAGIC (STATE_SAVE_MAGIC + 2)
+#define STATE_DELTA_MAGIC (STATE_SAVE_MAGIC + 3)
+// version 2: trace chunks can contain columnar frames (--trace-columnar)
+// or be compressed with a trace dictionary (--trace-dict)
+// without either version 1 is written, older versions can still load the state
+#define STATE_FORMAT_VERSION (2)
+#define STATE_FORMAT_VERSION_PLAIN (1)
 #define LZO_MAGIC (0xf7413cc6eaf227dbULL)
 
 static const char zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
@@ -9,6 +16,7 @@ static void mark_legs(traceBuffer tb, struct aircraft *a, int start, int recent)
 static void traceCleanupNoUnlink(struct aircraft *a);
 static traceBuffer reassembleTrace(struct aircraft *a, int numPoints, int64_t after_timestamp, threadpool_buffer_t *buffer);
 static void resizeTraceCurrent(struct aircraft *a, int64_t now);
+static void traceChunkDictCheck(const unsigned char *src, size_t srcSize);
 
 void init_globe_index() {
     struct tile *s_tiles = Modes.json_globe_special_tiles = cmalloc(GLOBE_SPECIAL_INDEX * sizeof(struct tile));
@@ -362,6 +370,8 @@ void cleanup_globe_index() {
 
     free(Modes.json_globe_special_tiles);
     Modes.json_globe_special_tiles = NULL;
+
+    traceDictCleanup();
 }
 
 int globe_index(double lat_in, double lon_in) {
@@ -788,7 +798,7 @@ static void free_aircraft_range(int start, int end) {
             na = a->next;
             if (a) {
                 traceCleanupNoUnlink(a);
-                free(a);
+                aircraftFree(a);
             }
             a = na;
         }
@@ -800,7 +810,7 @@ static void save_blobs(void *arg, threadpool_threadbuffers_t *threadbuffers) {
     for (int j = info->from; j < info->to; j++) {
         //fprintf(stderr, "save_blob(%d)\n", j);
 
-        save_blob(j, &threadbuffers->buffers[0], &threadbuffers->buffers[1], Modes.state_dir);
+        save_blob(j, &threadbuffers->buffers[0], &threadbuffers->buffers[1], Modes.state_dir, 0);
 
         if (Modes.free_aircraft) {
             int stride = AIRCRAFT_BUCKETS / STATE_BLOBS;
@@ -819,7 +829,652 @@ static int roundUp8(int value) {
     return ((value + 7) / 8) * 8;
 }
 
-static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *passbuffer) {
+// saved aircraft state: each chunk of a blob starts with a schema record listing the fields of
+// struct aircraft as (tag, offset, size), the aircraft records are struct images in that layout
+// when the layout of the loading binary differs, the fields are copied by tag:
+// unknown tags are dropped, fields missing from the saved layout keep their defaults
+//
+// never renumber or reuse a tag, a field that changes its type gets a new tag
+// the pointers and the part from zeroStart to zeroEnd aren't saved
+// bit fields have their own records with bit offset and width, see stateBits
+
+enum stateFieldKind {
+    STATE_FIELD_SCALAR, // only copied if the size is unchanged
+    STATE_FIELD_ARRAY, // copied up to the smaller size
+    STATE_FIELD_BITS, // offset and size in bits, only copied if the width is unchanged
+};
+
+struct stateField {
+    uint32_t tag;
+    uint32_t kind;
+    uint32_t offset;
+    uint32_t size;
+};
+
+#define STATE_FIELD(tag, field) { tag, STATE_FIELD_SCALAR, offsetof(struct aircraft, field), sizeof(((struct aircraft *) 0)->field) }
+#define STATE_ARRAY(tag, field) { tag, STATE_FIELD_ARRAY, offsetof(struct aircraft, field), sizeof(((struct aircraft *) 0)->field) }
+
+static const struct stateField stateFields[] = {
+    STATE_FIELD(1, addr),
+    STATE_FIELD(2, addrtype),
+    STATE_FIELD(3, seen),
+    STATE_FIELD(4, seen_pos),
+    STATE_FIELD(5, messages),
+    STATE_FIELD(6, onActiveList),
+    STATE_FIELD(7, receiverCount),
+    STATE_FIELD(8, category),
+    STATE_FIELD(9, category_updated),
+    STATE_FIELD(10, trace_next_mw),
+    STATE_FIELD(11, trace_next_perm),
+    STATE_FIELD(12, lastSignalTimestamp),
+    STATE_FIELD(13, trace_perm_last_timestamp),
+    STATE_FIELD(14, trace_current_max),
+    STATE_FIELD(15, trace_current_len),
+    STATE_FIELD(16, trace_len),
+    STATE_FIELD(17, trace_chunk_len),
+    STATE_FIELD(18, trace_write),
+    STATE_FIELD(19, trace_writeCounter),
+    STATE_FIELD(20, baro_alt),
+    STATE_FIELD(21, alt_reliable),
+    STATE_FIELD(22, geom_alt),
+    STATE_FIELD(23, geom_delta),
+    STATE_FIELD(24, signalNext),
+    STATE_ARRAY(25, signalLevel),
+    STATE_FIELD(26, rr_lat),
+    STATE_FIELD(27, rr_lon),
+    STATE_FIELD(28, rr_seen),
+    STATE_FIELD(29, seenAdsbReliable),
+    STATE_FIELD(30, addrtype_updated),
+    STATE_FIELD(31, tat),
+    STATE_FIELD(32, nogpsCounter),
+    STATE_FIELD(33, receiverIdsNext),
+    STATE_FIELD(34, seenPosReliable),
+    STATE_FIELD(35, lastPosReceiverId),
+    STATE_FIELD(36, pos_nic),
+    STATE_FIELD(37, pos_rc),
+    STATE_FIELD(38, lat),
+    STATE_FIELD(39, lon),
+    STATE_FIELD(40, pos_reliable_odd),
+    STATE_FIELD(41, pos_reliable_even),
+    STATE_FIELD(42, traceWrittenForYesterday),
+    STATE_FIELD(43, mlatEPU),
+    STATE_FIELD(44, gs_last_pos),
+    STATE_FIELD(45, wind_speed),
+    STATE_FIELD(46, wind_direction),
+    STATE_FIELD(47, wind_altitude),
+    STATE_FIELD(48, oat),
+    STATE_FIELD(49, wind_updated),
+    STATE_FIELD(50, oat_updated),
+    STATE_FIELD(51, tat_updated),
+    STATE_FIELD(52, baro_rate),
+    STATE_FIELD(53, geom_rate),
+    STATE_FIELD(54, ias),
+    STATE_FIELD(55, tas),
+    STATE_FIELD(56, squawk),
+    STATE_FIELD(57, squawkTentative),
+    STATE_FIELD(58, nav_altitude_mcp),
+    STATE_FIELD(59, nav_altitude_fms),
+    STATE_FIELD(60, cpr_odd_lat),
+    STATE_FIELD(61, cpr_odd_lon),
+    STATE_FIELD(62, cpr_odd_nic),
+    STATE_FIELD(63, cpr_odd_rc),
+    STATE_FIELD(64, cpr_even_lat),
+    STATE_FIELD(65, cpr_even_lon),
+    STATE_FIELD(66, cpr_even_nic),
+    STATE_FIELD(67, cpr_even_rc),
+    STATE_FIELD(68, nav_qnh),
+    STATE_FIELD(69, nav_heading),
+    STATE_FIELD(70, gs),
+    STATE_FIELD(71, mach),
+    STATE_FIELD(72, track),
+    STATE_FIELD(73, track_rate),
+    STATE_FIELD(74, roll),
+    STATE_FIELD(75, mag_heading),
+    STATE_FIELD(76, true_heading),
+    STATE_FIELD(77, calc_track),
+    STATE_FIELD(78, next_reduce_forward_DF11),
+    STATE_ARRAY(79, callsign),
+    STATE_FIELD(80, emergency),
+    STATE_FIELD(81, airground),
+    STATE_FIELD(82, nav_modes),
+    STATE_FIELD(83, cpr_odd_type),
+    STATE_FIELD(84, cpr_even_type),
+    STATE_FIELD(85, nav_altitude_src),
+    STATE_FIELD(86, modeA_hit),
+    STATE_FIELD(87, modeC_hit),
+    STATE_FIELD(88, adsb_version),
+    STATE_FIELD(89, adsr_version),
+    STATE_FIELD(90, tisb_version),
+    STATE_FIELD(91, adsb_hrd),
+    STATE_FIELD(92, adsb_tah),
+    STATE_FIELD(93, globe_index),
+    STATE_FIELD(94, sil_type),
+    // 95 was the bit fields from nic_a to padding_b as one span, now in STATE_BITS
+    STATE_FIELD(96, callsign_valid),
+    STATE_FIELD(97, baro_alt_valid),
+    STATE_FIELD(98, geom_alt_valid),
+    STATE_FIELD(99, geom_delta_valid),
+    STATE_FIELD(100, gs_valid),
+    STATE_FIELD(101, ias_valid),
+    STATE_FIELD(102, tas_valid),
+    STATE_FIELD(103, mach_valid),
+    STATE_FIELD(104, track_valid),
+    STATE_FIELD(105, track_rate_valid),
+    STATE_FIELD(106, roll_valid),
+    STATE_FIELD(107, mag_heading_valid),
+    STATE_FIELD(108, true_heading_valid),
+    STATE_FIELD(109, baro_rate_valid),
+    STATE_FIELD(110, geom_rate_valid),
+    STATE_FIELD(111, nic_a_valid),
+    STATE_FIELD(112, nic_c_valid),
+    STATE_FIELD(113, nic_baro_valid),
+    STATE_FIELD(114, nac_p_valid),
+    STATE_FIELD(115, nac_v_valid),
+    STATE_FIELD(116, sil_valid),
+    STATE_FIELD(117, gva_valid),
+    STATE_FIELD(118, sda_valid),
+    STATE_FIELD(119, squawk_valid),
+    STATE_FIELD(120, emergency_valid),
+    STATE_FIELD(121, airground_valid),
+    STATE_FIELD(122, nav_qnh_valid),
+    STATE_FIELD(123, nav_altitude_mcp_valid),
+    STATE_FIELD(124, nav_altitude_fms_valid),
+    STATE_FIELD(125, nav_altitude_src_valid),
+    STATE_FIELD(126, nav_heading_valid),
+    STATE_FIELD(127, nav_modes_valid),
+    STATE_FIELD(128, cpr_odd_valid),
+    STATE_FIELD(129, cpr_even_valid),
+    STATE_FIELD(130, position_valid),
+    STATE_FIELD(131, alert_valid),
+    STATE_FIELD(132, spi_valid),
+    STATE_FIELD(133, seenPosGlobal),
+    STATE_FIELD(134, latReliable),
+    STATE_FIELD(135, lonReliable),
+    STATE_ARRAY(136, typeCode),
+    STATE_ARRAY(137, registration),
+    STATE_ARRAY(138, typeLong),
+    STATE_ARRAY(139, receiverIds),
+    STATE_FIELD(140, next_reduce_forward_status),
+    STATE_ARRAY(141, acas_ra),
+    STATE_FIELD(142, acas_flags),
+    STATE_FIELD(143, acas_ra_valid),
+    STATE_FIELD(144, gs_reliable),
+    STATE_FIELD(145, track_reliable),
+    STATE_FIELD(146, canary1),
+    STATE_FIELD(147, squawkTentativeChanged),
+    STATE_FIELD(148, magneticDeclination),
+    STATE_FIELD(149, updatedDeclination),
+    STATE_FIELD(150, pos_nic_reliable),
+    STATE_FIELD(151, pos_rc_reliable),
+    STATE_FIELD(152, trackUnreliable),
+    STATE_FIELD(153, receiverId),
+    STATE_FIELD(154, prev_lat),
+    STATE_FIELD(155, prev_lon),
+    STATE_FIELD(156, prev_pos_time),
+    STATE_FIELD(157, speedUnreliable),
+    STATE_FIELD(158, lastStatusDiscarded),
+    STATE_FIELD(159, nextJsonPortOutput),
+    STATE_FIELD(160, receiver_distance),
+    STATE_FIELD(161, receiver_direction),
+    STATE_FIELD(162, mlat_pos_valid),
+    STATE_FIELD(163, mlat_lat),
+    STATE_FIELD(164, mlat_lon),
+    STATE_FIELD(165, pos_reliable_valid),
+    STATE_FIELD(166, seenAdsbLat),
+    STATE_FIELD(167, seenAdsbLon),
+    STATE_FIELD(168, lastStatusTs),
+    STATE_FIELD(169, lastOverrideTs),
+};
+
+#undef STATE_FIELD
+#undef STATE_ARRAY
+
+#define STATE_FIELD_COUNT ((int) (sizeof(stateFields) / sizeof(stateFields[0])))
+
+// bit fields of struct aircraft (tag, field)
+// offsetof / sizeof don't work for them, their position is found by setting all bits of the field
+#define STATE_BITS(F) \
+    F(170, nic_a) \
+    F(171, nic_c) \
+    F(172, nic_baro) \
+    F(173, nac_p) \
+    F(174, nac_v) \
+    F(175, sil) \
+    F(176, gva) \
+    F(177, sda) \
+    F(178, alert) \
+    F(179, spi) \
+    F(180, pos_surface) \
+    F(181, last_cpr_type) \
+    F(182, tracePosBuffered) \
+    F(183, surfaceCPR_allow_ac_rel) \
+    F(184, localCPR_allow_ac_rel) \
+    F(185, last_message_crc_fixed) \
+    F(186, is_df18_exception) \
+    F(187, padding_b)
+
+#define F(tag, field) static void stateBitsSet_##field(struct aircraft *a) { a->field--; }
+STATE_BITS(F)
+#undef F
+
+static const struct {
+    uint32_t tag;
+    void (*setAll)(struct aircraft *a);
+} stateBitsProbe[] = {
+#define F(tag, field) { tag, stateBitsSet_##field },
+    STATE_BITS(F)
+#undef F
+};
+
+#define STATE_BITS_COUNT ((int) (sizeof(stateBitsProbe) / sizeof(stateBitsProbe[0])))
+
+static struct stateField stateBits[STATE_BITS_COUNT];
+static pthread_once_t stateBitsOnce = PTHREAD_ONCE_INIT;
+
+static void stateBitsInit() {
+    struct aircraft *probe = cmalloc(sizeof(struct aircraft));
+    unsigned char *bytes = (unsigned char *) probe;
+    for (int i = 0; i < STATE_BITS_COUNT; i++) {
+        memset(probe, 0, sizeof(struct aircraft));
+        stateBitsProbe[i].setAll(probe);
+        uint32_t first = UINT32_MAX;
+        uint32_t width = 0;
+        for (uint32_t bit = 0; bit < 8 * sizeof(struct aircraft); bit++) {
+            if (bytes[bit / 8] & (1 << (bit % 8))) {
+                first = imin(first, bit);
+                width++;
+            }
+        }
+        stateBits[i] = (struct stateField) { stateBitsProbe[i].tag, STATE_FIELD_BITS, first, width };
+    }
+    free(probe);
+}
+
+static uint32_t getBits(const unsigned char *src, uint32_t offset, uint32_t width) {
+    uint32_t value = 0;
+    for (uint32_t k = 0; k < width; k++) {
+        uint32_t bit = offset + k;
+        value |= ((src[bit / 8] >> (bit % 8)) & 1) << k;
+    }
+    return value;
+}
+
+static void setBits(unsigned char *dst, uint32_t offset, uint32_t width, uint32_t value) {
+    for (uint32_t k = 0; k < width; k++) {
+        uint32_t bit = offset + k;
+        dst[bit / 8] = (dst[bit / 8] & ~(1 << (bit % 8))) | (((value >> k) & 1) << (bit % 8));
+    }
+}
+
+// how to get an aircraft of a saved layout into the current one
+struct stateMigration {
+    int current; // saved layout is identical, copy the whole struct
+    int count;
+    int bitCount;
+    uint32_t addrOffset;
+    struct {
+        uint32_t from;
+        uint32_t to;
+        uint32_t size;
+    } copy[STATE_FIELD_COUNT], bits[STATE_BITS_COUNT];
+};
+
+static size_t stateSchemaBytes() {
+    return 2 * sizeof(uint64_t) + 2 * sizeof(uint32_t) + (STATE_FIELD_COUNT + STATE_BITS_COUNT) * sizeof(struct stateField);
+}
+
+static unsigned char *writeStateSchema(unsigned char *p) {
+    pthread_once(&stateBitsOnce, stateBitsInit);
+    uint64_t magic = STATE_SCHEMA_MAGIC;
+    p += memcpySize(p, &magic, sizeof(magic));
+    uint32_t version = (Modes.traceColumnar || Modes.traceDictID || Modes.traceColumnarLoaded) ? STATE_FORMAT_VERSION : STATE_FORMAT_VERSION_PLAIN;
+    p += memcpySize(p, &version, sizeof(version));
+    uint32_t count = STATE_FIELD_COUNT + STATE_BITS_COUNT;
+    p += memcpySize(p, &count, sizeof(count));
+    uint64_t size_aircraft = sizeof(struct aircraft);
+    p += memcpySize(p, &size_aircraft, sizeof(size_aircraft));
+    p += memcpySize(p, stateFields, sizeof(stateFields));
+    p += memcpySize(p, stateBits, sizeof(stateBits));
+    return p;
+}
+
+// the schema magic has been read already
+static int readStateSchema(char **p, char *end, struct stateMigration *migration, char *filename) {
+    static int layout_changed;
+    uint32_t version;
+    uint32_t count;
+    uint64_t oldSize;
+
+    if (end - *p < (ssize_t) (2 * sizeof(uint32_t) + sizeof(uint64_t))) {
+        return -1;
+    }
+    *p += memcpySize(&version, *p, sizeof(version));
+    *p += memcpySize(&count, *p, sizeof(count));
+    *p += memcpySize(&oldSize, *p, sizeof(oldSize));
+
+    if (version > STATE_FORMAT_VERSION) {
+        fprintf(stderr, "%s: state format version %u is newer than this readsb (%d), can't load it\n",
+                filename, version, STATE_FORMAT_VERSION);
+        return -1;
+    }
+    if (version > STATE_FORMAT_VERSION_PLAIN) {
+        // keep writing the version that makes older readsb refuse the state
+        Modes.traceColumnarLoaded = 1;
+    }
+    if (end - *p < (ssize_t) (count * sizeof(struct stateField))) {
+        return -1;
+    }
+    struct stateField *old = (struct stateField *) *p;
+    *p += count * sizeof(struct stateField);
+
+    pthread_once(&stateBitsOnce, stateBitsInit);
+    migration->current = (oldSize == sizeof(struct aircraft) && count == STATE_FIELD_COUNT + STATE_BITS_COUNT
+            && memcmp(old, stateFields, sizeof(stateFields)) == 0
+            && memcmp(old + STATE_FIELD_COUNT, stateBits, sizeof(stateBits)) == 0);
+    migration->count = 0;
+    migration->bitCount = 0;
+    migration->addrOffset = UINT32_MAX;
+
+    if (migration->current) {
+        migration->addrOffset = offsetof(struct aircraft, addr);
+        return 0;
+    }
+
+    int resized = 0;
+    for (int i = 0; i < STATE_FIELD_COUNT; i++) {
+        const struct stateField *field = &stateFields[i];
+        for (uint32_t k = 0; k < count; k++) {
+            struct stateField saved;
+            memcpy(&saved, &old[k], sizeof(saved));
+            if (saved.tag != field->tag) {
+                continue;
+            }
+            if ((uint64_t) saved.offset + saved.size > oldSize) {
+                break;
+            }
+            if (saved.size != field->size && field->kind != STATE_FIELD_ARRAY) {
+                resized++;
+                break;
+            }
+            if (field->tag == stateFields[0].tag) {
+                migration->addrOffset = saved.offset;
+            }
+            migration->copy[migration->count].from = saved.offset;
+            migration->copy[migration->count].to = field->offset;
+            migration->copy[migration->count].size = imin(saved.size, field->size);
+            migration->count++;
+            break;
+        }
+    }
+    for (int i = 0; i < STATE_BITS_COUNT; i++) {
+        const struct stateField *field = &stateBits[i];
+        for (uint32_t k = 0; k < count; k++) {
+            struct stateField saved;
+            memcpy(&saved, &old[k], sizeof(saved));
+            if (saved.tag != field->tag) {
+                continue;
+            }
+            if (saved.kind != STATE_FIELD_BITS || (uint64_t) saved.offset + saved.size > 8 * oldSize) {
+                break;
+            }
+            if (saved.size != field->size) {
+                resized++;
+                break;
+            }
+            migration->bits[migration->bitCount].from = saved.offset;
+            migration->bits[migration->bitCount].to = field->offset;
+            migration->bits[migration->bitCount].size = field->size;
+            migration->bitCount++;
+            break;
+        }
+    }
+    int dropped = (int) count - (migration->count + migration->bitCount + resized);
+
+    if (migration->addrOffset == UINT32_MAX) {
+        fprintf(stderr, "%s: saved state lacks the aircraft address, can't load it\n", filename);
+        return -1;
+    }
+
+    if (!layout_changed) {
+        layout_changed = 1;
+        fprintf(stderr, "struct aircraft layout has changed (%ld -> %ld bytes), migrating saved state: "
+                "%d fields copied, %d with changed size reset, %d unknown ones dropped\n",
+                (long) oldSize, (long) sizeof(struct aircraft), migration->count + migration->bitCount, resized, dropped);
+        Modes.writeInternalState = 1; // immediately write in the new format
+    }
+
+    return 0;
+}
+
+// --write-state-lazy-traces: the trace part of an aircraft in the state file is kept verbatim
+// after this header until traceRestoreLazy() parses it
+struct traceLazyHeader {
+    int32_t trace_len;
+    int32_t trace_chunk_len;
+    int32_t trace_current_len;
+    uint32_t allocBytes; // including this header
+};
+
+// size of the trace part following the aircraft struct in the state file, -1 if it doesn't fit
+// checkDict: the trace is kept, check the chunks can be decompressed with the loaded dictionary
+static ssize_t traceSavedBytes(struct aircraft *a, char *p, char *end, int checkDict) {
+    char *start = p;
+    ssize_t bytes = sizeof(uint64_t);
+    if (end - p < bytes) {
+        return -1;
+    }
+    p += bytes;
+    for (int k = 0; k < a->trace_chunk_len; k++) {
+        stateChunk chunk;
+        if (end - p < (ssize_t) sizeof(stateChunk)) {
+            return -1;
+        }
+        p += memcpySize(&chunk, p, sizeof(stateChunk));
+        if (chunk.compressed_size < 0 || end - p < roundUp8(chunk.compressed_size)) {
+            return -1;
+        }
+        if (checkDict) {
+            traceChunkDictCheck((unsigned char *) p, chunk.compressed_size);
+        }
+        p += roundUp8(chunk.compressed_size);
+    }
+    if (a->trace_current_len < 0 || end - p < (ssize_t) stateBytes(a->trace_current_len)) {
+        return -1;
+    }
+    p += stateBytes(a->trace_current_len);
+    return p - start;
+}
+
+// parse the trace part of the state file into trace_chunks / trace_current
+// a->trace_len / trace_chunk_len / trace_current_len are as saved
+static int loadTrace(struct aircraft *a, char **p, char *end, int64_t now) {
+    int discard_trace = 0;
+
+    if (a->trace_len > Modes.traceMax) {
+        fprintf(stderr, "%06x unexpectedly long trace: %d!\n", a->addr, a->trace_len);
+    }
+
+    if (end - *p < (ssize_t) sizeof(uint64_t)) {
+        traceCleanupNoUnlink(a);
+        return -1;
+    }
+    uint64_t tmp_u64;
+    *p += memcpySize(&tmp_u64, *p, sizeof(tmp_u64));
+    ssize_t oldFourStateSize = tmp_u64;
+
+    if (oldFourStateSize != sizeof(fourState)) {
+        fprintf(stderr, "%06x sizeof(fourState) / SFOUR definition has changed, aborting state loading!\n", a->addr);
+        traceCleanupNoUnlink(a);
+        return -1;
+    }
+
+    int checkNo = 0;
+#define checkSize(size) if (++checkNo && ((end - *p < (ssize_t) size) || size < 0)) { fprintf(stderr, "loadAircraft: checkSize failed for hex %06x checkNo %d size %lld\n", a->addr, checkNo, (long long) size); traceCleanupNoUnlink(a); return -1; }
+
+    if (a->trace_chunk_len > 0) {
+        a->trace_chunks = traceAlloc(a->trace_chunk_len * sizeof(stateChunk));
+        // zeroed so a failed load only frees what was allocated
+        memset(a->trace_chunks, 0x0, a->trace_chunk_len * sizeof(stateChunk));
+    } else {
+        a->trace_chunk_len = 0;
+    }
+    for (int k = 0; k < a->trace_chunk_len; k++) {
+        stateChunk *chunk = &a->trace_chunks[k];
+        checkSize(sizeof(stateChunk));
+        *p += memcpySize(chunk, *p, sizeof(stateChunk));
+        chunk->compressed = NULL;
+
+        checkSize(chunk->compressed_size);
+        chunk->compressed = traceAlloc(chunk->compressed_size);
+        a->trace_chunk_overall_bytes += chunk->compressed_size;
+        *p += memcpySize(chunk->compressed, *p, chunk->compressed_size);
+        traceChunkDictCheck(chunk->compressed, chunk->compressed_size);
+
+        ssize_t padBytes = roundUp8(chunk->compressed_size) - chunk->compressed_size;
+        *p += padBytes;
+
+        if (chunk->numStates % SFOUR != 0) {
+            fprintf(stderr, "<3> %06x load_aircraft: (chunk->numStates %% SFOUR != 0) ..... this would cause issues, throwing away trace data!\n", a->addr);
+            discard_trace = 1;
+        }
+    }
+    resizeTraceCurrent(a, now);
+    if (a->trace_current_len) {
+        checkSize(stateBytes(a->trace_current_len));
+        *p += memcpySize(a->trace_current, *p, stateBytes(a->trace_current_len));
+    }
+#undef checkSize
+
+    if (discard_trace) {
+        traceCleanupNoUnlink(a);
+    }
+
+    return 0;
+}
+
+// the trace chunks just loaded are in the state blob, see save_blob()
+static void traceSavedChunkTs(struct aircraft *a) {
+    if (Modes.replace_state_blob) {
+        return;
+    }
+    a->stateSavedChunkTs = a->trace_chunk_len > 0 ? a->trace_chunks[a->trace_chunk_len - 1].lastTimestamp : 0;
+}
+
+// schedule trace writes for an aircraft whose trace was just loaded from the state file
+static void traceLoaded(struct aircraft *a, int64_t now) {
+    if (a->trace_len == 0) {
+        return;
+    }
+
+    if (a->addr == Modes.leg_focus) {
+        a->trace_next_perm = now;
+        scheduleMemBothWrite(a, now);
+        fprintf(stderr, "leg_focus: %06x trace len: %d\n", a->addr, a->trace_len);
+        a->trace_write |= WRECENT;
+        a->trace_write |= WPERM;
+        a->trace_write |= WMEM;
+    }
+
+    // write traces into /run/readsb so they are present for the webinterface
+    if (a->pos_reliable_valid.source != SOURCE_INVALID || (now - a->seenPosReliable) < 15 * MINUTES) {
+        // write these trace immediately
+        a->trace_writeCounter = 0xc0ffee;
+        a->trace_write |= WRECENT;
+        a->trace_write |= WMEM;
+    }
+}
+
+void traceRestoreLazy(struct aircraft *a, int64_t now) {
+    char *lazy = a->traceLazy;
+    if (!lazy || !a->traceLazyLen) {
+        return;
+    }
+
+    struct traceLazyHeader header;
+    memcpy(&header, lazy, sizeof(header));
+    char *p = lazy + sizeof(header);
+    char *end = lazy + header.allocBytes;
+
+    // save_blob and traceWriteTask read the aircraft without lock and use the lazy buffer
+    // as long as traceLazyLen is set: parse into a scratch copy and publish the trace once complete
+    struct aircraft scratch;
+    memcpy(&scratch, a, sizeof(scratch));
+    scratch.trace_chunks = NULL;
+    scratch.trace_chunk_overall_bytes = 0;
+    scratch.trace_current = NULL;
+    scratch.trace_current_max = 0;
+    scratch.traceLazy = NULL;
+    scratch.traceLazyLen = 0;
+    memset(&scratch.traceCache, 0x0, sizeof(scratch.traceCache));
+
+    scratch.trace_len = header.trace_len;
+    scratch.trace_chunk_len = header.trace_chunk_len;
+    scratch.trace_current_len = header.trace_current_len;
+
+    // a failed load leaves the scratch trace empty
+    int loaded = (loadTrace(&scratch, &p, end, now) == 0);
+
+    a->trace_chunks = scratch.trace_chunks;
+    a->trace_chunk_overall_bytes = scratch.trace_chunk_overall_bytes;
+    a->trace_current = scratch.trace_current;
+    a->trace_current_max = scratch.trace_current_max;
+    a->trace_chunk_len = scratch.trace_chunk_len;
+    a->trace_current_len = scratch.trace_current_len;
+    a->trace_len = scratch.trace_len;
+
+    // pairs with the acquire load in save_blob, the buffer is freed by traceMaintenance
+    __atomic_store_n(&a->traceLazyLen, 0, __ATOMIC_RELEASE);
+
+    if (loaded) {
+        traceSavedChunkTs(a);
+        traceLoaded(a, now);
+        // the initial sweep writing traces of the past day has likely already run
+        if (a->trace_len > 0 && now - a->seenPosReliable < 24 * HOURS) {
+            a->trace_write |= WRECENT;
+            a->trace_write |= WMEM;
+        }
+    }
+
+    if (atomic_fetch_sub(&Modes.traceLazyCount, 1) == 1) {
+        fprintf(stderr, "lazy trace restore finished %.1f seconds after loading state\n",
+                (now - Modes.traceLazyStart) / 1000.0);
+    }
+}
+
+// delta record: the trace chunks loaded before are kept up to the first chunk of the record
+static void traceMergeChunks(struct aircraft *a, stateChunk *old, int oldLen, int64_t now) {
+    int64_t replaceFrom = a->trace_chunk_len > 0 ? a->trace_chunks[0].firstTimestamp : INT64_MAX;
+    int keep = 0;
+    while (keep < oldLen && old[keep].firstTimestamp < replaceFrom) {
+        keep++;
+    }
+    for (int k = keep; k < oldLen; k++) {
+        tfree(old[k].compressed, old[k].compressed_size);
+    }
+    if (keep > 0) {
+        int newLen = keep + a->trace_chunk_len;
+        stateChunk *chunks = traceAlloc(newLen * sizeof(stateChunk));
+        memcpy(chunks, old, keep * sizeof(stateChunk));
+        if (a->trace_chunk_len > 0) {
+            memcpy(chunks + keep, a->trace_chunks, a->trace_chunk_len * sizeof(stateChunk));
+        }
+        for (int k = 0; k < keep; k++) {
+            a->trace_len += old[k].numStates;
+            a->trace_chunk_overall_bytes += old[k].compressed_size;
+        }
+        tfree(a->trace_chunks, a->trace_chunk_len * sizeof(stateChunk));
+        a->trace_chunks = chunks;
+        a->trace_chunk_len = newLen;
+        if (!a->trace_current) {
+            resizeTraceCurrent(a, now);
+        }
+    }
+    tfree(old, oldLen * sizeof(stateChunk));
+}
+
+// migration: NULL for state saved before the schema record existed, the struct is copied as is
+// delta: record appended by an incremental save_blob, only has the trace chunks new since the last write
+static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *passbuffer, struct stateMigration *migration, int delta) {
     static int size_changed;
 
     ssize_t newSize = sizeof(struct aircraft);
@@ -836,17 +1491,21 @@ static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *
         return -1;
     }
 
-    struct aircraft *source = (struct aircraft *) *p;
+    uint32_t addr;
+    memcpy(&addr, *p + (migration ? migration->addrOffset : offsetof(struct aircraft, addr)), sizeof(addr));
+
+    stateChunk *savedChunks = NULL;
+    int savedChunkLen = 0;
 
-    struct aircraft *a = aircraftGet(source->addr);
+    struct aircraft *a = aircraftGet(addr);
     if (a) {
         if (0 && oldSize != newSize) {
-            fprintf(stderr, "%06x size mismatch when replacing aircraft data, aborting!\n", source->addr);
+            fprintf(stderr, "%06x size mismatch when replacing aircraft data, aborting!\n", addr);
             return -1;
         }
         //fprintf(stderr, "%06x aircraft already exists, overwriting old data\n", source->addr);
         //freeAircraft(a);
-        quickRemove(a);
+        // the struct is overwritten in place, the aircraft index entry stays valid
 
         // remove from active list if on it
         if (a->onActiveList) {
@@ -855,19 +1514,40 @@ static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *
         // remove from the globeList
         set_globe_index(a, -5);
 
+        if (delta) {
+            // keep the chunks loaded before, they are merged with the ones in this record
+            traceRestoreLazy(a, now);
+            savedChunks = a->trace_chunks;
+            savedChunkLen = a->trace_chunk_len;
+            a->trace_chunks = NULL;
+            a->trace_chunk_len = 0;
+        }
+
         traceCleanupNoUnlink(a);
     } else {
-        a = aircraftCreate(source->addr);
+        a = aircraftCreate(addr);
     }
 
     struct aircraft *preserveNext = a->next;
 
-    memcpy(a, *p, imin(oldSize, newSize));
+    if (migration && !migration->current) {
+        // fields not in the saved layout get their defaults, also when replacing an existing aircraft
+        aircraftDefaults(a, addr);
+        for (int i = 0; i < migration->count; i++) {
+            memcpy((char *) a + migration->copy[i].to, *p + migration->copy[i].from, migration->copy[i].size);
+        }
+        for (int i = 0; i < migration->bitCount; i++) {
+            uint32_t value = getBits((unsigned char *) *p, migration->bits[i].from, migration->bits[i].size);
+            setBits((unsigned char *) a, migration->bits[i].to, migration->bits[i].size, value);
+        }
+    } else {
+        memcpy(a, *p, imin(oldSize, newSize));
+    }
     *p += oldSize;
 
     a->next = preserveNext;
 
-    if (!size_changed && oldSize != newSize) {
+    if (!migration && !size_changed && oldSize != newSize) {
         size_changed = 1;
         fprintf(stderr, "sizeof(struct aircraft) has changed from %ld to %ld bytes, this means the code changed and if the coder didn't think properly might result in bad aircraft data. If your map doesn't have weird stuff ... probably all good and just an upgrade.\n",
                 (long) oldSize, (long) newSize);
@@ -893,6 +1573,11 @@ static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *
     if (a->addrtype_updated > now)
         a->addrtype_updated = now;
 
+    // the record is what's in the state blob now, unless it came from elsewhere
+    if (!Modes.replace_state_blob) {
+        a->stateSavedSeen = a->seen;
+    }
+
     if (a->trace_next_perm < now) {
         a->trace_next_perm = now + 1 * MINUTES + random() % (5 * MINUTES);
     } else if (a->trace_next_perm - now > GLOBE_PERM_IVAL) {
@@ -922,86 +1607,73 @@ static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *
     // recalculate overall trace chunk size
     a->trace_chunk_overall_bytes = 0;
 
-    int discard_trace = 0;
-
-    // check that the trace meta data make sense before loading it
-    if (a->trace_len > 0) {
-        if (a->trace_len > Modes.traceMax) {
-            fprintf(stderr, "%06x unexpectedly long trace: %d!\n", a->addr, a->trace_len);
-        }
-
-        uint64_t tmp_u64;
-        *p += memcpySize(&tmp_u64, *p, sizeof(tmp_u64));
-        ssize_t oldFourStateSize = tmp_u64;
-
-        if (oldFourStateSize != sizeof(fourState)) {
-            fprintf(stderr, "%06x sizeof(fourState) / SFOUR definition has changed, aborting state loading!\n", a->addr);
+    if (delta) {
+        int res = 0;
+        if (a->trace_len > 0) {
+            res = loadTrace(a, p, end, now);
+        } else {
             traceCleanupNoUnlink(a);
-            return -1;
         }
-
-        int checkNo = 0;
-#define checkSize(size) if (++checkNo && ((end - *p < (ssize_t) size) || size < 0)) { fprintf(stderr, "loadAircraft: checkSize failed for hex %06x checkNo %d size %lld\n", a->addr, checkNo, (long long) size); traceCleanupNoUnlink(a); return -1; }
-
-        if (a->trace_chunk_len > 0) {
-            a->trace_chunks = cmalloc(a->trace_chunk_len * sizeof(stateChunk));
-        } else {
-            a->trace_chunk_len = 0;
+        traceMergeChunks(a, savedChunks, savedChunkLen, now);
+        if (res < 0) {
+            return -1;
         }
-        for (int k = 0; k < a->trace_chunk_len; k++) {
-            stateChunk *chunk = &a->trace_chunks[k];
-            checkSize(sizeof(stateChunk));
-            *p += memcpySize(chunk, *p, sizeof(stateChunk));
-
-            checkSize(chunk->compressed_size);
-            chunk->compressed = cmalloc(chunk->compressed_size);
-            a->trace_chunk_overall_bytes += chunk->compressed_size;
-            *p += memcpySize(chunk->compressed, *p, chunk->compressed_size);
+        traceSavedChunkTs(a);
+        traceMaintenance(a, now, passbuffer);
+        traceLoaded(a, now);
+        return 0;
+    }
 
-            ssize_t padBytes = roundUp8(chunk->compressed_size) - chunk->compressed_size;
-            *p += padBytes;
+    if (a->trace_len <= 0) {
+        traceCleanupNoUnlink(a);
+        return 0;
+    }
 
-            if (chunk->numStates % SFOUR != 0) {
-                fprintf(stderr, "<3> %06x load_aircraft: (chunk->numStates %% SFOUR != 0) ..... this would cause issues, throwing away trace data!\n", a->addr);
-                discard_trace = 1;
-            }
-        }
-        resizeTraceCurrent(a, now);
-        if (a->trace_current_len) {
-            checkSize(stateBytes(a->trace_current_len));
-            *p += memcpySize(a->trace_current, *p, stateBytes(a->trace_current_len));
+    if (!Modes.keep_traces) {
+        ssize_t bytes = traceSavedBytes(a, *p, end, 0);
+        traceCleanupNoUnlink(a);
+        if (bytes < 0) {
+            return -1;
         }
-#undef checkSize
+        *p += bytes;
+        return 0;
+    }
 
-        if (!Modes.keep_traces) {
+    if (Modes.stateLazyTraces && !Modes.replace_state_blob) {
+        // only copy the saved trace, it's parsed on first access or by traceMaintenance
+        ssize_t bytes = traceSavedBytes(a, *p, end, 1);
+        if (bytes < 0) {
             traceCleanupNoUnlink(a);
-            return 0;
-        }
-
-        traceMaintenance(a, now, passbuffer);
-
-        if (a->addr == Modes.leg_focus) {
-            a->trace_next_perm = now;
-            scheduleMemBothWrite(a, now);
-            fprintf(stderr, "leg_focus: %06x trace len: %d\n", a->addr, a->trace_len);
-            a->trace_write |= WRECENT;
-            a->trace_write |= WPERM;
-            a->trace_write |= WMEM;
+            return -1;
         }
+        struct traceLazyHeader header = {
+            .trace_len = a->trace_len,
+            .trace_chunk_len = a->trace_chunk_len,
+            .trace_current_len = a->trace_current_len,
+            .allocBytes = sizeof(header) + bytes,
+        };
+        a->traceLazyLen = header.allocBytes;
+        a->traceLazy = traceAlloc(header.allocBytes);
+        memcpy(a->traceLazy, &header, sizeof(header));
+        memcpy(a->traceLazy + sizeof(header), *p, bytes);
+        *p += bytes;
+
+        a->trace_len = 0;
+        a->trace_chunk_len = 0;
+        a->trace_current_len = 0;
 
-        // write traces into /run/readsb so they are present for the webinterface
-        if (a->pos_reliable_valid.source != SOURCE_INVALID || (now - a->seenPosReliable) < 15 * MINUTES) {
-            // write these trace immediately
-            a->trace_writeCounter = 0xc0ffee;
-            a->trace_write |= WRECENT;
-            a->trace_write |= WMEM;
-        }
-    } else {
-        traceCleanupNoUnlink(a);
+        atomic_fetch_add(&Modes.traceLazyCount, 1);
+        return 0;
     }
-    if (discard_trace) {
-        traceCleanupNoUnlink(a);
+
+    if (loadTrace(a, p, end, now) < 0) {
+        return -1;
     }
+    traceSavedChunkTs(a);
+
+    traceMaintenance(a, now, passbuffer);
+
+    traceLoaded(a, now);
 
     return 0;
 }
@@ -1630,7 +2302,7 @@ static stateChunk *resizeTraceChunks(struct aircraft *a, int newLen) {
 
     a->trace_chunk_len = newLen;
     if (newLen == 0) {
-        sfree(a->trace_chunks);
+        tfree(a->trace_chunks, oldLen * sizeof(stateChunk));
         return NULL;
     }
     if (oldLen == newLen) {
@@ -1646,7 +2318,7 @@ static stateChunk *resizeTraceChunks(struct aircraft *a, int newLen) {
     int newBytes = newLen * sizeof(stateChunk);
     int oldBytes = oldLen * sizeof(stateChunk);
 
-    stateChunk *new = cmalloc(newBytes);
+    stateChunk *new = traceAlloc(newBytes);
     if (!new) {
         return NULL;
     }
@@ -1670,7 +2342,7 @@ static stateChunk *resizeTraceChunks(struct aircraft *a, int newLen) {
         memset(new + oldLen, 0x0, growByBytes);
     }
 
-    sfree(a->trace_chunks);
+    tfree(a->trace_chunks, oldBytes);
 
     a->trace_chunks = new;
 
@@ -1706,7 +2378,7 @@ static void tracePrune(struct aircraft *a, int64_t now) {
         a->trace_len -= chunk->numStates;
         a->trace_chunk_overall_bytes -= chunk->compressed_size;
 
-        sfree(chunk->compressed);
+        tfree(chunk->compressed, chunk->compressed_size);
     }
 
     if (deletedChunks > 0) {
@@ -1763,30 +2435,262 @@ static void destroyTraceCache(struct traceCache *cache) {
 static void traceCleanupNoUnlink(struct aircraft *a) {
     if (a->trace_chunks) {
         for (int k = 0; k < a->trace_chunk_len; k++) {
-            sfree(a->trace_chunks[k].compressed);
+            tfree(a->trace_chunks[k].compressed, a->trace_chunks[k].compressed_size);
         }
     }
-    sfree(a->trace_chunks);
+    tfree(a->trace_chunks, a->trace_chunk_len * sizeof(stateChunk));
     a->trace_chunk_len = 0;
     a->trace_chunk_overall_bytes = 0;
 
-    sfree(a->trace_current);
+    tfree(a->trace_current, stateBytes(a->trace_current_max));
     a->trace_current_max = 0;
     a->trace_current_len = 0;
 
     a->tracePosBuffered = 0;
     a->trace_len = 0;
 
+    if (a->traceLazy) {
+        if (a->traceLazyLen) {
+            atomic_fetch_sub(&Modes.traceLazyCount, 1);
+        }
+        struct traceLazyHeader *header = (struct traceLazyHeader *) a->traceLazy;
+        tfree(a->traceLazy, header->allocBytes);
+        a->traceLazyLen = 0;
+    }
+
     destroyTraceCache(&a->traceCache);
 }
 
 void traceCleanup(struct aircraft *a) {
-    if (a->trace_current) {
+    if (a->trace_current || a->traceLazy) {
         traceUnlink(a);
     }
     traceCleanupNoUnlink(a);
 }
 
+// --trace-dict: zstd dictionary for the trace chunks, loaded from the file or trained from the
+// first chunks compressed and then written to the file
+// the frames carry the dictionary ID, chunks compressed without dictionary stay readable
+#define TRACE_DICT_SIZE (32 * 1024)
+#define TRACE_DICT_SAMPLE_BYTES (4 * 1024 * 1024)
+#define TRACE_DICT_MAX_SAMPLES (8192)
+
+static struct {
+    pthread_mutex_t mutex;
+    char *buffer;
+    size_t len;
+    size_t sizes[TRACE_DICT_MAX_SAMPLES];
+    unsigned count;
+} dictSamples = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+static int traceDictUse(char *dict, size_t len) {
+    // a dictionary without ID (raw content) can't be told apart from no dictionary in the chunks
+    if (ZSTD_getDictID_fromDict(dict, len) == 0) {
+        fprintf(stderr, "trace dictionary %s has no dictionary ID (raw content dictionary), not using it\n", Modes.traceDictFile);
+        return -1;
+    }
+    ZSTD_DDict *ddict = ZSTD_createDDict(dict, len);
+    ZSTD_CDict *cdict = ZSTD_createCDict(dict, len, 2);
+    if (!ddict || !cdict) {
+        fprintf(stderr, "trace dictionary: ZSTD_createCDict / ZSTD_createDDict failed, not using it\n");
+        ZSTD_freeDDict(ddict);
+        ZSTD_freeCDict(cdict);
+        return -1;
+    }
+    Modes.traceDictID = ZSTD_getDictID_fromDict(dict, len);
+    // chunks compressed with the dictionary must always find the decompression dictionary
+    atomic_store(&Modes.traceDDict, ddict);
+    atomic_store(&Modes.traceCDict, cdict);
+    return 0;
+}
+
+void traceDictInit() {
+    if (!Modes.traceDictFile) {
+        return;
+    }
+    int fd = open(Modes.traceDictFile, O_RDONLY);
+    if (fd != -1) {
+        struct char_buffer cb = readWholeFile(fd, Modes.traceDictFile);
+        close(fd);
+        if (cb.buffer && traceDictUse(cb.buffer, cb.len) == 0) {
+            fprintf(stderr, "trace dictionary %u loaded from %s\n", Modes.traceDictID, Modes.traceDictFile);
+        }
+        sfree(cb.buffer);
+        return;
+    }
+
+    dictSamples.buffer = cmalloc(TRACE_DICT_SAMPLE_BYTES);
+    fprintf(stderr, "%s not found, training a trace dictionary from the first %d MB of trace chunks\n",
+            Modes.traceDictFile, TRACE_DICT_SAMPLE_BYTES / (1024 * 1024));
+}
+
+void traceDictCleanup() {
+    ZSTD_freeCDict(atomic_load(&Modes.traceCDict));
+    ZSTD_freeDDict(atomic_load(&Modes.traceDDict));
+    Modes.traceCDict = NULL;
+    Modes.traceDDict = NULL;
+    sfree(dictSamples.buffer);
+}
+
+static void traceDictSample(const void *source, size_t len) {
+    if (!dictSamples.buffer || Modes.traceDictSamplesDone) {
+        return;
+    }
+    pthread_mutex_lock(&dictSamples.mutex);
+    if (dictSamples.buffer && dictSamples.count < TRACE_DICT_MAX_SAMPLES && dictSamples.len + len <= TRACE_DICT_SAMPLE_BYTES) {
+        memcpy(dictSamples.buffer + dictSamples.len, source, len);
+        dictSamples.len += len;
+        dictSamples.sizes[dictSamples.count++] = len;
+    } else {
+        Modes.traceDictSamplesDone = 1;
+    }
+    pthread_mutex_unlock(&dictSamples.mutex);
+}
+
+// called by the misc thread, training takes a while
+void traceDictTrain() {
+    if (!Modes.traceDictSamplesDone || !dictSamples.buffer) {
+        return;
+    }
+    pthread_mutex_lock(&dictSamples.mutex);
+    char *samples = dictSamples.buffer;
+    dictSamples.buffer = NULL;
+    pthread_mutex_unlock(&dictSamples.mutex);
+
+    struct timespec watch;
+    startWatch(&watch);
+
+    char *dict = cmalloc(TRACE_DICT_SIZE);
+    size_t res = ZDICT_trainFromBuffer(dict, TRACE_DICT_SIZE, samples, dictSamples.sizes, dictSamples.count);
+    if (ZDICT_isError(res)) {
+        fprintf(stderr, "trace dictionary training failed: %s\n", ZDICT_getErrorName(res));
+    } else {
+        char tmppath[PATH_MAX];
+        snprintf(tmppath, PATH_MAX, "%s.readsb_tmp", Modes.traceDictFile);
+        int fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "trace dictionary not used, it can't be written: ");
+            perror(tmppath);
+        } else {
+            ssize_t written = check_write(fd, dict, res, tmppath);
+            close(fd);
+            // only use the dictionary if it's saved, the chunks in the state can't be read without it
+            if (written == (ssize_t) res && rename(tmppath, Modes.traceDictFile) == 0) {
+                if (traceDictUse(dict, res) == 0) {
+                    fprintf(stderr, "trace dictionary %u trained from %u chunks (%.1f MB) in %.1f seconds, saved to %s\n",
+                            Modes.traceDictID, dictSamples.count, dictSamples.len / (1024.0 * 1024.0),
+                            stopWatch(&watch) / 1000.0, Modes.traceDictFile);
+                }
+            } else {
+                fprintf(stderr, "trace dictionary not used, it can't be written: %s\n", Modes.traceDictFile);
+                unlink(tmppath);
+            }
+        }
+    }
+    sfree(dict);
+    sfree(samples);
+}
+
+// the dictionaries a zstd trace chunk was compressed with, frame by frame, must be the one loaded
+// otherwise the chunk can't be decompressed and the trace would be discarded, see readInternalState()
+static void traceChunkDictCheck(const unsigned char *src, size_t srcSize) {
+    if (srcSize < sizeof(zstd_magic) || memcmp(zstd_magic, src, sizeof(zstd_magic)) != 0) {
+        return;
+    }
+    while (srcSize > 0) {
+        size_t frameSize = ZSTD_findFrameCompressedSize(src, srcSize);
+        if (ZSTD_isError(frameSize)) {
+            // corrupt, reported when decompressing
+            return;
+        }
+        unsigned dictID = ZSTD_getDictID_fromFrame(src, frameSize);
+        if (dictID && (dictID != Modes.traceDictID || !atomic_load(&Modes.traceDDict))) {
+            if (atomic_exchange(&Modes.traceDictMissing, dictID) == 0) {
+                fprintf(stderr, "<3> trace chunks need trace dictionary %u, it isn't loaded (--trace-dict %s)\n",
+                        dictID, Modes.traceDictFile ? Modes.traceDictFile : "not set");
+            }
+            return;
+        }
+        src += frameSize;
+        srcSize -= frameSize;
+    }
+}
+
+static size_t traceChunkCompress(ZSTD_CCtx *cctx, void *dst, size_t dstCapacity, const void *src, size_t srcSize) {
+    ZSTD_CDict *cdict = atomic_load(&Modes.traceCDict);
+    if (cdict) {
+        return ZSTD_compress_usingCDict(cctx, dst, dstCapacity, src, srcSize, cdict);
+    }
+    return ZSTD_compressCCtx(cctx, dst, dstCapacity, src, srcSize, 2);
+}
+
+static size_t traceChunkDecompress(ZSTD_DCtx *dctx, void *dst, size_t dstCapacity, const void *src, size_t srcSize) {
+    ZSTD_DDict *ddict = atomic_load(&Modes.traceDDict);
+    if (ddict) {
+        // frames without dictionary ID decompress fine with it as well
+        return ZSTD_decompress_usingDDict(dctx, dst, dstCapacity, src, srcSize, ddict);
+    }
+    return ZSTD_decompressDCtx(dctx, dst, dstCapacity, src, srcSize);
+}
+
+// --trace-columnar: columnar encode (trace_codec.c), then compress points from source
+// scratch needs traceCodecBound(points) bytes, returns the compressed size or a zstd error code
+static size_t traceChunkPack(ZSTD_CCtx *cctx, void *dst, size_t dstCapacity, fourState *source, int points, unsigned char *scratch, size_t scratchSize) {
+    if (!Modes.traceColumnar) {
+        traceDictSample(source, stateBytes(points));
+        return traceChunkCompress(cctx, dst, dstCapacity, source, stateBytes(points));
+    }
+    size_t encodedSize = traceEncode(source, points, scratch, scratchSize);
+    if (!encodedSize) {
+        fprintf(stderr, "traceChunkPack: traceEncode failed, compressing without it\n");
+        traceDictSample(source, stateBytes(points));
+        return traceChunkCompress(cctx, dst, dstCapacity, source, stateBytes(points));
+    }
+    traceDictSample(scratch, encodedSize);
+    return traceChunkCompress(cctx, dst, dstCapacity, scratch, encodedSize);
+}
+
+// decompress a zstd trace chunk of numStates points to dst
+// an extended chunk consists of several zstd frames, each frame is either columnar encoded
+// or a plain fourState array (chunks written by older versions)
+// scratch needs traceCodecBound(numStates) bytes, returns -1 on error
+static int traceChunkUnpack(ZSTD_DCtx *dctx, fourState *dst, int numStates, const unsigned char *src, size_t srcSize, unsigned char *scratch, size_t scratchSize) {
+    int points = 0;
+    while (srcSize > 0) {
+        size_t frameSize = ZSTD_findFrameCompressedSize(src, srcSize);
+        if (ZSTD_isError(frameSize)) {
+            fprintf(stderr, "traceChunkUnpack() zstd error: %s\n", ZSTD_getErrorName(frameSize));
+            return -1;
+        }
+        size_t res = traceChunkDecompress(dctx, scratch, scratchSize, src, frameSize);
+        if (ZSTD_isError(res)) {
+            fprintf(stderr, "traceChunkUnpack() zstd error: %s\n", ZSTD_getErrorName(res));
+            return -1;
+        }
+        int framePoints;
+        if (traceCodecEncoded(scratch, res)) {
+            framePoints = traceDecode(scratch, res, dst + points / SFOUR, numStates - points);
+        } else if (res % sizeof(fourState) == 0 && (int) (res / sizeof(fourState) * SFOUR) <= numStates - points) {
+            framePoints = res / sizeof(fourState) * SFOUR;
+            memcpy(dst + points / SFOUR, scratch, res);
+        } else {
+            framePoints = -1;
+        }
+        if (framePoints < 0) {
+            fprintf(stderr, "traceChunkUnpack(): corrupt frame, %d of %d points decoded\n", points, numStates);
+            return -1;
+        }
+        points += framePoints;
+        src += frameSize;
+        srcSize -= frameSize;
+    }
+    if (points != numStates) {
+        fprintf(stderr, "traceChunkUnpack(): %d points decoded, expected %d\n", points, numStates);
+        return -1;
+    }
+    return 0;
+}
+
 // reconstruct at least the last numPoints points from trace chunks / current_trace
 // numPoints < 0 => all data / whole trace
 static traceBuffer reassembleTrace(struct aircraft *a, int numPoints, int64_t after_timestamp, threadpool_buffer_t *buffer) {
@@ -1821,8 +2725,15 @@ static traceBuffer reassembleTrace(struct aircraft *a, int numPoints, int64_t af
 
     traceBuffer tb = { 0 };
 
+    // scratch space for traceChunkUnpack after the trace
+    size_t scratchSize = 0;
+    for (int k = firstChunk; k < a->trace_chunk_len; k++) {
+        scratchSize = imax(scratchSize, traceCodecBound(a->trace_chunks[k].numStates));
+    }
+
     //fprintf(stderr, "allocLen %ld fourStates %ld stateBytes %ld\n", (long) allocLen, (long) getFourStates(allocLen), (long) stateBytes(allocLen));
-    tb.trace = check_grow_threadpool_buffer_t(buffer, stateBytes(allocLen));
+    tb.trace = check_grow_threadpool_buffer_t(buffer, stateBytes(allocLen) + scratchSize);
+    unsigned char *scratch = (unsigned char *) tb.trace + stateBytes(allocLen);
 
     fourState *tp = tb.trace;
 
@@ -1839,9 +2750,8 @@ static traceBuffer reassembleTrace(struct aircraft *a, int numPoints, int64_t af
             if (!buffer->dctx) {
                 buffer->dctx = ZSTD_createDCtx();
             }
-            size_t res = ZSTD_decompressDCtx(buffer->dctx, tp, uncompressed_len, chunk->compressed, chunk->compressed_size);
-            if (ZSTD_isError(res)) {
-                fprintf(stderr, "reassembleTrace() zstd error: %s\n", ZSTD_getErrorName(res));
+            if (traceChunkUnpack(buffer->dctx, tp, chunk->numStates, chunk->compressed, chunk->compressed_size, scratch, scratchSize) < 0) {
+                fprintf(stderr, "reassembleTrace(%06x): corrupt trace chunk %d\n", a->addr, k);
                 tb.len = 0;
                 traceCleanup(a);
                 return tb;
@@ -1887,25 +2797,26 @@ static float recompressStateChunk(struct stateChunk *chunk, threadpool_buffer_t
         passbuffer->dctx = ZSTD_createDCtx();
     }
     int uncompressed_len = stateBytes(chunk->numStates);
-    int maxSize = ZSTD_compressBound(uncompressed_len);
-    int totalBuffer = uncompressed_len + maxSize;
+    int scratchSize = traceCodecBound(chunk->numStates);
+    int maxSize = ZSTD_compressBound(scratchSize);
+    int totalBuffer = uncompressed_len + scratchSize + maxSize;
     char *uncompressed = check_grow_threadpool_buffer_t(passbuffer, totalBuffer);
-    char *compressed = uncompressed + uncompressed_len;
+    unsigned char *scratch = (unsigned char *) uncompressed + uncompressed_len;
+    char *compressed = uncompressed + uncompressed_len + scratchSize;
 
-    size_t res = ZSTD_decompressDCtx(passbuffer->dctx, uncompressed, uncompressed_len, chunk->compressed, chunk->compressed_size);
-    if (ZSTD_isError(res)) {
-        fprintf(stderr, "recompress(): Corrupt trace chunk: zstd error: %s\n", ZSTD_getErrorName(res));
+    if (traceChunkUnpack(passbuffer->dctx, (fourState *) uncompressed, chunk->numStates, chunk->compressed, chunk->compressed_size, scratch, scratchSize) < 0) {
+        fprintf(stderr, "recompress(): Corrupt trace chunk\n");
         return 0.0f;
     }
 
     if (!passbuffer->cctx) {
         passbuffer->cctx = ZSTD_createCCtx();
     }
-    size_t compressedSize = ZSTD_compressCCtx(
+    size_t compressedSize = traceChunkPack(
             passbuffer->cctx,
             compressed, maxSize,
-            uncompressed, uncompressed_len,
-            2);
+            (fourState *) uncompressed, chunk->numStates,
+            scratch, scratchSize);
 
     if (ZSTD_isError(compressedSize)) {
         fprintf(stderr, "recompress() zstd error: %s\n", ZSTD_getErrorName(compressedSize));
@@ -1926,8 +2837,8 @@ static float recompressStateChunk(struct stateChunk *chunk, threadpool_buffer_t
                 (long long) compressedSize);
     }
 
-    sfree(chunk->compressed);
-    chunk->compressed = cmalloc(compressedSize);
+    tfree(chunk->compressed, chunk->compressed_size);
+    chunk->compressed = traceAlloc(compressedSize);
 
     memcpy(chunk->compressed, compressed, compressedSize);
     chunk->compressed_size = compressedSize;
@@ -2040,6 +2951,7 @@ static int compressChunk(fourState *source, int pointCount, threadpool_buffer_t
 
         //fprintf(stderr, "pbuffer->size: %ld src.len %ld\n", (long) pbuffer->size, (long) src.len);
 
+        // samples for oneoff/trace_codec_benchmark
         if (0 && Modes.json_dir) {
             char path[1024];
             snprintf(path, 1024, "%s/tracechunk_samples/%06x", Modes.json_dir, a->addr);
@@ -2057,24 +2969,27 @@ static int compressChunk(fourState *source, int pointCount, threadpool_buffer_t
          int compressionLevel);
          */
 
-        int maxSize = ZSTD_compressBound(newBytes);
-        int totalBuffer = maxSize;
+        int scratchSize = traceCodecBound(pointCount);
+        int maxSize = ZSTD_compressBound(imax(newBytes, scratchSize));
+        int totalBuffer = maxSize + scratchSize;
         if (extending) {
             totalBuffer += target->compressed_size;
         }
         char *compressed = check_grow_threadpool_buffer_t(passbuffer, totalBuffer);
+        // scratch for the columnar encoding at the end of the buffer
+        unsigned char *scratch = (unsigned char *) compressed + totalBuffer - scratchSize;
 
         if (extending) {
             memcpy(compressed, target->compressed, target->compressed_size);
-            sfree(target->compressed);
+            tfree(target->compressed, target->compressed_size);
             compressed += target->compressed_size;
         }
 
-        compressedSize = ZSTD_compressCCtx(
+        compressedSize = traceChunkPack(
                 passbuffer->cctx,
                 compressed, maxSize,
-                source, newBytes,
-                2);
+                source, pointCount,
+                scratch, scratchSize);
 
         if (ZSTD_isError(compressedSize)) {
             fprintf(stderr, "compressChunk() zstd error: %s\n", ZSTD_getErrorName(compressedSize));
@@ -2101,7 +3016,7 @@ static int compressChunk(fourState *source, int pointCount, threadpool_buffer_t
     } else {
         target->compressed_size = compressedSize;
     }
-    target->compressed = cmalloc(target->compressed_size);
+    target->compressed = traceAlloc(target->compressed_size);
     memcpy(target->compressed, passbuffer->buf, target->compressed_size);
 
     a->trace_chunk_overall_bytes += target->compressed_size;
@@ -2121,6 +3036,10 @@ static int compressChunk(fourState *source, int pointCount, threadpool_buffer_t
 }
 
 static void setTrace(struct aircraft *a, fourState *source, int len, threadpool_buffer_t *passbuffer) {
+    // the whole record needs to be written to the state blob again
+    a->stateSavedSeen = 0;
+    a->stateSavedChunkTs = -1;
+
     if (len == 0) {
         traceCleanup(a);
         return;
@@ -2177,13 +3096,13 @@ static void resizeTraceCurrent(struct aircraft *a, int64_t now) {
         return;
     }
     int newBytes = stateBytes(newPoints);
-    fourState *new = cmalloc(newBytes);
+    fourState *new = traceAlloc(newBytes);
 
     memset(new, 0x0, newBytes);
 
     if (a->trace_current) {
         memcpy(new, a->trace_current, stateBytes(a->trace_current_len + 1)); // 1 extra for buffered pos
-        sfree(a->trace_current);
+        tfree(a->trace_current, stateBytes(a->trace_current_max));
     }
 
     a->trace_current = new;
@@ -2226,6 +3145,19 @@ static void compressCurrent(struct aircraft *a, threadpool_buffer_t *passbuffer)
 }
 
 void traceMaintenance(struct aircraft *a, int64_t now, threadpool_buffer_t *passbuffer) {
+    if (a->traceLazy) {
+        if (a->traceLazyLen) {
+            // restore a limited number of traces per trackRemoveStale run
+            if (atomic_fetch_sub(&Modes.traceLazyBudget, 1) <= 0) {
+                return;
+            }
+            traceRestoreLazy(a, now);
+        }
+        // restored, save_blob doesn't run concurrently with traceMaintenance
+        struct traceLazyHeader *header = (struct traceLazyHeader *) a->traceLazy;
+        tfree(a->traceLazy, header->allocBytes);
+    }
+
     // free trace cache for inactive aircraft
     if (a->traceCache.entries && now - a->seenPosReliable > TRACE_CACHE_LIFETIME) {
         //fprintf(stderr, "%06x free traceCache\n", a->addr);
@@ -2653,7 +3585,14 @@ no_save_state:
     return posUsed || bufferedPosUsed;
 }
 
-void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbuffer2, char *stateDir) {
+// bytes of the last complete write (or of the file loaded) and of the records appended since,
+// per blob of Modes.state_dir
+static int64_t blobBaseBytes[STATE_BLOBS + 1];
+static int64_t blobLogBytes[STATE_BLOBS + 1];
+
+// incremental: only append the aircraft that changed since they were last written to the blob,
+// a blob is rewritten completely when the appended part has grown larger than the last complete write
+void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbuffer2, char *stateDir, int incremental) {
     if (!stateDir)
         return;
     //static int count;
@@ -2680,12 +3619,29 @@ void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbu
     }
     snprintf(tmppath, PATH_MAX, "%s.readsb_tmp", filename);
 
-    int fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    // the per aircraft bookkeeping of what was written only applies to Modes.state_dir
+    int tracked = (Modes.state_dir && strcmp(stateDir, Modes.state_dir) == 0);
+
+    if (incremental && (!tracked || !zst || blobBaseBytes[blob] == 0 || blobLogBytes[blob] > blobBaseBytes[blob])) {
+        incremental = 0;
+    }
+
+    int fd = -1;
+    if (incremental) {
+        fd = open(filename, O_WRONLY | O_APPEND);
+        if (fd < 0) {
+            incremental = 0;
+        }
+    }
+    if (!incremental) {
+        fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
     if (fd < 0) {
         fprintf(stderr, "open failed:");
         perror(tmppath);
         return;
     }
+    int64_t written = 0;
     gzFile gzfp = NULL;
     if (gzip) {
         int res;
@@ -2739,18 +3695,52 @@ void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbu
 
     struct aircraft copyback;
     struct aircraft *copy = &copyback;
+    // trace not restored yet, written as it was loaded
+    char *lazy = NULL;
+    struct traceLazyHeader lazyHeader;
     for (int j = start; j < end; j++) {
         for (struct aircraft *a = Modes.aircraft[j]; a || (j == end - 1); a = a->next) {
             int size_state = 0;
+            int delta = 0;
             if (!a) {
                 copy = NULL;
             } else {
+                // traceRestoreLazy publishes the parsed trace before clearing traceLazyLen
+                uint32_t lazyLen = __atomic_load_n(&a->traceLazyLen, __ATOMIC_ACQUIRE);
+                if (incremental && (lazyLen || a->seen <= a->stateSavedSeen)) {
+                    // unchanged since the last write
+                    continue;
+                }
+
                 // work on local copy of aircraft for traceUsePosBuffered
                 memcpy(copy, a, sizeof(struct aircraft));
 
                 traceUsePosBuffered(copy);
 
                 size_state += sizeof(struct aircraft);
+
+                // only the trace chunks that are new or were extended since the last write
+                // are appended, the rest of the record replaces what's in the blob
+                delta = incremental && a->stateSavedSeen && a->stateSavedChunkTs >= 0 && copy->trace_len > 0;
+                if (delta) {
+                    int firstChunk = 0;
+                    while (firstChunk < copy->trace_chunk_len && copy->trace_chunks[firstChunk].lastTimestamp <= a->stateSavedChunkTs) {
+                        copy->trace_len -= copy->trace_chunks[firstChunk].numStates;
+                        firstChunk++;
+                    }
+                    copy->trace_chunks += firstChunk;
+                    copy->trace_chunk_len -= firstChunk;
+                }
+
+                lazy = lazyLen ? copy->traceLazy : NULL;
+                if (lazy) {
+                    memcpy(&lazyHeader, lazy, sizeof(lazyHeader));
+                    copy->trace_len = lazyHeader.trace_len;
+                    copy->trace_chunk_len = 0;
+                    copy->trace_current_len = 0;
+                    size_state += lazyHeader.allocBytes - sizeof(lazyHeader);
+                }
+
                 if (copy->trace_chunk_len > 0 && copy->trace_chunks == NULL) {
                     fprintf(stderr, "<3> %06x trace corrupted, copy->trace_chunks is NULL but copy->trace_chunk_len > 0\n", copy->addr);
                 }
@@ -2763,6 +3753,13 @@ void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbu
 
                 // add space for 2 magic constants / 2 struct sizes
                 size_state += 4 * sizeof(uint64_t);
+                // and the schema record starting each chunk
+                size_state += stateSchemaBytes();
+            }
+
+            if (incremental && !copy && chunk_ac_count == 0) {
+                // nothing changed, don't append an empty chunk
+                break;
             }
 
             if (!copy || (p + size_state > buf + alloc)) {
@@ -2805,7 +3802,10 @@ void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbu
 
                     // end header
 
-                    check_write(fd, zst_out, compressed_len + zst_header_len, tmppath);
+                    if (check_write(fd, zst_out, compressed_len + zst_header_len, tmppath) != compressed_len + zst_header_len) {
+                        goto error;
+                    }
+                    written += compressed_len + zst_header_len;
                 } else if (lzo) {
                     int res = lzo1x_1_compress(buf, p - buf, lzo_out + lzo_header_len, &compressed_len, lzo_work);
 
@@ -2862,16 +3862,27 @@ void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbu
                 continue;
             }
 
+            if (chunk_ac_count == 0) {
+                p = writeStateSchema(p);
+            }
+
             chunk_ac_count++;
 
-            uint64_t magic = STATE_SAVE_MAGIC;
+            uint64_t magic = delta ? STATE_DELTA_MAGIC : STATE_SAVE_MAGIC;
             p += memcpySize(p, &magic, sizeof(magic));
             uint64_t size_aircraft = sizeof(struct aircraft);
             p += memcpySize(p, &size_aircraft, sizeof(size_aircraft));
 
+            if (lazy) {
+                copy->trace_chunk_len = lazyHeader.trace_chunk_len;
+                copy->trace_current_len = lazyHeader.trace_current_len;
+            }
+
             aircraftZeroTail(copy);
             p += memcpySize(p, copy, sizeof(struct aircraft));
-            if (copy->trace_len > 0) {
+            if (lazy) {
+                p += memcpySize(p, lazy + sizeof(lazyHeader), lazyHeader.allocBytes - sizeof(lazyHeader));
+            } else if (copy->trace_len > 0) {
 
                 uint64_t fourState_size = sizeof(fourState);
                 p += memcpySize(p, &fourState_size, sizeof(fourState_size));
@@ -2891,18 +3902,38 @@ void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbu
                 }
                 p += memcpySize(p, copy->trace_current, stateBytes(copy->trace_current_len));
             }
+
+            if (tracked) {
+                a->stateSavedSeen = copy->seen;
+                if (!lazy) {
+                    a->stateSavedChunkTs = copy->trace_chunk_len > 0 ? copy->trace_chunks[copy->trace_chunk_len - 1].lastTimestamp : 0;
+                }
+            }
         }
     }
 
+    // appended records only count once they're on disk, a torn append makes the next save a full rewrite
+    if (incremental && fsync(fd) < 0) {
+        perror("save_blob fsync()");
+        goto error;
+    }
+
     if (gzfp)
         gzclose(gzfp);
     else if (fd != -1)
         close(fd);
 
-    if (rename(tmppath, filename) == -1) {
+    if (incremental) {
+        blobLogBytes[blob] += written;
+    } else if (rename(tmppath, filename) == -1) {
         fprintf(stderr, "save_blob rename(): %s -> %s", tmppath, filename);
         perror("");
         unlink(tmppath);
+        written = 0;
+    }
+    if (tracked && !incremental) {
+        blobBaseBytes[blob] = written;
+        blobLogBytes[blob] = 0;
     }
     goto out;
 error:
@@ -2910,47 +3941,80 @@ error:
         gzclose(gzfp);
     else if (fd != -1)
         close(fd);
-    unlink(tmppath);
+    if (!incremental) {
+        unlink(tmppath);
+    }
+    if (tracked) {
+        // rewrite the blob completely next time
+        blobBaseBytes[blob] = 0;
+    }
 out:
     ;
 }
 
 static int load_aircrafts(char *p, char *end, char *filename, int64_t now, threadpool_buffer_t *passbuffer) {
     int count = 0;
+    struct stateMigration migrationStorage;
+    struct stateMigration *migration = NULL;
     while (end - p > 0) {
         uint64_t value = 0;
         if (end - p >= (long) sizeof(value)) {
             p += memcpySize(&value, p, sizeof(value));
         }
 
-        if (value != STATE_SAVE_MAGIC) {
+        if (value == STATE_SCHEMA_MAGIC) {
+            migration = &migrationStorage;
+            if (readStateSchema(&p, end, migration, filename) < 0) {
+                fprintf(stderr, "Corrupt state file (bad schema record): %s\n", filename);
+                return -1;
+            }
+            continue;
+        }
+
+        if (value != STATE_SAVE_MAGIC && value != STATE_DELTA_MAGIC) {
             if (value != STATE_SAVE_MAGIC_END) {
                 fprintf(stderr, "Incomplete state file (or state format was changed and is incompatible with new format): %s\n", filename);
                 return -1;
             }
             break;
         }
-        load_aircraft(&p, end, now, passbuffer);
+        load_aircraft(&p, end, now, passbuffer, migration, value == STATE_DELTA_MAGIC);
         count++;
     }
     return count;
 }
 
-void load_blob(char *blob, threadpool_threadbuffers_t * buffer_group) {
+// returns -1 if the blob is missing or was only loaded up to a corrupt part
+int load_blob(char *blob, threadpool_threadbuffers_t * buffer_group) {
     int64_t now = mstime();
+    int res = -1;
     int fd = -1;
     struct char_buffer cb;
     char *p;
     char *end;
     int lzo = 0;
     int zst = 0;
+    int mapped = 0;
     char filename[1024];
 
     snprintf(filename, 1024, "%s.zstl", blob);
     fd = open(filename, O_RDONLY);
     if (fd != -1) {
         zst = 1;
-        cb = readWholeFile(fd, filename);
+        // map the file instead of copying it, the chunks are decompressed from the mapping in order
+        struct stat fileinfo = { 0 };
+        if (fstat(fd, &fileinfo) == 0 && fileinfo.st_size > 0) {
+            cb.len = fileinfo.st_size;
+            cb.buffer = mmap(NULL, cb.len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (cb.buffer == MAP_FAILED) {
+                cb = readWholeFile(fd, filename);
+            } else {
+                mapped = 1;
+                madvise(cb.buffer, cb.len, MADV_SEQUENTIAL);
+            }
+        } else {
+            cb = readWholeFile(fd, filename);
+        }
         close(fd);
     } else {
         Modes.writeInternalState = 1; // not the primary load method, immediately write state
@@ -2974,7 +4038,7 @@ void load_blob(char *blob, threadpool_threadbuffers_t * buffer_group) {
                     fprintf(stderr, "missing state blob:");
                     snprintf(filename, 1024, "%s[.gz/.lzol/.zstl]", blob);
                     perror(filename);
-                    return;
+                    return -1;
                 }
                 cb = readWholeFile(fd, filename);
                 close(fd);
@@ -2983,7 +4047,7 @@ void load_blob(char *blob, threadpool_threadbuffers_t * buffer_group) {
         }
     }
     if (!cb.buffer)
-        return;
+        return -1;
     p = cb.buffer;
     end = p + cb.len;
 
@@ -3072,11 +4136,19 @@ decompress:
             p += compressed_len;
         }
     } else {
-        load_aircrafts(p, end, filename, now, pb2);
+        if (load_aircrafts(p, end, filename, now, pb2) < 0) {
+            goto out;
+        }
     }
+    res = 0;
 
 out:
-    sfree(cb.buffer);
+    if (mapped) {
+        munmap(cb.buffer, cb.len);
+    } else {
+        sfree(cb.buffer);
+    }
+    return res;
 }
 
 static void load_blobs(void *arg, threadpool_threadbuffers_t * buffer_group) {
@@ -3085,7 +4157,19 @@ static void load_blobs(void *arg, threadpool_threadbuffers_t * buffer_group) {
     for (int j = info->from; j < info->to; j++) {
         char blob[1024];
         snprintf(blob, 1024, "%s/blob_%02x", Modes.state_dir, j);
-        load_blob(blob, buffer_group);
+        int res = load_blob(blob, buffer_group);
+
+        // the loaded aircraft are marked as written, incremental saves can append to the file
+        // unless it ends in a corrupt or torn chunk, then the first save rewrites it completely
+        char filename[1024];
+        snprintf(filename, 1024, "%s.zstl", blob);
+        struct stat fileinfo = { 0 };
+        if (res == 0 && stat(filename, &fileinfo) == 0) {
+            blobBaseBytes[j] = fileinfo.st_size;
+        } else {
+            blobBaseBytes[j] = 0;
+        }
+        blobLogBytes[j] = 0;
     }
 }
 
@@ -3581,6 +4665,7 @@ void readInternalState() {
     startWatch(&watch);
 
     int64_t now = mstime();
+    Modes.traceLazyStart = now;
 
     int parts = STATE_BLOBS;
     int stride = 1;
@@ -3618,11 +4703,21 @@ void readInternalState() {
     }
 
     // run tasks
+    // the blobs are loaded in parallel, the aircraft index is rebuilt afterwards
+    aircraftIndexFreeze();
     threadpool_run(pool, tasks, taskCount);
+    aircraftIndexRebuild();
 
     threadpool_destroy(pool);
     destroy_task_group(group);
 
+    if (Modes.traceDictMissing) {
+        // continuing would discard those traces and overwrite the state
+        fprintf(stderr, "FATAL: trace chunks in the state need trace dictionary %u, restore the --trace-dict file holding it!\n",
+                (unsigned) Modes.traceDictMissing);
+        exit(1);
+    }
+
     int64_t aircraftCount = 0; // includes quite old aircraft, just for checking hash table fill
     for (int j = 0; j < AIRCRAFT_BUCKETS; j++) {
         for (struct aircraft *a = Modes.aircraft[j]; a; a = a->next) {
@@ -3633,6 +4728,9 @@ void readInternalState() {
 
     double elapsed = stopWatch(&watch) / 1000.0;
     fprintf(stderr, " .......... done, loaded %llu aircraft in %.3f seconds!\n", (unsigned long long) aircraftCount, elapsed);
+    if (Modes.traceLazyCount > 0) {
+        fprintf(stderr, "%d traces will be restored on first use or in the background\n", (int) Modes.traceLazyCount);
+    }
     fprintf(stderr, "aircraft table fill: %0.1f\n", aircraftCount / (double) AIRCRAFT_BUCKETS );
 }
 
@@ -3687,6 +4785,8 @@ void traceDelete() {
             goto next;
         }
 
+        traceRestoreLazy(a, mstime());
+
         traceUnlink(a);
         unlinkPerm(a);
 
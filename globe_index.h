@@ -43,8 +43,11 @@ int globe_index(double lat_in, double lon_in);
 int globe_index_index(int index);
 void init_globe_index();
 void cleanup_globe_index();
-void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbuffer2, char *stateDir);
-void load_blob(char *blob, threadpool_threadbuffers_t * buffer_group);
+void traceDictInit();
+void traceDictTrain();
+void traceDictCleanup();
+void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbuffer2, char *stateDir, int incremental);
+int load_blob(char *blob, threadpool_threadbuffers_t * buffer_group);
 void writeRangeDirs();
 void writeInternalState();
 void readInternalState();
@@ -53,6 +56,7 @@ void traceCleanup(struct aircraft *a);
 int traceAdd(struct aircraft *a, struct modesMessage *mm, int64_t now, int stale);
 int traceUsePosBuffered(struct aircraft *a);
 void traceMaintenance(struct aircraft *a, int64_t now, threadpool_buffer_t *passbuffer);
+void traceRestoreLazy(struct aircraft *a, int64_t now);
 
 int handleHeatmap(int64_t now);
 
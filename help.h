@@ -44,7 +44,7 @@ static struct argp_option optionsViewadsb[] = {
     {"receiver-focus", OptReceiverFocus, "<receiverId>", 0, "only process messages from receiverId", 1},
     {"cpr-focus", OptCprFocus, "<hex>", 0, "show CPR details for this hex", 1},
     {"quiet", OptQuiet, 0, 0, "Disable output (default)", 1},
-    {"debug", OptDebug, "<flags>", 0, "Debug mode (verbose), n: network, P: CPR, S: speed check", 1},
+    {"debug", OptDebug, "<flags>", 0, "Debug mode (verbose), n: network, P: CPR, S: speed check, z: no SIMD", 1},
     {0,0,0,0, "Network options:", 2},
     {"net-connector", OptNetConnector, "<ip,port,protocol>", 0, "Establish connection, can be specified multiple times (viewadsb default: --net-connector 127.0.0.1,30005,beast_in viewadsb first usage overrides default, second usage adds another input/output) Protocols: beast_out, beast_in, raw_out, raw_in, sbs_in, sbs_in_jaero, sbs_out, sbs_out_jaero, vrs_out, json_out, gpsd_in, uat_in, uat_replay_out, planefinder_in, asterix_in, asterix_out (one failover ip/address,port can be specified: primary-address,primary-port,protocol,failover-address,failover-port) (any position in the comma separated list can also be either silent_fail or uuid=<uuid>)", 2},
     {0,0,0,0, "Help options:", 100},
@@ -73,6 +73,7 @@ static struct argp_option optionsReadsb[] = {
     {"interactive", OptInteractive, 0, 0, "Interactive mode refreshing data on screen. Implies --throttle", 1},
     {"raw", OptRaw, 0, 0, "Show only messages hex values", 1},
     {"preamble-threshold", OptPreambleThreshold, "<"stringize(PREAMBLE_THRESHOLD_MIN)"-"stringize(PREAMBLE_THRESHOLD_MAX)">", 0, "lower threshold --> more CPU usage (default: "stringize(PREAMBLE_THRESHOLD_DEFAULT)", pi zero / pi 1: "stringize(PREAMBLE_THRESHOLD_PIZERO)", hot CPU "stringize(PREAMBLE_THRESHOLD_HOT)")", 1},
+    {"demod-threads", OptDemodThreads, "<n>", 0, "Number of threads demodulating each sample buffer (default: 1). Only useful if a single core can't keep up with the sample rate", 1},
     {"forward-mlat", OptForwardMlat, 0, 0, "Forward received beast mlat results to beast output ports", 1},
     {"forward-mlat-sbs", OptForwardMlatSbs, 0, 0, "Forward received mlat results to sbs output ports", 1},
     {"mlat", OptMlat, 0, OPTION_HIDDEN, "Display raw messages in Beast ASCII mode", 1},
@@ -84,7 +85,7 @@ static struct argp_option optionsReadsb[] = {
     {"onlyaddr", OptOnlyAddr, 0, 0, "Show only ICAO addresses", 1},
     {"gnss", OptGnss, 0, 0, "Show altitudes as GNSS when available", 1},
     {"snip", OptSnip, "<level>", 0, "Strip IQ file removing samples < level", 1},
-    {"debug", OptDebug, "<flags>", 0, "Debug mode (verbose), n: network, P: CPR, S: speed check", 1},
+    {"debug", OptDebug, "<flags>", 0, "Debug mode (verbose), n: network, P: CPR, S: speed check, z: no SIMD", 1},
     {"devel", OptDevel, "<mode>", 0, "Development debugging mode, see source for options, can be specified more than once", 1},
     {"receiver-focus", OptReceiverFocus, "<receiverId>", 0, "only process messages from receiverId", 1},
     {"cpr-focus", OptCprFocus, "<hex>", 0, "show CPR details for this hex", 1},
@@ -99,6 +100,10 @@ static struct argp_option optionsReadsb[] = {
     {"write-state", OptStateDir, "<dir>", 0, "Write state to disk to have traces after a restart", 1},
     {"write-state-every", OptStateInterval, "<seconds>", 0, "Continuously write state to disk every X seconds (default: 3600)", 1},
     {"write-state-only-on-exit", OptStateOnlyOnExit, 0, 0, "Don't continously update state.", 1},
+    {"write-state-incremental", OptStateIncremental, 0, 0, "Continuous state writes only append aircraft that changed, blobs are rewritten when the appended part gets larger than the rest.", 1},
+    {"trace-dict", OptTraceDict, "<file>", 0, "zstd dictionary for the trace chunks, trained from the first few MB of chunks and saved to the file if it doesn't exist. readsb refuses to start if the trace chunks in the state need a dictionary other than the one in the file. A state written with it can only be loaded by readsb versions supporting it", 1},
+    {"trace-columnar", OptTraceColumnar, 0, 0, "Delta encode trace chunks column by column before compressing them, smaller state and trace memory. A state written with it can only be loaded by readsb versions supporting it", 1},
+    {"write-state-lazy-traces", OptStateLazyTraces, 0, 0, "Load only aircraft on startup, traces are restored on first use or in the background.", 1},
     {"heatmap-dir", OptHeatmapDir, "<dir>", 0, "Change the directory where heatmaps are saved (default is in globe history dir)", 1},
     {"heatmap", OptHeatmap, "<interval in seconds>", 0, "Make Heatmap, each aircraft at most every interval seconds (creates historydir/heatmap.bin and exit after that)", 1},
     {"dump-beast", OptDumpBeastDir, "<dir>,<interval>", 0, "Dump compressed beast files to this directory, start a new file evey interval seconds", 1},
@@ -141,6 +146,10 @@ static struct argp_option optionsReadsb[] = {
     {"net-json-port-include-noposition", OptNetJsonPortNoPos, 0, 0, "TCP json position output: include aircraft without position (state is sent for aircraft for every DF11 with CRC if the aircraft hasn't sent a position in the last 10 seconds and interval allowing)", 2},
     {"net-api-port", OptNetApiPorts, "<port>", 0, "TCP API listen port (in contrast to other listeners, only a single port is allowed) (update frequency controlled by write-json-every parameter) (default: 0)", 2},
     {"api-shutdown-delay", OptApiShutdownDelay, "<seconds>", 0, "Shutdown delay to server remaining API queries, new queries get a 503 response (default: 0)", 2},
+    {"api-cache-size", OptApiCacheSize, "<MiB>", 0, "Memory for caching compressed binCraft / &fields= API responses, identical queries against the same API update are only compressed once (default: 16, 0 to disable)", 2},
+    {"api-incremental", OptApiIncremental, "<seconds>", 0, "Only serialize aircraft with new messages for each API update, reuse the json / binCraft of the others for up to this long. Trade-off: while an aircraft's message count is unchanged its entry can lag by up to this long (seen, seen_pos and other age fields are that much out of date). This applies to the API and to aircraft.json, aircraft.binCraft and the globe files, which are built from the same entries (default: 0, disabled)", 2},
+    {"api-slow-query", OptApiSlowQuery, "<milliseconds>", 0, "Log API queries taking longer than this to stderr, at most one line every 5 seconds per API thread (default: 0, disabled)", 2},
+    {"api-update-threads", OptApiUpdateThreads, "<n>", 0, "Number of threads serializing aircraft for the API and aircraft.json (default: 1). Only useful with a very large number of aircraft", 2},
     {"tar1090-use-api", OptTar1090UseApi, 0, 0, "when running with globe-index, signal tar1090 use the readsb API to get data, requires webserver mapping of /tar1090/re-api to proxy_pass the requests to the --net-api-port, see nginx-readsb-api.conf in the tar1090 repository for details", 2},
     {"net-beast-reduce-out-port", OptNetBeastReducePorts, "<ports>", 0, "TCP BeastReduce output listen ports (default: 0)", 2},
     {"net-beast-reduce-interval", OptNetBeastReduceInterval, "<seconds>", 0, "BeastReduce data update interval, longer means less data (default: 0.250, valid range: 0.000 - 14.999)", 2},
@@ -151,7 +160,8 @@ static struct argp_option optionsReadsb[] = {
     {"net-receiver-id", OptNetReceiverId, 0, 0, "forward receiver ID", 2},
     {"net-ingest", OptNetIngest, 0, 0, "primary ingest node", 2},
     {"net-garbage", OptGarbage, "<ports>", 0, "timeout receivers, output messages from timed out receivers as beast on <ports>", 2},
-    {"decode-threads", OptDecodeThreads, "<n>", 0, "Number of decode threads, either 1 or 2 (default: 1). Only use 2 when you have beast traffic > 200 MBit/s, expect 1.4x speedup for 2x CPU", 2},
+    {"decode-threads", OptDecodeThreads, "<n>", 0, "Number of decode threads (default: 1). Network input connections are distributed among the threads and parsed in parallel. Only useful for beast traffic > 200 MBit/s", 2},
+    {"track-shards", OptTrackShards, "<n>", 0, "Split tracking of network input into n threads by ICAO address (default: 0, disabled). Only useful for very high message rates", 2},
     {"uuid-file", OptUuidFile, "<path>", 0, "path to UUID file", 2},
     {"net-ro-size", OptNetRoSize, "<size>", 0, "TCP output flush size (maximum amount of internally buffered data before writing to network) (default: 1200)", 2},
     {"net-ro-interval", OptNetRoInterval, "<seconds>", 0, "TCP output flush interval in seconds (maximum delay between placing data in the output buffer and sending)(default: 0.05, valid values 0.0 - 1.0)", 2},
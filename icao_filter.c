@@ -35,6 +35,10 @@ static uint32_t *icao_filter_b;
 static uint32_t *icao_filter_active;
 
 static uint32_t occupied;
+static uint32_t minBits;
+
+// serializes adding addresses when multiple decode threads are running
+static pthread_mutex_t filterMutex = PTHREAD_MUTEX_INITIALIZER;
 
 static inline uint32_t filterHash(uint32_t addr) {
     return addrHash(addr, filterBits);
@@ -45,7 +49,9 @@ static inline uint32_t filterHash(uint32_t addr) {
 #define MAXBITS 20
 
 void icaoFilterInit() {
-    filterBits = MINBITS;
+    // with multiple decode threads the tables only grow between decoding runs, start bigger
+    minBits = (Modes.decodeThreads > 1) ? 16 : MINBITS;
+    filterBits = minBits;
     filterBuckets = 1ULL << filterBits;
     filterSize = filterBuckets * sizeof(uint32_t);
     occupied = 0;
@@ -62,6 +68,22 @@ void icaoFilterDestroy() {
     sfree(icao_filter_b);
 }
 
+static void filterInsert(uint32_t addr) {
+    uint32_t h, h0;
+    h0 = h = filterHash(addr);
+    while (icao_filter_active[h] != EMPTY && icao_filter_active[h] != addr) {
+        h = (h + 1) & (filterBuckets - 1);
+        if (h == h0) {
+            fprintf(stderr, "ICAO hash table full, this shouldn't happen\n");
+            return;
+        }
+    }
+    if (icao_filter_active[h] == EMPTY) {
+        occupied++;
+        icao_filter_active[h] = addr;
+    }
+}
+
 static void icaoFilterResize(uint32_t bits) {
     uint32_t oldBuckets = filterBuckets;
     uint32_t *oldActive = icao_filter_active;
@@ -85,7 +107,7 @@ static void icaoFilterResize(uint32_t bits) {
     icao_filter_active = icao_filter_a;
     for (uint32_t i = 0; i < oldBuckets; i++) {
         if (oldActive[i] != EMPTY) {
-            icaoFilterAdd(oldActive[i]);
+            filterInsert(oldActive[i]);
         }
     }
     sfree(oldA);
@@ -94,7 +116,7 @@ static void icaoFilterResize(uint32_t bits) {
 
 // call this periodically:
 void icaoFilterExpire() {
-    if (occupied < filterBuckets / 9 && filterBits > MINBITS) {
+    if (occupied < filterBuckets / 9 && filterBits > minBits) {
         icaoFilterResize(filterBits - 1);
     }
     // reset occupied count
@@ -110,21 +132,23 @@ void icaoFilterExpire() {
 }
 
 void icaoFilterAdd(uint32_t addr) {
-    uint32_t h, h0;
-    h0 = h = filterHash(addr);
-    while (icao_filter_active[h] != EMPTY && icao_filter_active[h] != addr) {
-        h = (h + 1) & (filterBuckets - 1);
-        if (h == h0) {
-            fprintf(stderr, "ICAO hash table full, this shouldn't happen\n");
-            return;
-        }
-    }
-    if (icao_filter_active[h] == EMPTY) {
-        occupied++;
-        icao_filter_active[h] = addr;
+    if (Modes.decodeThreads > 1) {
+        // other decode threads are testing concurrently, the tables can't be resized here
+        // that's done by icaoFilterMaintain once the decode threads are done
+        pthread_mutex_lock(&filterMutex);
+        filterInsert(addr);
+        pthread_mutex_unlock(&filterMutex);
+        return;
     }
 
-    if (occupied > filterBuckets / 3 && filterBits < 20) {
+    filterInsert(addr);
+
+    icaoFilterMaintain();
+}
+
+// grow the tables if necessary, must not be called concurrently with icaoFilterTest
+void icaoFilterMaintain() {
+    if (occupied > filterBuckets / 3 && filterBits < MAXBITS) {
         icaoFilterResize(filterBits + 1);
     }
 }
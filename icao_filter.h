@@ -31,6 +31,9 @@ void icaoFilterDestroy();
 // Add an address to the filter
 void icaoFilterAdd (uint32_t addr);
 
+// Grow the filter if needed, called periodically when running multiple decode threads
+void icaoFilterMaintain ();
+
 // Test if the given address matches the filter
 int icaoFilterTest (uint32_t addr);
 
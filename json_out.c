@@ -1014,207 +1014,6 @@ int includeAircraftJson(int64_t now, struct aircraft *a) {
     return 0;
 }
 
-struct char_buffer generateAircraftBin(threadpool_buffer_t *pbuffer) {
-    struct char_buffer cb;
-    int64_t now = mstime();
-    struct aircraft *a;
-
-    struct craftArray *ca = &Modes.aircraftActive;
-    ca_lock_read(ca);
-    size_t alloc = 4096 + (ca->len + 64) * sizeof(struct binCraft);
-
-    char *buf = check_grow_threadpool_buffer_t(pbuffer, alloc);
-    char *p = buf;
-    char *end = buf + alloc;
-
-    uint32_t elementSize = sizeof(struct binCraft);
-    memset(p, 0, elementSize);
-
-#define memWrite(p, var) do { memcpy(p, &var, sizeof(var)); p += sizeof(var); } while(0)
-
-    memWrite(p, now);
-
-    memWrite(p, elementSize);
-
-    uint32_t ac_count_pos = Modes.globalStatsCount.readsb_aircraft_with_position;
-    memWrite(p, ac_count_pos);
-
-    uint32_t index = 314159; // unnecessary
-    memWrite(p, index);
-
-    int16_t south = -90;
-    int16_t west = -180;
-    int16_t north = 90;
-    int16_t east = 180;
-
-    memWrite(p, south);
-    memWrite(p, west);
-    memWrite(p, north);
-    memWrite(p, east);
-
-    uint32_t messageCount = Modes.stats_current.messages_total + Modes.stats_alltime.messages_total;
-    memWrite(p, messageCount);
-
-    int32_t receiver_lat = 0;
-    int32_t receiver_lon = 0;
-    if (Modes.userLocationValid) {
-        if (Modes.json_location_accuracy == 1) {
-            receiver_lat = (int32_t) (1E4 * nearbyint(Modes.fUserLat * 1E2));
-            receiver_lon = (int32_t) (1E4 * nearbyint(Modes.fUserLon * 1E2));
-        } else if (Modes.json_location_accuracy == 2) {
-            receiver_lat = (int32_t) nearbyint(Modes.fUserLat * 1E6);
-            receiver_lon = (int32_t) nearbyint(Modes.fUserLon * 1E6);
-        }
-    }
-    memWrite(p, receiver_lat);
-    memWrite(p, receiver_lon);
-
-    memWrite(p, Modes.binCraftVersion);
-
-    if (p - buf > (int) elementSize)
-        fprintf(stderr, "aircraftBin: header too large oos4tooT\n");
-
-    p = buf + elementSize;
-
-    for (int i = 0; i < ca->len; i++) {
-        a = ca->list[i];
-        if (a == NULL) continue;
-
-        if (!includeAircraftJson(now, a)) {
-            continue;
-        }
-        // check if we have enough space
-        if ((p + 2 * sizeof(struct binCraft)) >= end) {
-            fprintf(stderr, "increase buffer size: iXok9ieD\n");
-            break;
-        }
-
-        toBinCraft(a, (struct binCraft *) p, now);
-        p += sizeof(struct binCraft);
-
-    }
-
-    ca_unlock_read(ca);
-
-    cb.len = p - buf;
-    cb.buffer = buf;
-    return cb;
-
-#undef memWrite
-}
-
-struct char_buffer generateGlobeBin(int globe_index, int mil, threadpool_buffer_t *pbuffer) {
-    struct char_buffer cb = { 0 };
-    int64_t now = mstime();
-    struct aircraft *a;
-    ssize_t alloc = 4096 + 4 * sizeof(struct binCraft);
-
-    struct craftArray *ca = NULL;
-
-    if (globe_index == -1) {
-        ca = &Modes.aircraftActive;
-    } else if (globe_index <= GLOBE_MAX_INDEX) {
-        ca = &Modes.globeLists[globe_index];
-    }
-
-    if (!ca) {
-        fprintf(stderr, "generateGlobeBin: bad globe_index: %d\n", globe_index);
-        return cb;
-    }
-
-    ca_lock_read(ca);
-
-    alloc += ca->len * sizeof(struct binCraft);
-
-    char *buf = check_grow_threadpool_buffer_t(pbuffer, alloc);
-    char *p = buf;
-    char *end = buf + alloc;
-
-    uint32_t elementSize = sizeof(struct binCraft);
-    memset(p, 0, elementSize);
-
-#define memWrite(p, var) do { memcpy(p, &var, sizeof(var)); p += sizeof(var); } while(0)
-
-    memWrite(p, now);
-
-    memWrite(p, elementSize);
-
-    uint32_t ac_count_pos = Modes.globalStatsCount.readsb_aircraft_with_position;
-    memWrite(p, ac_count_pos);
-
-    uint32_t index = globe_index < 0 ? 42777 : globe_index;
-    memWrite(p, index);
-
-    int16_t south = -90;
-    int16_t west = -180;
-    int16_t north = 90;
-    int16_t east = 180;
-
-    if (globe_index >= GLOBE_MIN_INDEX) {
-        int grid = GLOBE_INDEX_GRID;
-        south = ((globe_index - GLOBE_MIN_INDEX) / GLOBE_LAT_MULT) * grid - 90;
-        west = ((globe_index - GLOBE_MIN_INDEX) % GLOBE_LAT_MULT) * grid - 180;
-        north = south + grid;
-        east = west + grid;
-    } else if (globe_index >= 0) {
-        struct tile *tiles = Modes.json_globe_special_tiles;
-        struct tile tile = tiles[globe_index];
-        south = tile.south;
-        west = tile.west;
-        north = tile.north;
-        east = tile.east;
-    }
-
-    memWrite(p, south);
-    memWrite(p, west);
-    memWrite(p, north);
-    memWrite(p, east);
-
-    uint32_t messageCount = Modes.stats_current.messages_total + Modes.stats_alltime.messages_total;
-    memWrite(p, messageCount);
-
-    int32_t dummy1 = 0;
-    memWrite(p, dummy1);
-
-    int32_t dummy2 = 0;
-    memWrite(p, dummy2);
-
-    memWrite(p, Modes.binCraftVersion);
-
-    if (p - buf > (int) elementSize)
-        fprintf(stderr, "buffer overrun globeBin\n");
-
-    p = buf + elementSize;
-
-    for (int i = 0; i < ca->len; i++) {
-        a = ca->list[i];
-        if (a == NULL) continue;
-
-        if (!includeAircraftJson(now, a))
-            continue;
-
-        if (mil && !(a->dbFlags & 1))
-            continue;
-        // check if we have enough space
-        if ((p + 2 * sizeof(struct binCraft)) >= end) {
-            fprintf(stderr, "buffer insufficient globeBin\n");
-            break;
-        }
-
-        toBinCraft(a, (struct binCraft *) p, now);
-        p += sizeof(struct binCraft);
-
-    }
-
-    ca_unlock_read(ca);
-
-    cb.len = p - buf;
-    cb.buffer = buf;
-    return cb;
-
-#undef memWrite
-}
-
 struct char_buffer generateGlobeJson(int globe_index, threadpool_buffer_t *pbuffer) {
     struct char_buffer cb = { 0 };
     int64_t now = mstime();
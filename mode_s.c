@@ -1072,7 +1072,7 @@ static void decodeESAirbornePosition(struct modesMessage *mm, int check_imf) {
             //   400648 (BAE ATP) - Atlantic Airlines
             // altitude == 0, longitude == 0, type == 15 and zeros in latitude LSB.
             // Can alternate with valid reports having type == 14
-            Modes.stats_current.cpr_filtered++;
+            STATS_CURRENT->cpr_filtered++;
         } else {
             // Otherwise, assume it's valid.
             mm->cpr_valid = 1;
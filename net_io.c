@@ -223,6 +223,16 @@ static uint8_t char_to_ais(int ch)
         return 32;
 }
 
+// place private data queued in the SendQ at the current ring head, the ring head
+// is always the end of a complete write so it never ends up in the middle of a message
+// call this when appending to the SendQ
+static void sendqPlace(struct client *c) {
+    if (c->sendqAnchor < 0) {
+        struct net_writer *writer = c->service->writer;
+        c->sendqAnchor = writer ? writer->ringHead : 0;
+    }
+}
+
 static int sendFiveHeartbeats(struct client *c, int64_t now) {
     // only send 5 heartbeats for beast type output
     if (c->service->heartbeat_out.msg != beast_heartbeat.msg) {
@@ -236,6 +246,7 @@ static int sendFiveHeartbeats(struct client *c, int64_t now) {
     int heartbeat_len = c->service->heartbeat_out.len;
 
     if (heartbeat_msg && c->sendq && c->sendq_len + repeats * heartbeat_len < c->sendq_max) {
+        sendqPlace(c);
         for (int k = 0; k < repeats; k++) {
             memcpy(c->sendq + c->sendq_len, heartbeat_msg, heartbeat_len);
             c->sendq_len += heartbeat_len;
@@ -330,19 +341,29 @@ static struct client *createSocketClient(struct net_service *service, int fd) {
 
     c->buf = cmalloc(c->bufmax);
 
+    c->sendqAnchor = -1;
     if (service->writer) {
-        c->sendq_max = MODES_NET_SNDBUF_SIZE << Modes.net_sndbuf_size;
-        if (service->sendqOverrideSize) {
-            c->sendq_max = service->sendqOverrideSize;
-        }
+        struct net_writer *writer = service->writer;
+        // the bulk of the output goes through the ring shared by all clients of the writer
+        // the client only needs a small SendQ for pings and commands
+        c->sendq_max = MODES_NET_SENDQ_PRIVATE;
         if (!(c->sendq = cmalloc(c->sendq_max))) {
             fprintf(stderr, "Out of memory allocating client SendQ\n");
             exit(1);
         }
         // Have to keep track of this manually
-        service->writer->lastReceiverId = 0; // make sure to resend receiverId
-
-        service->writer->connections++;
+        writer->lastReceiverId = 0; // make sure to resend receiverId
+
+        // the ring is reference counted by the number of connections
+        // it might still be allocated if a batched sendmsg of a closed client was in flight, see serviceFreeClients()
+        if (writer->connections++ == 0 && !writer->ring) {
+            writer->ringSize = getSNDBUF(service);
+            if (!(writer->ring = cmalloc(writer->ringSize))) {
+                fprintf(stderr, "Out of memory allocating writer ring\n");
+                exit(1);
+            }
+        }
+        c->ringPos = writer->ringHead;
     }
     service->connections++;
     Modes.modesClientCount++;
@@ -359,11 +380,26 @@ static struct client *createSocketClient(struct net_service *service, int fd) {
         service->writer->lastWrite = now; // suppress heartbeat initially
     }
 
+    int epfd = Modes.net_epfd;
+    if (Modes.decodeThreads > 1 && service->group == &Modes.services_in && !c->serial) {
+        // hand the client to the decode worker with the least clients
+        struct messageBuffer *owner = &Modes.netMessageBuffer[0];
+        for (int k = 1; k < Modes.decodeThreads; k++) {
+            struct messageBuffer *buf = &Modes.netMessageBuffer[k];
+            if (buf->clientCount < owner->clientCount) {
+                owner = buf;
+            }
+        }
+        owner->clientCount++;
+        c->owner = owner;
+        epfd = owner->epfd;
+    }
+
     epoll_data_t data;
     data.ptr = c;
     c->epollEvent.events = EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP;
     c->epollEvent.data = data;
-    if (epoll_ctl(Modes.net_epfd, EPOLL_CTL_ADD, c->fd, &c->epollEvent))
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &c->epollEvent))
         perror("epoll_ctl fail:");
 
     return c;
@@ -401,6 +437,7 @@ static int sendUUID(struct client *c, int64_t now) {
             }
             uuid[res] = '\0';
 
+            sendqPlace(c);
             c->sendq[c->sendq_len++] = 0x1A;
             c->sendq[c->sendq_len++] = 0xE4;
             // uuid is padded with 'f', always send 36 chars
@@ -415,6 +452,7 @@ static int sendUUID(struct client *c, int64_t now) {
 
         // enable ping stuff
         // O for high resolution timer, both P and p already used for previous iterations
+        sendqPlace(c);
         c->sendq[c->sendq_len++] = 0x1a;
         c->sendq[c->sendq_len++] = 'W';
         c->sendq[c->sendq_len++] = 'O';
@@ -505,6 +543,7 @@ static void checkServiceConnected(struct net_connector *con, int64_t now) {
             fprintTime(stderr, now);
             fprintf(stderr, " gpsdebug: sending \'?WATCH={\"enable\":true,\"json\":true};\\n\'\n");
         }
+        sendqPlace(c);
         c->sendq_len += snprintf(c->sendq, 256, "?WATCH={\"enable\":true,\"json\":true};\n");
         if (flushClient(c, now) < 0) {
             return;
@@ -856,6 +895,8 @@ static void initMessageBuffers() {
         Modes.decodePool = threadpool_create(Modes.decodeThreads, 0);
     }
 
+    trackShardsInit();
+
     Modes.netMessageBuffer = cmalloc(Modes.decodeThreads * sizeof(struct messageBuffer));
     memset(Modes.netMessageBuffer, 0x0, Modes.decodeThreads * sizeof(struct messageBuffer));
     for (int k = 0; k < Modes.decodeThreads; k++) {
@@ -864,12 +905,38 @@ static void initMessageBuffers() {
         buf->len = 0;
         buf->id = k;
         buf->activeClient = NULL;
+        buf->epfd = -1;
+        reset_stats(&buf->stats);
         int bytes = buf->alloc * sizeof(struct modesMessage);
         buf->msg = cmalloc(bytes);
+
+        buf->encoded = cmalloc(buf->alloc * sizeof(struct encodedMessage));
+        buf->slab[FORMAT_BEAST] = cmalloc(buf->alloc * BEAST_FRAME_MAX);
+        buf->slab[FORMAT_RAW] = cmalloc(buf->alloc * RAW_LINE_MAX);
+        buf->slab[FORMAT_SBS] = cmalloc(buf->alloc * SBS_LINE_MAX);
         //fprintf(stderr, "netMessageBuffer alloc: %d size: %d\n", buf->alloc, bytes);
     }
 }
 
+// each decode worker gets its own epoll instance for the input clients it owns
+// the worker epoll fds are added to the main epoll to wake up the network loop
+static void initDecodeWorkers() {
+    if (Modes.decodeThreads < 2)
+        return;
+
+    for (int k = 0; k < Modes.decodeThreads; k++) {
+        struct messageBuffer *buf = &Modes.netMessageBuffer[k];
+        buf->epfd = my_epoll_create(&Modes.exitNowEventfd);
+        epollAllocEvents(&buf->events, &buf->maxEvents);
+
+        struct epoll_event epollEvent = { .events = EPOLLIN, .data = { .ptr = &Modes.decodeWorkerEvent }};
+        if (epoll_ctl(Modes.net_epfd, EPOLL_CTL_ADD, buf->epfd, &epollEvent)) {
+            perror("epoll_ctl fail:");
+            exit(1);
+        }
+    }
+}
+
 void modesInitNet(void) {
     initMessageBuffers();
 
@@ -921,6 +988,16 @@ void modesInitNet(void) {
 
     Modes.net_epfd = my_epoll_create(&Modes.exitNowEventfd);
 
+#ifdef ENABLE_IO_URING
+    if (uringInit(NET_URING_ENTRIES) == 0) {
+        fprintf(stderr, "Using io_uring to batch network reads and writes.\n");
+    } else {
+        fprintf(stderr, "io_uring not available, using plain network syscalls.\n");
+    }
+#endif
+
+    initDecodeWorkers();
+
     // set up listeners
     raw_out = serviceInit(&Modes.services_out, "Raw TCP output", &Modes.raw_out, raw_heartbeat, no_heartbeat, READ_MODE_IGNORE, NULL, NULL);
     serviceListen(raw_out, Modes.net_bind_address, Modes.net_output_raw_ports, Modes.net_epfd);
@@ -1202,7 +1279,16 @@ static void modesCloseClient(struct client *c) {
                 uuid, c->proxy_string);
     }
 
-    epoll_ctl(Modes.net_epfd, EPOLL_CTL_DEL, c->fd, &c->epollEvent);
+    if (Modes.decodeThreads > 1) {
+        pthread_mutex_lock(&Modes.decodeLock);
+    }
+
+    if (c->owner) {
+        epoll_ctl(c->owner->epfd, EPOLL_CTL_DEL, c->fd, &c->epollEvent);
+        c->owner->clientCount--;
+    } else {
+        epoll_ctl(Modes.net_epfd, EPOLL_CTL_DEL, c->fd, &c->epollEvent);
+    }
     if (c->serial) {
         if (close(c->fd) < 0) {
             fprintf(stderr, "Serial client close error: %s\n", strerror(errno));
@@ -1213,6 +1299,7 @@ static void modesCloseClient(struct client *c) {
     c->service->connections--;
     Modes.modesClientCount--;
     if (c->service->writer) {
+        // the ring is freed by serviceFreeClients() once no batched sendmsg reads from it
         c->service->writer->connections--;
     }
     struct net_connector *con = c->con;
@@ -1247,6 +1334,10 @@ static void modesCloseClient(struct client *c) {
 
     if (Modes.mode_ac_auto)
         autoset_modeac();
+
+    if (Modes.decodeThreads > 1) {
+        pthread_mutex_unlock(&Modes.decodeLock);
+    }
 }
 
 static void lockReceiverId(struct client *c) {
@@ -1293,6 +1384,7 @@ static void pingClient(struct client *c, uint32_t ping) {
     ping = ping & ((1 << 24) - 1);
     if (c->sendq_len + 8 >= c->sendq_max)
         return;
+    sendqPlace(c);
     char *p = c->sendq + c->sendq_len;
 
     *p++ = 0x1a;
@@ -1393,7 +1485,7 @@ static int pongReceived(struct client *c, int64_t now) {
             break;
         }
     }
-    Modes.stats_current.remote_ping_rtt[bucket]++;
+    STATS_CURRENT->remote_ping_rtt[bucket]++;
 
     // more quickly arrive at a sensible average
     if (c->recent_rtt <= 0) {
@@ -1446,6 +1538,7 @@ static int pongReceived(struct client *c, int64_t now) {
                         c->latest_rtt, c->recent_rtt, uuid, c->proxy_string);
             }
             if (c->sendq_len + 3 < c->sendq_max) {
+                sendqPlace(c);
                 c->sendq[c->sendq_len++] = 0x1a;
                 c->sendq[c->sendq_len++] = 'W';
                 c->sendq[c->sendq_len++] = 'S';
@@ -1463,61 +1556,162 @@ static int pongReceived(struct client *c, int64_t now) {
 }
 
 
-static int flushClient(struct client *c, int64_t now) {
+// add the ring data between ringPos and limit to the iovec, two segments if it wraps around
+static int ringSegments(struct net_writer *writer, int64_t pos, int64_t limit, struct iovec *iov) {
+    if (limit <= pos) {
+        return 0;
+    }
+    int64_t offset = pos % writer->ringSize;
+    int64_t len = limit - pos;
+    int64_t first = imin(len, writer->ringSize - offset);
+    iov[0].iov_base = writer->ring + offset;
+    iov[0].iov_len = first;
+    if (first == len) {
+        return 1;
+    }
+    iov[1].iov_base = writer->ring;
+    iov[1].iov_len = len - first;
+    return 2;
+}
+
+// state of one send to a client, see flushClient()
+struct flushState {
+    struct client *c;
+    int64_t now;
+    int64_t toWrite;
+    int64_t beforeSendq;
+    struct msghdr msg;
+    struct iovec iov[5];
+};
+
+// check the client's position in the ring and gather what needs sending
+// returns -1 if the client was closed, 0 if there is nothing to send, 1 if fs is ready for sendmsg
+static int flushClientPrepare(struct client *c, int64_t now, struct flushState *fs) {
     if (!c->service) { fprintf(stderr, "report error: Ahlu8pie\n"); return -1; }
-    int toWrite = c->sendq_len;
+    if (c->uringSendPending) {
+        // batched sendmsg still in flight, the ring position is advanced once it completes
+        return 0;
+    }
+    struct net_writer *writer = c->service->writer;
+    if (writer && !writer->ring) {
+        writer = NULL;
+    }
+
+    if (writer && writer->ringHead - c->ringPos > writer->ringSize) {
+        // the ring has overwritten data this client hasn't been sent yet
+        // give the connection 10 seconds to ramp up --> automatic TCP window scaling in Linux ...
+        if (now - c->connectedSince < 10 * SECONDS) {
+            fprintf(stderr, "%s: Discarding full SendQ: %s port %s (fd %d, SendQ %lld, RecvQ %d)\n",
+                    c->service->descr, c->host, c->port,
+                    c->fd, (long long) (writer->ringHead - c->ringPos), c->buflen);
+            c->ringPos = writer->ringHead;
+        } else {
+            // Too much data in client SendQ.  Drop client - SendQ exceeded.
+            fprintf(stderr, "%s: Dropped due to full SendQ: %s port %s (fd %d, SendQ %lld, RecvQ %d)\n",
+                    c->service->descr, c->host, c->port,
+                    c->fd, (long long) (writer->ringHead - c->ringPos), c->buflen);
+            modesCloseClient(c);
+            return -1;
+        }
+    }
 
-    if (toWrite == 0) {
+    // send in order: ring data up to the anchor, the private SendQ, the remaining ring data
+    struct iovec *iov = fs->iov;
+    int iovcnt = 0;
+    int64_t anchor = writer ? writer->ringHead : 0;
+    if (c->sendq_len) {
+        anchor = imax(c->ringPos, c->sendqAnchor);
+    }
+    fs->beforeSendq = 0;
+    if (writer) {
+        iovcnt += ringSegments(writer, c->ringPos, anchor, iov + iovcnt);
+        fs->beforeSendq = anchor - c->ringPos;
+    }
+    if (c->sendq_len) {
+        iov[iovcnt].iov_base = c->sendq;
+        iov[iovcnt].iov_len = c->sendq_len;
+        iovcnt++;
+        if (writer) {
+            iovcnt += ringSegments(writer, anchor, writer->ringHead, iov + iovcnt);
+        }
+    }
+    fs->toWrite = c->sendq_len + (writer ? writer->ringHead - c->ringPos : 0);
+
+    if (fs->toWrite == 0) {
         c->last_flush = now;
         return 0;
     }
 
-    int bytesWritten = send(c->fd, c->sendq, toWrite, 0);
-    int err = errno;
+    memset(&fs->msg, 0, sizeof(fs->msg));
+    fs->msg.msg_iov = iov;
+    fs->msg.msg_iovlen = iovcnt;
+    fs->c = c;
+    fs->now = now;
+    return 1;
+}
+
+// account for the result of sendmsg()
+static int flushClientComplete(struct flushState *fs, int bytesWritten, int err) {
+    struct client *c = fs->c;
+    int64_t now = fs->now;
+    int64_t toWrite = fs->toWrite;
 
     // If we get -1, it's only fatal if it's not EAGAIN/EWOULDBLOCK
     if (bytesWritten < 0 && err != EAGAIN && err != EWOULDBLOCK) {
-        fprintf(stderr, "%s: Send Error: %s: %s port %s (fd %d, SendQ %d, RecvQ %d)\n",
+        fprintf(stderr, "%s: Send Error: %s: %s port %s (fd %d, SendQ %lld, RecvQ %d)\n",
                 c->service->descr, strerror(err), c->host, c->port,
-                c->fd, c->sendq_len, c->buflen);
+                c->fd, (long long) toWrite, c->buflen);
         modesCloseClient(c);
         return -1;
     }
     if (bytesWritten > toWrite) {
-        fprintf(stderr, "%s: send() weirdness: bytesWritten > toWrite: %s: %s port %s (fd %d, SendQ %d, RecvQ %d)\n",
+        fprintf(stderr, "%s: send() weirdness: bytesWritten > toWrite: %s: %s port %s (fd %d, SendQ %lld, RecvQ %d)\n",
                 c->service->descr, strerror(err), c->host, c->port,
-                c->fd, c->sendq_len, c->buflen);
+                c->fd, (long long) toWrite, c->buflen);
         modesCloseClient(c);
         return -1;
     }
     if (bytesWritten < toWrite && Modes.debug_flush) {
 
         fprintTimePrecise(stderr, now);
-        fprintf(stderr, " %s: send wrote: %d/%d bytes (%s port %s fd %d, SendQ %d)\n", c->service->descr, bytesWritten, toWrite, c->host, c->port, c->fd, c->sendq_len);
+        fprintf(stderr, " %s: send wrote: %d/%lld bytes (%s port %s fd %d, SendQ %d)\n", c->service->descr, bytesWritten, (long long) toWrite, c->host, c->port, c->fd, c->sendq_len);
     }
     if (bytesWritten > 0) {
-        Modes.stats_current.network_bytes_out += bytesWritten;
-        // Advance buffer
+        STATS_CURRENT->network_bytes_out += bytesWritten;
+        // Advance ring position and private buffer
         toWrite -= bytesWritten;
-        c->sendq_len -= bytesWritten;
+        int64_t done = bytesWritten;
+        int64_t ringDone = imin(done, fs->beforeSendq);
+        c->ringPos += ringDone;
+        done -= ringDone;
+        if (done > 0) {
+            int sendqDone = imin(done, c->sendq_len);
+            c->sendq_len -= sendqDone;
+            done -= sendqDone;
+            if (c->sendq_len > 0) {
+                memmove((void*)c->sendq, c->sendq + sendqDone, c->sendq_len);
+            } else {
+                c->sendqAnchor = -1;
+            }
+            c->ringPos += done;
+        }
 
         c->last_send = now;	// If we wrote anything, update this.
         if (toWrite == 0) {
             c->last_flush = now;
-        } else {
-            memmove((void*)c->sendq, c->sendq + bytesWritten, toWrite);
         }
     }
+    int epfd = c->owner ? c->owner->epfd : Modes.net_epfd;
     if (toWrite > 0 && !(c->epollEvent.events & EPOLLOUT)) {
         // if we couldn't flush our buffer, make epoll tell us when we can write again
         c->epollEvent.events |= EPOLLOUT;
-        if (epoll_ctl(Modes.net_epfd, EPOLL_CTL_MOD, c->fd, &c->epollEvent))
+        if (epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &c->epollEvent))
             perror("epoll_ctl fail:");
     }
     if (toWrite == 0 && (c->epollEvent.events & EPOLLOUT)) {
         // if set, remove EPOLLOUT from epoll if flush was successful
         c->epollEvent.events ^= EPOLLOUT;
-        if (epoll_ctl(Modes.net_epfd, EPOLL_CTL_MOD, c->fd, &c->epollEvent))
+        if (epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &c->epollEvent))
             perror("epoll_ctl fail:");
     }
 
@@ -1525,21 +1719,102 @@ static int flushClient(struct client *c, int64_t now) {
     // give the connection 10 seconds to ramp up --> automatic TCP window scaling in Linux ...
     int64_t flushTimeout = imax(1 * SECONDS, 8 * Modes.net_output_flush_interval);
     if (now - c->last_flush > flushTimeout && now - c->connectedSince > 10 * SECONDS) {
-        fprintf(stderr, "%s: Couldn't flush data for %.2fs (Insufficient bandwidth?): disconnecting: %s port %s (fd %d, SendQ %d)\n", c->service->descr, flushTimeout / 1000.0, c->host, c->port, c->fd, c->sendq_len);
+        fprintf(stderr, "%s: Couldn't flush data for %.2fs (Insufficient bandwidth?): disconnecting: %s port %s (fd %d, SendQ %lld)\n", c->service->descr, flushTimeout / 1000.0, c->host, c->port, c->fd, (long long) toWrite);
         modesCloseClient(c);
         return -1;
     }
     return bytesWritten;
 }
 
+static int flushClient(struct client *c, int64_t now) {
+    struct flushState fs;
+    int res = flushClientPrepare(c, now, &fs);
+    if (res <= 0) {
+        return res;
+    }
+    int bytesWritten = sendmsg(c->fd, &fs.msg, 0);
+    return flushClientComplete(&fs, bytesWritten, errno);
+}
+
+#ifdef ENABLE_IO_URING
+static void uringFlushComplete(void *data, int res) {
+    struct flushState *fs = data;
+    struct client *c = fs->c;
+    c->uringSendPending = 0;
+    if (!c->service) {
+        // closed while the sendmsg was in flight
+        return;
+    }
+    if (res < 0) {
+        flushClientComplete(fs, -1, -res);
+    } else {
+        flushClientComplete(fs, res, 0);
+    }
+}
+
+// same as the flushClient() loop in flushWrites() but all clients are sent to with a single syscall
+// the flush state lives in the client as the sendmsg can complete after this returns
+static void flushClientsUring(struct net_writer *writer, int64_t now) {
+    for (struct client *c = writer->service->clients; c; c = c->next) {
+        if (!c->service)
+            continue;
+        if (c->service->writer == writer->service->writer) {
+            if (c->pingEnabled) {
+                pong(c, now);
+            }
+            if (!uringSpace()) {
+                uringSubmit();
+            }
+            if (!uringSpace()) {
+                // operations stuck in flight, send directly
+                flushClient(c, now);
+                continue;
+            }
+            if (!c->uringFlush) {
+                c->uringFlush = cmalloc(sizeof(struct flushState));
+            }
+            struct flushState *fs = c->uringFlush;
+            if (flushClientPrepare(c, now, fs) <= 0) {
+                continue;
+            }
+            c->uringSendPending = 1;
+            uringQueueSendmsg(c->fd, &fs->msg, uringFlushComplete, fs);
+        }
+    }
+    uringSubmit();
+}
+#endif
+
 //
 //=========================================================================
 //
-// Send the write buffer for the specified writer to all connected clients
+// Append the write buffer for the specified writer to its ring and send it to all connected clients
+// The data is copied once, each client only keeps its position in the ring
 //
 static void flushWrites(struct net_writer *writer) {
     int64_t now = mstime();
     //fprintTimePrecise(stderr, now); fprintf(stderr, "flushing %s %5d bytes\n", writer->service->descr, writer->dataUsed);
+    if (!writer->connections || !writer->ring) {
+        // no clients
+        writer->dataUsed = 0;
+        writer->lastWrite = now;
+        return;
+    }
+    int64_t offset = writer->ringHead % writer->ringSize;
+    int64_t first = imin(writer->dataUsed, writer->ringSize - offset);
+    memcpy(writer->ring + offset, writer->data, first);
+    memcpy(writer->ring, (char *) writer->data + first, writer->dataUsed - first);
+    writer->ringHead += writer->dataUsed;
+
+#ifdef ENABLE_IO_URING
+    if (uringActive()) {
+        flushClientsUring(writer, now);
+        writer->dataUsed = 0;
+        writer->lastWrite = now;
+        return;
+    }
+#endif
+
     for (struct client *c = writer->service->clients; c; c = c->next) {
         if (!c->service)
             continue;
@@ -1547,27 +1822,7 @@ static void flushWrites(struct net_writer *writer) {
             if (c->pingEnabled) {
                 pong(c, now);
             }
-            // give the connection 10 seconds to ramp up --> automatic TCP window scaling in Linux ...
-            if ((c->sendq_len + writer->dataUsed) >= c->sendq_max) {
-                if (now - c->connectedSince < 10 * SECONDS) {
-                    fprintf(stderr, "%s: Discarding full SendQ: %s port %s (fd %d, SendQ %d, RecvQ %d)\n",
-                            c->service->descr, c->host, c->port,
-                            c->fd, c->sendq_len, c->buflen);
-                    c->sendq_len = 0;
-                    flushClient(c, now);
-                    continue;
-                }
-                // Too much data in client SendQ.  Drop client - SendQ exceeded.
-                fprintf(stderr, "%s: Dropped due to full SendQ: %s port %s (fd %d, SendQ %d, RecvQ %d)\n",
-                        c->service->descr, c->host, c->port,
-                        c->fd, c->sendq_len, c->buflen);
-                modesCloseClient(c);
-                continue;	// Go to the next client
-            }
-            // Append the data to the end of the queue, increment len
-            memcpy(c->sendq + c->sendq_len, writer->data, writer->dataUsed);
-            c->sendq_len += writer->dataUsed;
-            // Try flushing...
+            // Try flushing, this also drops clients that fell a full ring behind
             if (flushClient(c, now) < 0) {
                 continue;
             }
@@ -1647,38 +1902,33 @@ static char *netTimestamp(char *p, int64_t timestamp) {
     return p;
 }
 
+// receiverId, big-endian, in own message to make it backwards compatible
+static char *encodeBeastReceiverId(char *p, uint64_t receiverId) {
+    unsigned char ch;
+    *p++ = 0x1a;
+    // other dump1090 / readsb versions or beast implementations should discard unknown message types
+    *p++ = 0xe3; // good enough guess no one is using this.
+    for (int i = 7; i >= 0; i--) {
+        *p++ = (ch = ((receiverId >> (8 * i)) & 0xFF));
+        if (0x1A == ch) {
+            *p++ = ch;
+        }
+    }
+    return p;
+}
+
 //
 //=========================================================================
 //
-// Write raw output in Beast Binary format with Timestamp to TCP clients
+// Encode a message in Beast Binary format with Timestamp, returns NULL for unsupported message lengths
 //
-static void modesSendBeastOutput(struct modesMessage *mm, struct net_writer *writer) {
+static char *encodeBeastFrame(char *p, struct modesMessage *mm) {
     int msgLen = mm->msgbits / 8;
-    // 0x1a 0xe3 receiverId(2*8) 0x1a msgType timestamp+signal(2*7) message(2*msgLen)
-    char *p = prepareWrite(writer, (2 + 2 * 8 + 2 + 2 * 7) + 2 * msgLen);
     unsigned char ch;
     int j;
     int sig;
     unsigned char *msg = (Modes.net_verbatim ? mm->verbatim : mm->msg);
 
-    if (!p)
-        return;
-
-    // receiverId, big-endian, in own message to make it backwards compatible
-    // only send the receiverId when it changes
-    if (Modes.netReceiverId && writer->lastReceiverId != mm->receiverId) {
-        writer->lastReceiverId = mm->receiverId;
-        *p++ = 0x1a;
-        // other dump1090 / readsb versions or beast implementations should discard unknown message types
-        *p++ = 0xe3; // good enough guess no one is using this.
-        for (int i = 7; i >= 0; i--) {
-            *p++ = (ch = ((mm->receiverId >> (8 * i)) & 0xFF));
-            if (0x1A == ch) {
-                *p++ = ch;
-            }
-        }
-    }
-
     *p++ = 0x1a;
     if (msgLen == MODES_SHORT_MSG_BYTES) {
         *p++ = '2';
@@ -1687,7 +1937,7 @@ static void modesSendBeastOutput(struct modesMessage *mm, struct net_writer *wri
     } else if (msgLen == MODEAC_MSG_BYTES) {
         *p++ = '1';
     } else {
-        return;
+        return NULL;
     }
 
     /* timestamp, big-endian */
@@ -1710,7 +1960,7 @@ static void modesSendBeastOutput(struct modesMessage *mm, struct net_writer *wri
         }
     }
 
-    completeWrite(writer, p);
+    return p;
 }
 
 static void modesDumpBeastData(struct modesMessage *mm) {
@@ -1834,15 +2084,11 @@ static inline __attribute__((always_inline)) void printHexDigit(char *p, unsigne
 //
 // Write raw output to TCP clients
 //
-static void modesSendRawOutput(struct modesMessage *mm) {
+static char *encodeRaw(char *p, struct modesMessage *mm) {
     int msgLen = mm->msgbits / 8;
-    char *p = prepareWrite(&Modes.raw_out, msgLen * 2 + 15);
     int j;
     unsigned char *msg = (Modes.net_verbatim ? mm->verbatim : mm->msg);
 
-    if (!p)
-        return;
-
     if (Modes.mlat && mm->timestamp) {
         /* timestamp, big-endian */
         sprintf(p, "@%012" PRIX64,
@@ -1859,7 +2105,7 @@ static void modesSendRawOutput(struct modesMessage *mm) {
     *p++ = ';';
     *p++ = '\n';
 
-    completeWrite(&Modes.raw_out, p);
+    return p;
 }
 //
 // Read Asterix FSPEC
@@ -3161,7 +3407,7 @@ static int decodeSbsLine(struct client *c, char *line, int remote, int64_t now,
 
     netUseMessage(mm);
 
-    Modes.stats_current.remote_received_basestation_valid++;
+    STATS_CURRENT->remote_received_basestation_valid++;
 
     return 0;
 
@@ -3173,7 +3419,7 @@ basestation_invalid:
         }
         fprintf(stderr, "SBS invalid: %.*s (anything over 200 characters cut)\n", (int) imin(200, line_len), line);
     }
-    Modes.stats_current.remote_received_basestation_invalid++;
+    STATS_CURRENT->remote_received_basestation_invalid++;
     return 0;
 }
 //
@@ -3181,19 +3427,15 @@ basestation_invalid:
 //
 // Write SBS output to TCP clients
 //
-static void modesSendSBSOutput(struct modesMessage *mm, struct aircraft *a, struct net_writer *writer) {
-    char *p;
+// Encode a message in SBS format, returns NULL if the message has no SBS representation
+static char *encodeSBS(char *p, struct modesMessage *mm, struct aircraft *a) {
     struct timespec now;
     struct tm stTime_receive, stTime_now;
     int msgType;
 
     // For now, suppress non-ICAO addresses
     if (mm->addr & MODES_NON_ICAO_ADDRESS)
-        return;
-
-    p = prepareWrite(writer, 200);
-    if (!p)
-        return;
+        return NULL;
 
     //
     // SBS BS style output checked against the following reference
@@ -3236,12 +3478,12 @@ static void modesSendSBSOutput(struct modesMessage *mm, struct aircraft *a, stru
                 } else if (mm->metype == 19) {
                     msgType = 4;
                 } else {
-                    return;
+                    return NULL;
                 }
                 break;
 
             default:
-                return;
+                return NULL;
         }
     }
 
@@ -3400,7 +3642,7 @@ static void modesSendSBSOutput(struct modesMessage *mm, struct aircraft *a, stru
 
     p += sprintf(p, "\r\n");
 
-    completeWrite(writer, p);
+    return p;
 }
 
 
@@ -3824,9 +4066,9 @@ static int decodeBinMessage(struct client *c, char *p, int remote, int64_t now,
     } else if (ch == '1') {
         if (!Modes.mode_ac) {
             if (remote) {
-                Modes.stats_current.remote_received_modeac++;
+                STATS_CURRENT->remote_received_modeac++;
             } else {
-                Modes.stats_current.demod_modeac++;
+                STATS_CURRENT->demod_modeac++;
             }
             return 0;
         }
@@ -3885,13 +4127,13 @@ static int decodeBinMessage(struct client *c, char *p, int remote, int64_t now,
 
     /* In case of Mode-S Beast use the signal level per message for statistics */
     if (c == Modes.serial_client) {
-        Modes.stats_current.signal_power_sum += mm->signalLevel;
-        Modes.stats_current.signal_power_count += 1;
+        STATS_CURRENT->signal_power_sum += mm->signalLevel;
+        STATS_CURRENT->signal_power_count += 1;
 
-        if (mm->signalLevel > Modes.stats_current.peak_signal_power)
-            Modes.stats_current.peak_signal_power = mm->signalLevel;
+        if (mm->signalLevel > STATS_CURRENT->peak_signal_power)
+            STATS_CURRENT->peak_signal_power = mm->signalLevel;
         if (mm->signalLevel > 0.50119)
-            Modes.stats_current.strong_signal_count++; // signal power above -3dBFS
+            STATS_CURRENT->strong_signal_count++; // signal power above -3dBFS
     }
 
     for (j = 0; j < msgLen; j++) { // and the data
@@ -3901,38 +4143,38 @@ static int decodeBinMessage(struct client *c, char *p, int remote, int64_t now,
     int result = -10;
     if (msgLen == MODEAC_MSG_BYTES) { // ModeA or ModeC
         if (remote) {
-            Modes.stats_current.remote_received_modeac++;
+            STATS_CURRENT->remote_received_modeac++;
         } else {
-            Modes.stats_current.demod_modeac++;
+            STATS_CURRENT->demod_modeac++;
         }
         decodeModeAMessage(mm, ((msg[0] << 8) | msg[1]));
         result = 0;
     } else {
         if (remote) {
-            Modes.stats_current.remote_received_modes++;
+            STATS_CURRENT->remote_received_modes++;
         } else {
-            Modes.stats_current.demod_preambles++;
+            STATS_CURRENT->demod_preambles++;
         }
         result = decodeModesMessage(mm);
         if (result < 0) {
             if (result == -1) {
                 if (remote) {
-                    Modes.stats_current.remote_rejected_unknown_icao++;
+                    STATS_CURRENT->remote_rejected_unknown_icao++;
                 } else {
-                    Modes.stats_current.demod_rejected_unknown_icao++;
+                    STATS_CURRENT->demod_rejected_unknown_icao++;
                 }
             } else {
                 if (remote) {
-                    Modes.stats_current.remote_rejected_bad++;
+                    STATS_CURRENT->remote_rejected_bad++;
                 } else {
-                    Modes.stats_current.demod_rejected_bad++;
+                    STATS_CURRENT->demod_rejected_bad++;
                 }
             }
         } else {
             if (remote) {
-                Modes.stats_current.remote_accepted[mm->correctedbits]++;
+                STATS_CURRENT->remote_accepted[mm->correctedbits]++;
             } else {
-                Modes.stats_current.demod_accepted[mm->correctedbits]++;
+                STATS_CURRENT->demod_accepted[mm->correctedbits]++;
             }
         }
     }
@@ -3945,7 +4187,7 @@ static int decodeBinMessage(struct client *c, char *p, int remote, int64_t now,
         // this way we get basic data even from high latency receivers
         // super high latency receivers are getting disconnected in pongReceived()
         if (!mm->cpr_valid) {
-            Modes.stats_current.remote_rejected_delayed++;
+            STATS_CURRENT->remote_rejected_delayed++;
             return 0; // discard
         }
     }
@@ -4070,20 +4312,20 @@ static int decodePfMessage(struct client *c, char *p, int remote, int64_t now, s
 
     int result = -10;
     if (msgLen == MODEAC_MSG_BYTES) { // ModeA or ModeC
-        Modes.stats_current.remote_received_modeac++;
+        STATS_CURRENT->remote_received_modeac++;
         decodeModeAMessage(mm, ((msg[0] << 8) | msg[1]));
         result = 0;
     } else {
-        Modes.stats_current.remote_received_modes++;
+        STATS_CURRENT->remote_received_modes++;
         result = decodeModesMessage(mm);
         if (result < 0) {
             if (result == -1) {
-                Modes.stats_current.remote_rejected_unknown_icao++;
+                STATS_CURRENT->remote_rejected_unknown_icao++;
             } else {
-                Modes.stats_current.remote_rejected_bad++;
+                STATS_CURRENT->remote_rejected_bad++;
             }
         } else {
-            Modes.stats_current.remote_accepted[mm->correctedbits]++;
+            STATS_CURRENT->remote_accepted[mm->correctedbits]++;
         }
     }
     if (c->unreasonable_messagerate) {
@@ -4265,21 +4507,21 @@ static int decodeHexMessage(struct client *c, char *hex, int64_t now, struct mod
     mm->sysTimestamp = now;
 
     if (l == (MODEAC_MSG_BYTES * 2)) { // ModeA or ModeC
-        Modes.stats_current.remote_received_modeac++;
+        STATS_CURRENT->remote_received_modeac++;
         decodeModeAMessage(mm, ((msg[0] << 8) | msg[1]));
     } else { // Assume ModeS
         int result;
 
-        Modes.stats_current.remote_received_modes++;
+        STATS_CURRENT->remote_received_modes++;
         result = decodeModesMessage(mm);
         if (result < 0) {
             if (result == -1)
-                Modes.stats_current.remote_rejected_unknown_icao++;
+                STATS_CURRENT->remote_rejected_unknown_icao++;
             else
-                Modes.stats_current.remote_rejected_bad++;
+                STATS_CURRENT->remote_rejected_bad++;
             return 0;
         } else {
-            Modes.stats_current.remote_accepted[mm->correctedbits]++;
+            STATS_CURRENT->remote_accepted[mm->correctedbits]++;
         }
     }
 
@@ -4316,18 +4558,26 @@ static int processHexMessage(struct client *c, char *hex, int remote, int64_t no
     return (0);
 }
 
+// locks only needed when multiple decode workers are running
+static inline void decodeWorkerLock(pthread_mutex_t *mutex) {
+    if (Modes.decodeThreads > 1)
+        pthread_mutex_lock(mutex);
+}
+static inline void decodeWorkerUnlock(pthread_mutex_t *mutex) {
+    if (Modes.decodeThreads > 1)
+        pthread_mutex_unlock(mutex);
+}
+
 static void replayUatMsg(char *msg, int msgLen) {
+    decodeWorkerLock(&Modes.outputLock);
     char *p = prepareWrite(&Modes.uat_replay_out, msgLen + 1);
-    if (!p) {
-        return;
+    if (p) {
+        memcpy(p, msg, msgLen);
+        p += msgLen;
+        *p++ = '\n';
+        completeWrite(&Modes.uat_replay_out, p);
     }
-
-    memcpy(p, msg, msgLen);
-    p += msgLen;
-    *p++ = '\n';
-    completeWrite(&Modes.uat_replay_out, p);
-
-    return;
+    decodeWorkerUnlock(&Modes.outputLock);
 }
 
 
@@ -4340,7 +4590,10 @@ static int decodeUatMessage(struct client *c, char *msg, int remote, int64_t now
 
     replayUatMsg(msg, msgLen);
 
+    // uat2esnt keeps some static state
+    decodeWorkerLock(&Modes.decodeLock);
     uat2esnt_convert_message(msg, end, output, output + sizeof(output));
+    decodeWorkerUnlock(&Modes.decodeLock);
 
     char *som = output;
     char *eod = som + strlen(som);
@@ -4354,6 +4607,8 @@ static int decodeUatMessage(struct client *c, char *msg, int remote, int64_t now
         int success = decodeHexMessage(c, som, now, mm);
 
         if (success) {
+            int ignore = 0;
+            decodeWorkerLock(&Modes.trackLock);
             struct aircraft *a = aircraftGet(mm->addr);
             if (!a) { // If it's a currently unknown aircraft....
                 a = aircraftCreate(mm->addr); // ., create a new record for it,
@@ -4362,6 +4617,10 @@ static int decodeUatMessage(struct client *c, char *msg, int remote, int64_t now
             if (now > a->seen + 300 * SECONDS) {
                 //fprintf(stderr, "IGNORING first UAT message from: %06x\n", a->addr);
                 a->seen = now;
+                ignore = 1;
+            }
+            decodeWorkerUnlock(&Modes.trackLock);
+            if (ignore) {
                 return 0;
             }
             netUseMessage(mm);
@@ -4413,8 +4672,8 @@ static const char *hexDumpString(const char *str, int strlen, char *buf, int buf
 // This function polls the clients using read() in order to receive new
 // messages from the net.
 //
-static int readClient(struct client *c, int64_t now) {
-    int nread = 0;
+// make room in the read buffer, returns the number of bytes that can be read
+static int readClientSpace(struct client *c) {
     if (c->discard)
         c->buflen = 0;
 
@@ -4424,7 +4683,7 @@ static int readClient(struct client *c, int64_t now) {
     // If our buffer is full discard it, this is some badly formatted shit
     if (left <= 0) {
         c->garbage += c->buflen;
-        Modes.stats_current.remote_malformed_beast += c->buflen;
+        STATS_CURRENT->remote_malformed_beast += c->buflen;
 
         c->buflen = 0;
         c->som = c->buf;
@@ -4433,9 +4692,32 @@ static int readClient(struct client *c, int64_t now) {
         left = c->bufmax - c->buflen - 4; // leave 4 extra byte for NUL termination in the ASCII case
                                           // If there is garbage, read more to discard it ASAP
     }
+    return left;
+}
+
+static int readClient(struct client *c, int64_t now) {
+    int nread = 0;
+    int err = 0;
+
+    if (c->uringRecvPending) {
+        // batched recv still in flight, its result is used once it has completed
+        c->bContinue = 0;
+        return 0;
+    }
+
+    int left = readClientSpace(c);
 
-    if (c->remote) {
+    if (c->uringReady) {
+        // data was already read by a batched recv
+        c->uringReady = 0;
+        nread = c->uringRes;
+        if (nread < 0) {
+            err = -nread;
+            nread = -1;
+        }
+    } else if (c->remote) {
         nread = recv(c->fd, c->buf + c->buflen, left, 0);
+        err = errno;
     } else {
         // read instead of recv for modesbeast / gns-hulc ....
         if (0 && Modes.debug_serial) {
@@ -4443,12 +4725,12 @@ static int readClient(struct client *c, int64_t now) {
             fprintf(stderr, " serial read ... fd: %d maxbytes: %d\n", c->fd, left);
         }
         nread = read(c->fd, c->buf + c->buflen, left);
+        err = errno;
         if (nread > 0 && Modes.debug_serial) {
             fprintTimePrecise(stderr, mstime());
             fprintf(stderr, " serial read return value: %d\n", nread);
         }
     }
-    int err = errno;
 
     // If we didn't get all the data we asked for, then return once we've processed what we did get.
     if (nread != left) {
@@ -4501,7 +4783,7 @@ static int readClient(struct client *c, int64_t now) {
     }
 
     // nread > 0 here
-    Modes.stats_current.network_bytes_in += nread;
+    STATS_CURRENT->network_bytes_in += nread;
 
     // disable for the time being
     if (0 && Modes.netIngest && !Modes.debug_no_discard) {
@@ -4746,7 +5028,7 @@ static int readBeast(struct client *c, int64_t now, struct messageBuffer *mb) {
     while (c->som < c->eod && ((p = memchr(c->som, (char) 0x1a, c->eod - c->som)) != NULL)) { // The first byte of buffer 'should' be 0x1a
 
         c->garbage += p - c->som;
-        Modes.stats_current.remote_malformed_beast += p - c->som;
+        STATS_CURRENT->remote_malformed_beast += p - c->som;
 
         //lastSom = p;
         c->som = p; // consume garbage up to the 0x1a
@@ -4829,7 +5111,7 @@ static int readBeast(struct client *c, int64_t now, struct messageBuffer *mb) {
                     if (p < c->eod && ch != 0x1A) { // check that it's indeed a double escape
                                                  // might be start of message rather than double escape.
                         c->garbage += p - 1 - c->som;
-                        Modes.stats_current.remote_malformed_beast += p - 1 - c->som;
+                        STATS_CURRENT->remote_malformed_beast += p - 1 - c->som;
                         c->som = p - 1;
                         goto beastWhileContinue;
                     }
@@ -4919,7 +5201,7 @@ static int readBeast(struct client *c, int64_t now, struct messageBuffer *mb) {
             // either: 0x1a (likely not a start of message but rather escaped 0x1a)
             // or: any other char is skipped anyhow when looking for the next 0x1a
             c->som += 2;
-            Modes.stats_current.remote_malformed_beast += 2;
+            STATS_CURRENT->remote_malformed_beast += 2;
             c->garbage += 2;
             continue;
         }
@@ -4946,7 +5228,7 @@ static int readBeast(struct client *c, int64_t now, struct messageBuffer *mb) {
                                              // might be start of message rather than double escape.
                                              //
                         c->garbage += p - 1 - c->som;
-                        Modes.stats_current.remote_malformed_beast += p - 1 - c->som;
+                        STATS_CURRENT->remote_malformed_beast += p - 1 - c->som;
                         c->som = p - 1;
 
                         if (0) {
@@ -5010,7 +5292,7 @@ beastWhileContinue:
     if (c->eod - c->som > 256) {
         //fprintf(stderr, "beastWhile too much data remaining, garbage?!\n");
         c->garbage += c->eod - c->som;
-        Modes.stats_current.remote_malformed_beast += c->eod - c->som;
+        STATS_CURRENT->remote_malformed_beast += c->eod - c->som;
         c->som = c->eod;
     }
 
@@ -5263,18 +5545,27 @@ const char *airground_enum_string(airground_t ag) {
 }
 
 static void serviceFreeClients(struct net_service *s) {
+    struct net_writer *writer = s->writer;
+    int sendPending = 0;
     struct client *c, **prev;
     for (prev = &s->clients, c = *prev; c; c = *prev) {
-        if (c->fd == -1) {
+        sendPending |= c->uringSendPending;
+        if (c->fd == -1 && !c->uringRecvPending && !c->uringSendPending) {
             // Recently closed, prune from list
+            // (not while a batched recv / sendmsg still uses the buffers)
             *prev = c->next;
             sfree(c->sendq);
             sfree(c->buf);
+            sfree(c->uringFlush);
             sfree(c);
         } else {
             prev = &c->next;
         }
     }
+    // the iovecs of a batched sendmsg point into the ring
+    if (writer && writer->ring && writer->connections == 0 && !sendPending) {
+        sfree(writer->ring);
+    }
 }
 
 // Unlink and free closed clients
@@ -5287,7 +5578,61 @@ static void netFreeClients() {
     }
 }
 
+#ifdef ENABLE_IO_URING
+static void uringReadComplete(void *data, int res) {
+    struct client *c = data;
+    c->uringRecvPending = 0;
+    c->uringRes = res;
+    c->uringReady = 1;
+}
+
+// issue the first recv() for all ready clients of this group with a single syscall
+// readClient() then uses the result instead of calling recv() itself
+// a recv that doesn't complete during submission is picked up on the next epoll event for the client
+static void prefetchReads(struct net_service_group *group) {
+    if (!uringActive() || Modes.synthetic_now) {
+        return;
+    }
+    // collect operations that completed after an earlier submission
+    uringSubmit();
+    for (int k = group->event_progress; k < Modes.net_event_count; k++) {
+        struct epoll_event event = Modes.net_events[k];
+        if (event.data.ptr == &Modes.exitNowEventfd) {
+            break;
+        }
+        if (event.data.ptr == &Modes.decodeWorkerEvent) {
+            continue;
+        }
+        struct client *cl = (struct client *) event.data.ptr;
+        if (!cl || !cl->service || cl->service->group != group || cl->acceptSocket || cl->net_connector_dummyClient) {
+            continue;
+        }
+        if (!(event.events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP))) {
+            continue;
+        }
+        if (!cl->remote || cl->bufferToProcess || cl->uringReady || cl->uringRecvPending) {
+            continue;
+        }
+        if (!uringSpace()) {
+            uringSubmit();
+        }
+        if (!uringSpace()) {
+            // operations stuck in flight, readClient() uses recv() for the remaining clients
+            break;
+        }
+        int left = readClientSpace(cl);
+        cl->uringRecvPending = 1;
+        uringQueueRecv(cl->fd, cl->buf + cl->buflen, left, uringReadComplete, cl);
+    }
+    uringSubmit();
+}
+#endif
+
 static void handleEpoll(struct net_service_group *group, struct messageBuffer *mb) {
+#ifdef ENABLE_IO_URING
+    prefetchReads(group);
+#endif
+
     // Only process each epoll even in one thread
     // the variables for this are specific to the service group,
     // using locking each group can only be processed by one thread at a time
@@ -5301,6 +5646,10 @@ static void handleEpoll(struct net_service_group *group, struct messageBuffer *m
         if (event.data.ptr == &Modes.exitNowEventfd) {
             return;
         }
+        if (event.data.ptr == &Modes.decodeWorkerEvent) {
+            // input clients owned by a decode worker, handled in decodeTask
+            continue;
+        }
 
         struct client *cl = (struct client *) Modes.net_events[k].data.ptr;
         if (!cl) { fprintf(stderr, "handleEpoll: epollEvent.data.ptr == NULL\n"); continue; }
@@ -5362,6 +5711,8 @@ static int64_t checkFlushService(struct net_service *service, int64_t now) {
     }
 }
 
+// read and parse the input clients owned by this decode worker
+// no lock is needed for this, only handing the messages to tracking and output is synchronized
 static void decodeTask(void *arg, threadpool_threadbuffers_t *buffer_group) {
     MODES_NOTUSED(buffer_group);
 
@@ -5370,25 +5721,36 @@ static void decodeTask(void *arg, threadpool_threadbuffers_t *buffer_group) {
 
     //fprintf(stderr, "%.3f decodeTask %d\n", mstime()/1000.0, mb->id);
 
-    pthread_mutex_lock(&Modes.decodeLock);
-    //fprintf(stderr, "%.3f decoding %d\n", mstime()/1000.0, mb->id);
+    stats_local = &mb->stats;
 
-    handleEpoll(&Modes.services_in, mb);
+    if (mb->eventCount == mb->maxEvents) {
+        epollAllocEvents(&mb->events, &mb->maxEvents);
+    }
+    mb->eventCount = epoll_wait(mb->epfd, mb->events, mb->maxEvents, 0);
 
-    for (int kt = 0; kt < Modes.decodeThreads; kt++) {
-        struct messageBuffer *otherbuf = &Modes.netMessageBuffer[kt];
-        struct client *cl = otherbuf->activeClient;
-        if (cl && cl->service) {
+    for (int k = 0; k < mb->eventCount; k++) {
+        struct epoll_event event = mb->events[k];
+        if (event.data.ptr == &Modes.exitNowEventfd) {
+            break;
+        }
+
+        struct client *cl = (struct client *) event.data.ptr;
+        if (!cl->service) {
+            continue;
+        }
+        if ((event.events & EPOLLOUT)) {
+            if (flushClient(cl, mstime()) < 0) {
+                continue;
+            }
+        }
+        if ((event.events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP))) {
             modesReadFromClient(cl, mb);
         }
     }
-    drainMessageBuffer(mb);
 
-    pthread_mutex_unlock(&Modes.decodeLock);
+    drainMessageBuffer(mb);
 
-    pthread_mutex_lock(&Modes.outputLock);
-    handleEpoll(&Modes.services_out, mb);
-    pthread_mutex_unlock(&Modes.outputLock);
+    stats_local = NULL;
 }
 
 //
@@ -5467,10 +5829,24 @@ void modesNetPeriodicWork(void) {
             taskCount++;
         }
 
+        // accept new clients and handle connectors, input clients themselves are handled by the decode workers
+        handleEpoll(&Modes.services_in, mb);
+
         struct timespec before = threadpool_get_cumulative_thread_time(Modes.decodePool);
         threadpool_run(Modes.decodePool, tasks, taskCount);
         struct timespec after = threadpool_get_cumulative_thread_time(Modes.decodePool);
         timespec_add_elapsed(&before, &after, &Modes.stats_current.background_cpu);
+
+        for (int kt = 0; kt < Modes.decodeThreads; kt++) {
+            struct messageBuffer *buf = &Modes.netMessageBuffer[kt];
+            add_stats(&buf->stats, &Modes.stats_current, &Modes.stats_current);
+            reset_stats(&buf->stats);
+        }
+
+        // the icao filter isn't resized while the decode workers are running
+        icaoFilterMaintain();
+
+        handleEpoll(&Modes.services_out, mb);
     }
 
     /* Beast input from local Modes-S Beast via USB */
@@ -5656,6 +6032,7 @@ static void cleanupService(struct net_service *s) {
         c->sendq_len = 0;
         sfree(c->sendq);
         sfree(c->buf);
+        sfree(c->uringFlush);
         sfree(c);
 
         c = nc;
@@ -5671,6 +6048,7 @@ static void cleanupService(struct net_service *s) {
     }
     sfree(s->listener_fds);
     if (s->writer && s->writer->data) {
+        sfree(s->writer->ring);
         sfree(s->writer->data);
     }
     if (s->unixSocket) {
@@ -5700,9 +6078,20 @@ static void cleanupMessageBuffers() {
         destroy_task_group(Modes.decodeTasks);
     }
 
+    trackShardsDestroy();
+
     for (int k = 0; k < Modes.decodeThreads; k++) {
         struct messageBuffer *buf = &Modes.netMessageBuffer[k];
+        if (buf->epfd >= 0) {
+            close(buf->epfd);
+            buf->epfd = -1;
+        }
+        sfree(buf->events);
         sfree(buf->msg);
+        sfree(buf->encoded);
+        for (int f = 0; f < OUTPUT_FORMATS; f++) {
+            sfree(buf->slab[f]);
+        }
         buf->len = 0;
         buf->alloc = 0;
     }
@@ -5720,11 +6109,20 @@ void cleanupNetwork(void) {
     if (!Modes.net) {
         return;
     }
+#ifdef ENABLE_IO_URING
+    // the clients are freed below
+    uringDrain();
+#endif
+
     serviceGroupCleanup(&Modes.services_out);
     serviceGroupCleanup(&Modes.services_in);
 
     close(Modes.net_epfd);
 
+#ifdef ENABLE_IO_URING
+    uringDestroy();
+#endif
+
     for (int i = 0; i < Modes.net_connectors_count; i++) {
         struct net_connector *con = &Modes.net_connectors[i];
         if (con->gai_request_in_progress) {
@@ -5819,26 +6217,45 @@ static char *read_uuid(struct client *c, char *p, char *eod) {
     return p;
 }
 
-static void outputMessage(struct modesMessage *mm) {
+// writers a message is sent to, decided when encoding
+enum {
+    OUT_GARBAGE = (1 << 0),
+    OUT_BEAST = (1 << 1),
+    OUT_BEAST_REDUCE = (1 << 2),
+    OUT_RAW = (1 << 3),
+    OUT_SBS = (1 << 4),
+    OUT_SBS_MLAT = (1 << 5),
+    OUT_SBS_REPLAY = (1 << 6),
+    OUT_SBS_JAERO = (1 << 7),
+    OUT_SBS_PRIO = (1 << 8),
+    OUT_DUMP = (1 << 9),
+    OUT_ASTERIX = (1 << 10),
+    OUT_JSON = (1 << 11),
+};
+
+#define OUT_ANY_BEAST (OUT_GARBAGE | OUT_BEAST | OUT_BEAST_REDUCE)
+#define OUT_ANY_SBS (OUT_SBS | OUT_SBS_MLAT | OUT_SBS_REPLAY | OUT_SBS_JAERO | OUT_SBS_PRIO)
+
+static uint32_t outputSelect(struct modesMessage *mm) {
+    uint32_t out = 0;
     // filter messages with unwanted DF types (sbs_in are unknown DF type, filter them all, this is arbitrary but no one cares anyway)
     if (Modes.filterDF && (mm->sbs_in || !(Modes.filterDFbitset & (1 << mm->msgtype)))) {
-        return;
+        return 0;
     }
     if (!Modes.net) {
-        return;
+        return 0;
+    }
+    if (Modes.debug_yeet && mm->addr % 0x100 != 0xd) {
+        return 0;
     }
 
     struct aircraft *ac = mm->aircraft;
 
     if (ac && ac->messages < Modes.net_forward_min_messages) {
-        return;
+        return 0;
     }
 
     int noforward = (mm->timestamp == MAGIC_NOFORWARD_TIMESTAMP) && !Modes.beast_forward_noforward;
-    int64_t orig_ts = mm->timestamp;
-    if (Modes.beast_set_noforward_timestamp) {
-        mm->timestamp = MAGIC_NOFORWARD_TIMESTAMP;
-    }
 
     // Suppress the first message when using an SDR
     // messages with crc 0 have an explicit checksum and are more reliable, don't suppress them when there was no CRC fix performed
@@ -5848,128 +6265,234 @@ static void outputMessage(struct modesMessage *mm) {
         int is_mlat = (mm->source == SOURCE_MLAT);
 
         if (Modes.garbage_ports && (mm->garbage || mm->pos_bad) && !mm->pos_old && Modes.garbage_out.connections) {
-            modesSendBeastOutput(mm, &Modes.garbage_out);
+            out |= OUT_GARBAGE;
         }
 
         if (ac && (!Modes.sbsReduce || mm->reduce_forward)) {
             if ((!is_mlat || Modes.forward_mlat_sbs) && Modes.sbs_out.connections) {
-                modesSendSBSOutput(mm, ac, &Modes.sbs_out);
+                out |= OUT_SBS;
             }
             if (is_mlat && Modes.sbs_out_mlat.connections) {
-                modesSendSBSOutput(mm, ac, &Modes.sbs_out_mlat);
+                out |= OUT_SBS_MLAT;
             }
         }
 
         if (!noforward && !is_mlat && (Modes.net_verbatim || mm->correctedbits < 2) && Modes.raw_out.connections) {
             // Forward 2-bit-corrected messages via raw output only if --net-verbatim is set
             // Don't ever forward mlat messages via raw output.
-            modesSendRawOutput(mm);
+            out |= OUT_RAW;
         }
 
         if (!noforward && (!is_mlat || Modes.forward_mlat) && (mm->correctedbits < 2 || Modes.net_verbatim)) {
             // Forward 2-bit-corrected messages via beast output only if --net-verbatim is set
             // Forward mlat messages via beast output only if --forward-mlat is set
             if (Modes.beast_out.connections) {
-                modesSendBeastOutput(mm, &Modes.beast_out);
+                out |= OUT_BEAST;
             }
             if (mm->reduce_forward && Modes.beast_reduce_out.connections) {
-                modesSendBeastOutput(mm, &Modes.beast_reduce_out);
+                out |= OUT_BEAST_REDUCE;
             }
         }
         if (Modes.dump_fw && (!Modes.dump_reduce || mm->reduce_forward)) {
-            modesDumpBeastData(mm);
+            out |= OUT_DUMP;
         }
         if (Modes.asterix_out.connections && (!Modes.asterixReduce || mm->reduce_forward)){
-            modesSendAsterixOutput(mm, &Modes.asterix_out);
+            out |= OUT_ASTERIX;
         }
     }
 
     if (mm->jsonPositionOutputEmit && Modes.json_out.connections) {
-        jsonPositionOutput(mm, ac);
+        out |= OUT_JSON;
     }
 
     if (mm->sbs_in && ac) {
         if (mm->reduce_forward || !Modes.sbsReduce) {
             if (Modes.sbs_out.connections) {
-                modesSendSBSOutput(mm, ac, &Modes.sbs_out);
+                out |= OUT_SBS;
             }
-            struct net_writer *extra_writer = NULL;
             switch(mm->source) {
                 case SOURCE_SBS:
-                    extra_writer = &Modes.sbs_out_replay;
+                    out |= Modes.sbs_out_replay.connections ? OUT_SBS_REPLAY : 0;
                     break;
                 case SOURCE_MLAT:
-                    extra_writer = &Modes.sbs_out_mlat;
+                    out |= Modes.sbs_out_mlat.connections ? OUT_SBS_MLAT : 0;
                     break;
                 case SOURCE_JAERO:
-                    extra_writer = &Modes.sbs_out_jaero;
+                    out |= Modes.sbs_out_jaero.connections ? OUT_SBS_JAERO : 0;
                     break;
                 case SOURCE_PRIO:
-                    extra_writer = &Modes.sbs_out_prio;
+                    out |= Modes.sbs_out_prio.connections ? OUT_SBS_PRIO : 0;
                     break;
 
                 default:
-                    extra_writer = NULL;
-            }
-            if (extra_writer && extra_writer->connections) {
-                modesSendSBSOutput(mm, ac, extra_writer);
+                    break;
             }
         }
     }
 
-    mm->timestamp = orig_ts;
-
+    return out;
 }
 
-static void drainMessageBuffer(struct messageBuffer *buf) {
-    if (Modes.decodeThreads < 2) {
-        for (int k = 0; k < buf->len; k++) {
-            struct modesMessage *mm = &buf->msg[k];
-            if (Modes.debug_yeet && mm->addr % 0x100 != 0xd) {
-                continue;
+// Render every wire format needed by the messages in this buffer once, into one slab per format.
+// This doesn't touch the writers and is done before taking the outputLock.
+static void encodeMessages(struct messageBuffer *buf) {
+    char *next[OUTPUT_FORMATS];
+    for (int f = 0; f < OUTPUT_FORMATS; f++) {
+        next[f] = buf->slab[f];
+    }
+
+    for (int k = 0; k < buf->len; k++) {
+        struct modesMessage *mm = &buf->msg[k];
+        struct encodedMessage *enc = &buf->encoded[k];
+
+        enc->outputs = outputSelect(mm);
+        if (!enc->outputs) {
+            continue;
+        }
+
+        int64_t orig_ts = mm->timestamp;
+        if (Modes.beast_set_noforward_timestamp) {
+            mm->timestamp = MAGIC_NOFORWARD_TIMESTAMP;
+        }
+
+        char *end;
+        if (enc->outputs & OUT_ANY_BEAST) {
+            end = encodeBeastFrame(next[FORMAT_BEAST], mm);
+            if (end) {
+                enc->offset[FORMAT_BEAST] = next[FORMAT_BEAST] - buf->slab[FORMAT_BEAST];
+                enc->len[FORMAT_BEAST] = end - next[FORMAT_BEAST];
+                next[FORMAT_BEAST] = end;
+            } else {
+                enc->outputs &= ~OUT_ANY_BEAST;
             }
-            trackUpdateFromMessage(mm);
         }
-        for (int k = 0; k < buf->len; k++) {
-            struct modesMessage *mm = &buf->msg[k];
-            if (Modes.debug_yeet && mm->addr % 0x100 != 0xd) {
-                continue;
+        if (enc->outputs & OUT_RAW) {
+            end = encodeRaw(next[FORMAT_RAW], mm);
+            enc->offset[FORMAT_RAW] = next[FORMAT_RAW] - buf->slab[FORMAT_RAW];
+            enc->len[FORMAT_RAW] = end - next[FORMAT_RAW];
+            next[FORMAT_RAW] = end;
+        }
+        if (enc->outputs & OUT_ANY_SBS) {
+            end = encodeSBS(next[FORMAT_SBS], mm, mm->aircraft);
+            if (end) {
+                enc->offset[FORMAT_SBS] = next[FORMAT_SBS] - buf->slab[FORMAT_SBS];
+                enc->len[FORMAT_SBS] = end - next[FORMAT_SBS];
+                next[FORMAT_SBS] = end;
+            } else {
+                enc->outputs &= ~OUT_ANY_SBS;
             }
-            outputMessage(mm);
         }
-        buf->len = 0;
-    } else {
 
-        pthread_mutex_unlock(&Modes.decodeLock);
+        mm->timestamp = orig_ts;
+    }
+}
 
+static void writeRun(struct net_writer *writer, const char *data, int len) {
+    char *p = prepareWrite(writer, len);
+    if (!p) {
+        return;
+    }
+    memcpy(p, data, len);
+    completeWrite(writer, p + len);
+}
 
-        sched_yield();
-        //fprintf(stderr, "thread %d draining\n", buf->id);
+// Copy the encoded messages selected by flag to a writer,
+// messages adjacent in the slab are copied in one go
+static void fanOut(struct messageBuffer *buf, struct net_writer *writer, uint32_t flag, int format) {
+    if (!writer->connections) {
+        return;
+    }
+    char *slab = buf->slab[format];
+    int runStart = 0;
+    int runLen = 0;
+    for (int k = 0; k < buf->len; k++) {
+        struct encodedMessage *enc = &buf->encoded[k];
+        if (!(enc->outputs & flag)) {
+            continue;
+        }
+        uint64_t receiverId = buf->msg[k].receiverId;
+        // only send the receiverId when it changes
+        int sendReceiverId = (format == FORMAT_BEAST && Modes.netReceiverId && writer->lastReceiverId != receiverId);
 
-        pthread_mutex_lock(&Modes.trackLock);
-        for (int k = 0; k < buf->len; k++) {
-            struct modesMessage *mm = &buf->msg[k];
-            if (Modes.debug_yeet && mm->addr % 0x100 != 0xd) {
-                continue;
+        if (runLen && (sendReceiverId
+                    || enc->offset[format] != runStart + runLen
+                    || runLen + enc->len[format] > Modes.net_output_flush_size)) {
+            writeRun(writer, slab + runStart, runLen);
+            runLen = 0;
+        }
+        if (sendReceiverId) {
+            char *p = prepareWrite(writer, 2 + 2 * 8);
+            if (p) {
+                writer->lastReceiverId = receiverId;
+                completeWrite(writer, encodeBeastReceiverId(p, receiverId));
             }
-            trackUpdateFromMessage(mm);
         }
+        if (!runLen) {
+            runStart = enc->offset[format];
+        }
+        runLen += enc->len[format];
+    }
+    if (runLen) {
+        writeRun(writer, slab + runStart, runLen);
+    }
+}
+
+// Hand the encoded messages to the writers, caller holds the outputLock when using multiple decode threads
+static void fanOutMessages(struct messageBuffer *buf) {
+    fanOut(buf, &Modes.garbage_out, OUT_GARBAGE, FORMAT_BEAST);
+    fanOut(buf, &Modes.beast_out, OUT_BEAST, FORMAT_BEAST);
+    fanOut(buf, &Modes.beast_reduce_out, OUT_BEAST_REDUCE, FORMAT_BEAST);
+    fanOut(buf, &Modes.raw_out, OUT_RAW, FORMAT_RAW);
+    fanOut(buf, &Modes.sbs_out, OUT_SBS, FORMAT_SBS);
+    fanOut(buf, &Modes.sbs_out_mlat, OUT_SBS_MLAT, FORMAT_SBS);
+    fanOut(buf, &Modes.sbs_out_replay, OUT_SBS_REPLAY, FORMAT_SBS);
+    fanOut(buf, &Modes.sbs_out_jaero, OUT_SBS_JAERO, FORMAT_SBS);
+    fanOut(buf, &Modes.sbs_out_prio, OUT_SBS_PRIO, FORMAT_SBS);
+
+    for (int k = 0; k < buf->len; k++) {
+        struct encodedMessage *enc = &buf->encoded[k];
+        if (!(enc->outputs & (OUT_DUMP | OUT_ASTERIX | OUT_JSON))) {
+            continue;
+        }
+        struct modesMessage *mm = &buf->msg[k];
+
+        int64_t orig_ts = mm->timestamp;
+        if (Modes.beast_set_noforward_timestamp) {
+            mm->timestamp = MAGIC_NOFORWARD_TIMESTAMP;
+        }
+        if (enc->outputs & OUT_DUMP) {
+            modesDumpBeastData(mm);
+        }
+        if (enc->outputs & OUT_ASTERIX) {
+            modesSendAsterixOutput(mm, &Modes.asterix_out);
+        }
+        if (enc->outputs & OUT_JSON) {
+            jsonPositionOutput(mm, mm->aircraft);
+        }
+        mm->timestamp = orig_ts;
+    }
+}
+
+static void drainMessageBuffer(struct messageBuffer *buf) {
+    if (Modes.decodeThreads < 2) {
+        trackUpdateMessages(buf->msg, buf->len);
+        encodeMessages(buf);
+        fanOutMessages(buf);
+        buf->len = 0;
+    } else {
+        //fprintf(stderr, "thread %d draining\n", buf->id);
+
+        pthread_mutex_lock(&Modes.trackLock);
+        trackUpdateMessages(buf->msg, buf->len);
         pthread_mutex_unlock(&Modes.trackLock);
 
+        encodeMessages(buf);
+
         pthread_mutex_lock(&Modes.outputLock);
-        for (int k = 0; k < buf->len; k++) {
-            struct modesMessage *mm = &buf->msg[k];
-            if (Modes.debug_yeet && mm->addr % 0x100 != 0xd) {
-                continue;
-            }
-            outputMessage(mm);
-        }
+        fanOutMessages(buf);
         pthread_mutex_unlock(&Modes.outputLock);
 
         buf->len = 0;
-
-        pthread_mutex_lock(&Modes.decodeLock);
-        //fprintf(stderr, "thread %d drain done, back to decoding\n", buf->id);
     }
 }
 
@@ -98,6 +98,7 @@ struct client
     int buflen; // Amount of data on read buffer
     int bufmax; // size of the read buffer
     int fd; // File descriptor
+    struct messageBuffer *owner; // decode worker owning this input client (multiple decode threads only)
     int8_t bufferToProcess;
     int8_t remote;
     int8_t serial;
@@ -110,9 +111,16 @@ struct client
     int8_t modeac_requested; // 1 if this Beast output connection has asked for A/C
     int8_t receiverIdLocked; // receiverId has been transmitted by other side.
     int8_t unreasonable_messagerate;
-    char *sendq;  // Write buffer - allocated later
+    int8_t uringReady; // uringRes holds the result of a batched recv, see prefetchReads()
+    int8_t uringRecvPending; // batched recv in flight, buf must stay valid
+    int8_t uringSendPending; // batched sendmsg in flight, uringFlush must stay valid
+    int32_t uringRes;
+    struct flushState *uringFlush; // sendmsg state for flushClientsUring()
+    char *sendq;  // Write buffer for data private to this client (pings, commands) - allocated later
     int sendq_len; // Amount of data in SendQ
     int sendq_max; // Max size of SendQ
+    int64_t sendqAnchor; // ring position after which the SendQ is sent, -1 if not yet placed
+    int64_t ringPos; // ring position of the next byte to send to this client
     uint32_t ping; // only 24 bit are ever sent
     uint32_t pong; // only 24 bit are ever sent
     int32_t recentMessages;
@@ -188,6 +196,9 @@ struct net_writer
 {
     void *data; // shared write buffer, sized MODES_OUT_BUF_SIZE
     int dataUsed; // number of bytes of write buffer currently used
+    char *ring; // send ring shared by all clients, allocated while connections > 0
+    int64_t ringSize;
+    int64_t ringHead; // total number of bytes ever appended to the ring
     int connections; // number of active clients
     struct net_service *service; // owning service
     int64_t lastWrite; // time of last write to clients
@@ -197,6 +208,25 @@ struct net_writer
     int noTimestamps;
 };
 
+// wire formats rendered once per drained messageBuffer, see encodeMessages()
+enum {
+    FORMAT_BEAST,
+    FORMAT_RAW,
+    FORMAT_SBS,
+    OUTPUT_FORMATS
+};
+
+// maximum encoded size of a single message per format
+#define BEAST_FRAME_MAX (2 + 2 * 6 + 2 + 2 * MODES_LONG_MSG_BYTES)
+#define RAW_LINE_MAX (13 + 2 * MODES_LONG_MSG_BYTES + 2)
+#define SBS_LINE_MAX 200
+
+struct encodedMessage {
+    uint32_t outputs; // writers this message goes to
+    int32_t offset[OUTPUT_FORMATS]; // position in the slab of the respective format
+    int16_t len[OUTPUT_FORMATS];
+};
+
 void serviceListen (struct net_service *service, char *bind_addr, char *bind_ports, int epfd);
 void serviceClose(struct net_service *s);
 
@@ -0,0 +1,249 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// net_uring.c: minimal io_uring wrapper for batched network syscalls
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "readsb.h"
+
+#ifdef ENABLE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+
+struct uringOp {
+    uring_complete_fn complete;
+    void *data;
+};
+
+static struct {
+    int fd;
+    int active;
+    unsigned entries;
+
+    // operations queued or in flight, user_data is the index into ops
+    struct uringOp *ops;
+    unsigned *freeOps;
+    unsigned freeCount;
+
+    // submission queue, shared with the kernel
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    struct io_uring_sqe *sqes;
+
+    // completion queue, shared with the kernel
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+
+    void *sqPtr;
+    size_t sqSize;
+    void *cqPtr;
+    size_t cqSize;
+    size_t sqesSize;
+} ring;
+
+int uringActive(void) {
+    return ring.active;
+}
+
+int uringSpace(void) {
+    return ring.freeCount;
+}
+
+void uringDestroy(void) {
+    if (!ring.active) {
+        return;
+    }
+    munmap(ring.sqes, ring.sqesSize);
+    if (ring.cqPtr != ring.sqPtr) {
+        munmap(ring.cqPtr, ring.cqSize);
+    }
+    munmap(ring.sqPtr, ring.sqSize);
+    close(ring.fd);
+    sfree(ring.ops);
+    sfree(ring.freeOps);
+    memset(&ring, 0, sizeof(ring));
+}
+
+int uringInit(unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    int fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0) {
+        fprintf(stderr, "io_uring_setup failed: %s\n", strerror(errno));
+        return -1;
+    }
+    // IORING_OP_RECV and non-blocking completion need kernel 5.7 or newer
+    if (!(p.features & IORING_FEAT_FAST_POLL)) {
+        fprintf(stderr, "io_uring: kernel too old (need 5.7 or newer)\n");
+        close(fd);
+        return -1;
+    }
+
+    ring.fd = fd;
+    ring.entries = p.sq_entries;
+    ring.sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring.cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring.sqSize = ring.cqSize = imax(ring.sqSize, ring.cqSize);
+    }
+
+    ring.sqPtr = mmap(NULL, ring.sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring.sqPtr == MAP_FAILED) {
+        fprintf(stderr, "io_uring: mmap failed: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring.cqPtr = ring.sqPtr;
+    } else {
+        ring.cqPtr = mmap(NULL, ring.cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring.cqPtr == MAP_FAILED) {
+            fprintf(stderr, "io_uring: mmap failed: %s\n", strerror(errno));
+            munmap(ring.sqPtr, ring.sqSize);
+            close(fd);
+            return -1;
+        }
+    }
+    ring.sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = mmap(NULL, ring.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring.sqes == MAP_FAILED) {
+        fprintf(stderr, "io_uring: mmap failed: %s\n", strerror(errno));
+        if (ring.cqPtr != ring.sqPtr) {
+            munmap(ring.cqPtr, ring.cqSize);
+        }
+        munmap(ring.sqPtr, ring.sqSize);
+        close(fd);
+        return -1;
+    }
+
+    char *sq = ring.sqPtr;
+    ring.sqHead = (unsigned *) (sq + p.sq_off.head);
+    ring.sqTail = (unsigned *) (sq + p.sq_off.tail);
+    ring.sqMask = (unsigned *) (sq + p.sq_off.ring_mask);
+    ring.sqArray = (unsigned *) (sq + p.sq_off.array);
+
+    char *cq = ring.cqPtr;
+    ring.cqHead = (unsigned *) (cq + p.cq_off.head);
+    ring.cqTail = (unsigned *) (cq + p.cq_off.tail);
+    ring.cqMask = (unsigned *) (cq + p.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+
+    ring.ops = cmalloc(ring.entries * sizeof(struct uringOp));
+    ring.freeOps = cmalloc(ring.entries * sizeof(unsigned));
+    for (unsigned i = 0; i < ring.entries; i++) {
+        ring.freeOps[i] = i;
+    }
+    ring.freeCount = ring.entries;
+    ring.active = 1;
+    return 0;
+}
+
+static struct io_uring_sqe *getSqe(uring_complete_fn complete, void *data) {
+    if (ring.freeCount == 0) {
+        fprintf(stderr, "FATAL: io_uring submission queue overflow\n");
+        exit(1);
+    }
+    unsigned op = ring.freeOps[--ring.freeCount];
+    ring.ops[op].complete = complete;
+    ring.ops[op].data = data;
+
+    unsigned tail = *ring.sqTail;
+    unsigned index = tail & *ring.sqMask;
+    struct io_uring_sqe *sqe = &ring.sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = op;
+    ring.sqArray[index] = index;
+    __atomic_store_n(ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+void uringQueueRecv(int fd, void *buf, unsigned len, uring_complete_fn complete, void *data) {
+    struct io_uring_sqe *sqe = getSqe(complete, data);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) buf;
+    sqe->len = len;
+    // complete with -EAGAIN instead of waiting for data
+    sqe->msg_flags = MSG_DONTWAIT;
+}
+
+void uringQueueSendmsg(int fd, struct msghdr *msg, uring_complete_fn complete, void *data) {
+    struct io_uring_sqe *sqe = getSqe(complete, data);
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) msg;
+    sqe->len = 1;
+    // complete with -EAGAIN instead of waiting for socket buffer space
+    sqe->msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+}
+
+static void reap(void) {
+    unsigned head = *ring.cqHead;
+    unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cqMask];
+        unsigned op = cqe->user_data;
+        int res = cqe->res;
+        head++;
+        __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+
+        // free the op first, complete may queue new operations
+        struct uringOp done = ring.ops[op];
+        ring.freeOps[ring.freeCount++] = op;
+        done.complete(done.data, res);
+    }
+}
+
+static void enter(unsigned minComplete) {
+    while (1) {
+        unsigned toSubmit = *ring.sqTail - __atomic_load_n(ring.sqHead, __ATOMIC_ACQUIRE);
+        if (!toSubmit && !minComplete) {
+            return;
+        }
+        int flags = minComplete ? IORING_ENTER_GETEVENTS : 0;
+        int res = syscall(__NR_io_uring_enter, ring.fd, toSubmit, minComplete, flags, NULL, 0);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res < 0 && (errno == EAGAIN || errno == EBUSY)) {
+            // completion queue backlog, the remaining entries are submitted on the next call
+            return;
+        }
+        if (res < 0) {
+            fprintf(stderr, "FATAL: io_uring_enter failed: %s\n", strerror(errno));
+            exit(1);
+        }
+        return;
+    }
+}
+
+void uringSubmit(void) {
+    enter(0);
+    reap();
+}
+
+void uringDrain(void) {
+    while (ring.active && ring.freeCount < ring.entries) {
+        enter(1);
+        reap();
+    }
+}
+
+#endif
@@ -0,0 +1,62 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// net_uring.h: minimal io_uring wrapper for batched network syscalls (header)
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef NET_URING_H
+#define NET_URING_H
+
+// minimal io_uring wrapper used by net_io.c to batch recv / sendmsg syscalls
+// (build with IO_URING=yes, uses the kernel interface directly, no liburing needed)
+//
+// the sockets are non-blocking and operations use MSG_DONTWAIT, the kernel completes them
+// during submission (with -EAGAIN instead of waiting for readiness), epoll is still used for that
+// submission never waits for completions though: an operation the kernel hands off to a worker
+// completes on a later uringSubmit(), the caller keeps its buffers valid until complete is called
+//
+// not thread safe, the caller serializes access
+
+#ifdef ENABLE_IO_URING
+
+#include <sys/socket.h>
+
+#define NET_URING_ENTRIES (512)
+
+typedef void (*uring_complete_fn)(void *data, int res);
+
+// return value 0: SUCCESS, -1: ERROR (io_uring not available, use plain syscalls)
+int uringInit(unsigned entries);
+void uringDestroy(void);
+
+// 1 if the ring is set up
+int uringActive(void);
+
+// number of operations that can still be queued (queued and in flight operations count against this)
+int uringSpace(void);
+
+// queue operations, complete is called with data and the syscall return value (-errno on error)
+void uringQueueRecv(int fd, void *buf, unsigned len, uring_complete_fn complete, void *data);
+void uringQueueSendmsg(int fd, struct msghdr *msg, uring_complete_fn complete, void *data);
+
+// submit all queued operations with a single syscall without waiting,
+// then call complete for every operation that has finished, including ones from earlier calls
+void uringSubmit(void);
+
+// wait for all operations in flight to complete, used before freeing everything on exit
+void uringDrain(void);
+
+#endif
+
+#endif
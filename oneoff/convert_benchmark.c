@@ -24,10 +24,14 @@
 
 #include "../readsb.h"
 
+// samples per buffer, about the size of an rtl-sdr transfer
+#define BENCH_SAMPLES (128 * 1024)
+
 static void **testdata_uc8;
 static void **testdata_sc16;
 static void **testdata_sc16q11;
 static uint16_t *outdata;
+static uint16_t *refdata;
 
 // SC16Q11_TABLE_BITS notes:
 
@@ -60,24 +64,34 @@ static uint16_t *outdata;
 // SC16Q11_TABLE_BITS=8:          5.77M samples/second
 // SC16Q11_TABLE_BITS=7:         10.23M samples/second
 
-void prepare()
+// convert.o / util.o reference these, the benchmark doesn't link readsb.o
+struct _Modes Modes;
+
+void setExit(int arg) {
+    exit(arg);
+}
+
+static double seconds = 2;
+
+static void prepare()
 {
     srand(1);
 
     testdata_uc8 = calloc(10, sizeof(void*));
     testdata_sc16 = calloc(10, sizeof(void*));
     testdata_sc16q11 = calloc(10, sizeof(void*));
-    outdata = calloc(MODES_MAG_BUF_SAMPLES, sizeof(uint16_t));
+    outdata = calloc(BENCH_SAMPLES, sizeof(uint16_t));
+    refdata = calloc(BENCH_SAMPLES, sizeof(uint16_t));
 
     for (int buf = 0; buf < 10; ++buf) {
-        uint8_t *uc8 = calloc(MODES_MAG_BUF_SAMPLES, 2);
+        uint8_t *uc8 = calloc(BENCH_SAMPLES, 2);
         testdata_uc8[buf] = uc8;;
-        uint16_t *sc16 = calloc(MODES_MAG_BUF_SAMPLES, 4);
+        uint16_t *sc16 = calloc(BENCH_SAMPLES, 4);
         testdata_sc16[buf] = sc16;
-        uint16_t *sc16q11 = calloc(MODES_MAG_BUF_SAMPLES, 4);
+        uint16_t *sc16q11 = calloc(BENCH_SAMPLES, 4);
         testdata_sc16q11[buf] = sc16q11;
 
-        for (unsigned i = 0; i < MODES_MAG_BUF_SAMPLES; ++i) {
+        for (unsigned i = 0; i < BENCH_SAMPLES; ++i) {
             double I = 2.0 * rand() / (RAND_MAX + 1.0) - 1.0;
             double Q = 2.0 * rand() / (RAND_MAX + 1.0) - 1.0;
 
@@ -93,11 +107,48 @@ void prepare()
     }
 }
 
-void test(const char *what, input_format_t format, void **data, double sample_rate, bool filter_dc) {
-    fprintf(stderr, "Benchmarking: %s ", what);
+static void **format_data(input_format_t format) {
+    switch (format) {
+        case INPUT_UC8: return testdata_uc8;
+        case INPUT_SC16: return testdata_sc16;
+        case INPUT_SC16Q11: return testdata_sc16q11;
+    }
+    return NULL;
+}
+
+// compare against the preferred scalar converter for the same format
+static void check(input_format_t format, int filter_dc, void **data, iq_convert_fn converter, struct converter_state *state) {
+    struct converter_state *refstate;
+    Modes.debug_no_simd = 1;
+    iq_convert_fn reference = init_converter(format, 2400000, filter_dc, &refstate);
+    Modes.debug_no_simd = 0;
+    if (!reference || reference == converter) {
+        if (reference)
+            cleanup_converter(&refstate);
+        return;
+    }
+
+    // odd sample count to exercise the scalar tail
+    unsigned n = BENCH_SAMPLES - 3;
+    double level, power, reflevel, refpower;
+    converter(data[0], outdata, n, state, &level, &power);
+    reference(data[0], refdata, n, refstate, &reflevel, &refpower);
+    cleanup_converter(&refstate);
+
+    int maxdiff = 0;
+    for (unsigned i = 0; i < n; i++) {
+        maxdiff = imax(maxdiff, abs(outdata[i] - refdata[i]));
+    }
+    fprintf(stderr, "  max difference to scalar: %d, mean level %.6f / %.6f, mean power %.6f / %.6f\n",
+            maxdiff, level, reflevel, power, refpower);
+}
+
+static void test(int n, const char *what, input_format_t format, int filter_dc) {
+    void **data = format_data(format);
+    fprintf(stderr, "Benchmarking: %s%s ", what, filter_dc ? " (DC filter)" : "");
 
     struct converter_state *state;
-    iq_convert_fn converter = init_converter(format, sample_rate, filter_dc, &state);
+    iq_convert_fn converter = init_converter_n(n, 2400000, &state);
     if (!converter) {
         fprintf(stderr, "Can't initialize converter\n");
         return;
@@ -107,16 +158,17 @@ void test(const char *what, input_format_t format, void **data, double sample_ra
     int iterations = 0;
 
     // Run it once to force init.
-    converter(data[0], outdata, MODES_MAG_BUF_SAMPLES, state, NULL, NULL);
+    converter(data[0], outdata, BENCH_SAMPLES, state, NULL, NULL);
 
-    while (total.tv_sec < 5) {
-        fprintf(stderr, ".");
+    while (total.tv_sec + total.tv_nsec * 1e-9 < seconds) {
+        if (iterations % 20 == 0)
+            fprintf(stderr, ".");
 
         struct timespec start;
         start_cpu_timing(&start);
 
         for (int i = 0; i < 10; ++i) {
-            converter(data[i], outdata, MODES_MAG_BUF_SAMPLES, state, NULL, NULL);
+            converter(data[i], outdata, BENCH_SAMPLES, state, NULL, NULL);
         }
 
         end_cpu_timing(&start, &total);
@@ -124,29 +176,31 @@ void test(const char *what, input_format_t format, void **data, double sample_ra
     }
 
     fprintf(stderr, "\n");
-    cleanup_converter(&state);
 
-    double samples = 10.0 * iterations * MODES_MAG_BUF_SAMPLES;
+    double samples = 10.0 * iterations * BENCH_SAMPLES;
     double nanos = total.tv_sec * 1e9 + total.tv_nsec;
     fprintf(stderr, "  %.2fM samples in %.6f seconds\n",
             samples / 1e6, nanos / 1e9);
     fprintf(stderr, "  %.2fM samples/second\n",
             samples / nanos * 1e3);
+
+    check(format, filter_dc, data, converter, state);
+    cleanup_converter(&state);
 }
 
+// usage: convert_benchmark [seconds per converter]
 int main(int argc, char **argv)
 {
-    MODES_NOTUSED(argc);
-    MODES_NOTUSED(argv);
+    if (argc > 1) {
+        seconds = atof(argv[1]);
+    }
 
     prepare();
 
-    test("SC16Q11, DC", INPUT_SC16Q11, testdata_sc16q11, 2400000, true);
-    test("SC16Q11, no DC", INPUT_SC16Q11, testdata_sc16q11, 2400000, false);
-
-    test("UC8, DC", INPUT_UC8, testdata_uc8, 2400000, true);
-    test("UC8, no DC", INPUT_UC8, testdata_uc8, 2400000, false);
-
-    test("SC16, DC", INPUT_SC16, testdata_sc16, 2400000, true);
-    test("SC16, no DC", INPUT_SC16, testdata_sc16, 2400000, false);
+    const char *what;
+    input_format_t format;
+    int filter_dc;
+    for (int n = 0; (what = converter_info(n, &format, &filter_dc)); n++) {
+        test(n, what, format, filter_dc);
+    }
 }
@@ -0,0 +1,299 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// trace_codec_benchmark.c: compressed size and speed of trace chunks, zstd vs columnar + zstd
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "../readsb.h"
+
+// chunk samples: files with the uncompressed fourState arrays as passed to compressChunk()
+// (enable the tracechunk_samples block in compressChunk to collect them from a running readsb)
+// without sample files, synthetic flights are used
+
+#define MAX_CHUNKS (64 * 1024)
+#define SYNTHETIC_CHUNKS (2000)
+#define SYNTHETIC_POINTS (256)
+
+// util.o references these, the benchmark doesn't link readsb.o
+struct _Modes Modes;
+
+void setExit(int arg) {
+    exit(arg);
+}
+
+static double seconds = 2;
+
+struct chunk {
+    fourState *states;
+    int points;
+};
+
+static struct chunk chunks[MAX_CHUNKS];
+static int chunkCount;
+
+static void addFile(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct char_buffer cb = readWholeFile(fd, (char *) path);
+    close(fd);
+    int points = cb.len / sizeof(fourState) * SFOUR;
+    if (!cb.buffer || points == 0 || cb.len % sizeof(fourState) != 0 || chunkCount >= MAX_CHUNKS) {
+        sfree(cb.buffer);
+        return;
+    }
+    chunks[chunkCount].states = (fourState *) cb.buffer;
+    chunks[chunkCount].points = points;
+    chunkCount++;
+}
+
+static void addPath(const char *path) {
+    DIR *dir = opendir(path);
+    if (!dir) {
+        addFile(path);
+        return;
+    }
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        char file[PATH_MAX];
+        snprintf(file, sizeof(file), "%s/%s", path, ent->d_name);
+        addFile(file);
+    }
+    closedir(dir);
+}
+
+// straight and level flights with some turns, climbs and irregular position intervals
+static void synthetic() {
+    srand(1);
+    for (int c = 0; c < SYNTHETIC_CHUNKS; c++) {
+        fourState *states = cmalloc(stateBytes(SYNTHETIC_POINTS));
+        memset(states, 0, stateBytes(SYNTHETIC_POINTS));
+        int64_t ts = 1700000000000LL + rand() % 100000;
+        double lat = -60 + rand() % 120;
+        double lon = -180 + rand() % 360;
+        double track = rand() % 360;
+        double gs = 150 + rand() % 350;
+        double alt = 1000 + rand() % 40000;
+        double rate = 0;
+        for (int i = 0; i < SYNTHETIC_POINTS; i++) {
+            struct state *s = getState(states, i);
+            int64_t step = 1000 + rand() % 30000;
+            ts += step;
+            if (rand() % 16 == 0) {
+                track = fmod(track + rand() % 90 - 45 + 360, 360);
+                rate = (rand() % 5 - 2) * 1000;
+            }
+            double dist = gs * 0.514 * step / 1000.0;
+            lat += dist * cos(track * M_PI / 180) / 111000.0;
+            lon += dist * sin(track * M_PI / 180) / 111000.0;
+            alt = fmax(0, alt + rate * step / 60000.0);
+
+            s->timestamp = ts;
+            s->lat = (int32_t) (lat * 1E6);
+            s->lon = (int32_t) (lon * 1E6);
+            s->gs = (uint16_t) (gs * _gs_factor);
+            s->track = (uint16_t) (track * _track_factor);
+            s->baro_alt = (int16_t) (((int) alt / 25 * 25) * _alt_factor);
+            s->baro_rate = (int16_t) ((rate + rand() % 64) * _rate_factor);
+            s->geom_alt = (int16_t) ((((int) alt + 200) / 25 * 25) * _alt_factor);
+            s->geom_rate = s->baro_rate;
+            s->gs_valid = s->track_valid = s->baro_alt_valid = s->baro_rate_valid = 1;
+            s->geom_alt_valid = s->geom_rate_valid = 1;
+            s->stale = (rand() % 64 == 0);
+            s->addrtype = ADDR_ADSB_ICAO;
+            struct state_all *all = getStateAll(states, i);
+            if (all) {
+                memcpy(all->callsign, "TEST123 ", 8);
+                all->squawk = 0x1000;
+                all->nav_altitude_mcp = 35000 / 4;
+                all->callsign_valid = all->squawk_valid = all->nav_altitude_mcp_valid = 1;
+            }
+        }
+        chunks[chunkCount].states = states;
+        chunks[chunkCount].points = SYNTHETIC_POINTS;
+        chunkCount++;
+    }
+}
+
+static double elapsed(struct timespec *total) {
+    return total->tv_sec + total->tv_nsec * 1e-9;
+}
+
+static void bench(int columnar, ZSTD_CCtx *cctx, ZSTD_DCtx *dctx, unsigned char *encoded, size_t encodedCap,
+        unsigned char *compressed, size_t compressedCap, fourState *out) {
+    size_t rawBytes = 0;
+    size_t compressedBytes = 0;
+    size_t codecBytes = 0;
+
+    for (int c = 0; c < chunkCount; c++) {
+        struct chunk *ch = &chunks[c];
+        size_t bytes = stateBytes(ch->points);
+        rawBytes += bytes;
+        const void *src = ch->states;
+        size_t len = bytes;
+        if (columnar) {
+            size_t res = traceEncode(ch->states, ch->points, encoded, encodedCap);
+            if (res) {
+                src = encoded;
+                len = res;
+            }
+        }
+        codecBytes += len;
+        size_t csize = ZSTD_compressCCtx(cctx, compressed, compressedCap, src, len, 2);
+        compressedBytes += csize;
+
+        // round trip check
+        size_t dsize = ZSTD_decompressDCtx(dctx, encoded, encodedCap, compressed, csize);
+        if (traceCodecEncoded(encoded, dsize)) {
+            if (traceDecode(encoded, dsize, out, ch->points) != ch->points) {
+                fprintf(stderr, "decode failed\n");
+                exit(1);
+            }
+        } else {
+            memcpy(out, encoded, dsize);
+        }
+        if (memcmp(out, ch->states, bytes) != 0) {
+            fprintf(stderr, "round trip mismatch, chunk %d\n", c);
+            exit(1);
+        }
+    }
+
+    struct timespec compressTime = { 0, 0 };
+    int compressRuns = 0;
+    while (elapsed(&compressTime) < seconds / 2) {
+        struct timespec start;
+        start_cpu_timing(&start);
+        for (int c = 0; c < chunkCount; c++) {
+            struct chunk *ch = &chunks[c];
+            const void *src = ch->states;
+            size_t len = stateBytes(ch->points);
+            if (columnar) {
+                size_t res = traceEncode(ch->states, ch->points, encoded, encodedCap);
+                if (res) {
+                    src = encoded;
+                    len = res;
+                }
+            }
+            ZSTD_compressCCtx(cctx, compressed, compressedCap, src, len, 2);
+        }
+        end_cpu_timing(&start, &compressTime);
+        compressRuns++;
+    }
+
+    // decompression of all chunks, compressed once up front
+    unsigned char **packed = cmalloc(chunkCount * sizeof(unsigned char *));
+    size_t *packedLen = cmalloc(chunkCount * sizeof(size_t));
+    for (int c = 0; c < chunkCount; c++) {
+        struct chunk *ch = &chunks[c];
+        const void *src = ch->states;
+        size_t len = stateBytes(ch->points);
+        if (columnar) {
+            size_t res = traceEncode(ch->states, ch->points, encoded, encodedCap);
+            if (res) {
+                src = encoded;
+                len = res;
+            }
+        }
+        packedLen[c] = ZSTD_compressCCtx(cctx, compressed, compressedCap, src, len, 2);
+        packed[c] = cmalloc(packedLen[c]);
+        memcpy(packed[c], compressed, packedLen[c]);
+    }
+
+    struct timespec decompressTime = { 0, 0 };
+    int decompressRuns = 0;
+    while (elapsed(&decompressTime) < seconds / 2) {
+        struct timespec start;
+        start_cpu_timing(&start);
+        for (int c = 0; c < chunkCount; c++) {
+            struct chunk *ch = &chunks[c];
+            if (columnar) {
+                size_t dsize = ZSTD_decompressDCtx(dctx, encoded, encodedCap, packed[c], packedLen[c]);
+                if (traceCodecEncoded(encoded, dsize)) {
+                    traceDecode(encoded, dsize, out, ch->points);
+                } else {
+                    memcpy(out, encoded, dsize);
+                }
+            } else {
+                ZSTD_decompressDCtx(dctx, out, stateBytes(ch->points), packed[c], packedLen[c]);
+            }
+        }
+        end_cpu_timing(&start, &decompressTime);
+        decompressRuns++;
+    }
+
+    for (int c = 0; c < chunkCount; c++) {
+        free(packed[c]);
+    }
+    free(packed);
+    free(packedLen);
+
+    double mb = rawBytes / 1e6;
+    fprintf(stderr, "%-16s raw %9.3f MB", columnar ? "columnar + zstd" : "zstd", mb);
+    if (columnar) {
+        fprintf(stderr, " encoded %9.3f MB", codecBytes / 1e6);
+    } else {
+        fprintf(stderr, "                   ");
+    }
+    fprintf(stderr, " compressed %8.3f MB ratio %5.2f | compress %7.1f MB/s | decompress %7.1f MB/s\n",
+            compressedBytes / 1e6, rawBytes / (double) compressedBytes,
+            mb * compressRuns / elapsed(&compressTime),
+            mb * decompressRuns / elapsed(&decompressTime));
+}
+
+// usage: trace_codec_benchmark [seconds per codec] [chunk sample files or directories ...]
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        seconds = atof(argv[1]);
+    }
+    for (int i = 2; i < argc; i++) {
+        addPath(argv[i]);
+    }
+    if (chunkCount == 0) {
+        fprintf(stderr, "no chunk samples given, using %d synthetic chunks of %d points\n", SYNTHETIC_CHUNKS, SYNTHETIC_POINTS);
+        synthetic();
+    }
+
+    int maxPoints = 0;
+    int64_t points = 0;
+    for (int c = 0; c < chunkCount; c++) {
+        maxPoints = imax(maxPoints, chunks[c].points);
+        points += chunks[c].points;
+    }
+    fprintf(stderr, "%d chunks, %lld points\n", chunkCount, (long long) points);
+
+    size_t encodedCap = imax(traceCodecBound(maxPoints), stateBytes(maxPoints));
+    size_t compressedCap = ZSTD_compressBound(encodedCap);
+    unsigned char *encoded = cmalloc(encodedCap);
+    unsigned char *compressed = cmalloc(compressedCap);
+    fourState *out = cmalloc(stateBytes(maxPoints));
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+
+    bench(0, cctx, dctx, encoded, encodedCap, compressed, compressedCap, out);
+    bench(1, cctx, dctx, encoded, encodedCap, compressed, compressedCap, out);
+
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeDCtx(dctx);
+    free(encoded);
+    free(compressed);
+    free(out);
+    for (int c = 0; c < chunkCount; c++) {
+        free(chunks[c].states);
+    }
+    return 0;
+}
@@ -177,6 +177,8 @@ static void configSetDefaults(void) {
     Modes.state_chunk_size_read = Modes.state_chunk_size;
 
     Modes.decodeThreads = 1;
+    Modes.apiUpdateThreads = 1;
+    Modes.demodThreads = 1;
 
     Modes.filterDF = 0;
     Modes.filterDFbitset = 0;
@@ -238,6 +240,7 @@ static void configSetDefaults(void) {
     Modes.messageRateMult = 1.0f;
 
     Modes.apiShutdownDelay = 0 * SECONDS;
+    Modes.apiCacheSize = 16 * 1024 * 1024;
 
     // default this on
     Modes.enableAcasCsv = 1;
@@ -275,6 +278,10 @@ static void modesInit(void) {
     Modes.allTasks = allocate_task_group(2 * Modes.allPoolSize);
     Modes.allPool = threadpool_create(Modes.allPoolSize, 4);
 
+    if (Modes.demodThreads > 1) {
+        Modes.demodPool = threadpool_create(Modes.demodThreads, 0);
+    }
+
     for (int i = 0; i <= GLOBE_MAX_INDEX; i++) {
         ca_init(&Modes.globeLists[i]);
     }
@@ -311,7 +318,8 @@ static void modesInit(void) {
 
     init_globe_index();
 
-    quickInit();
+    slabInit();
+    aircraftIndexMaintain();
 }
 
 static void lockThreads() {
@@ -594,7 +602,7 @@ static void *jsonEntryPoint(void *arg) {
             sfree(cb.buffer);
         }
 
-        struct char_buffer cb3 = generateAircraftBin(&pass_buffer);
+        struct char_buffer cb3 = apiGenerateAircraftBin(&pass_buffer);
 
         if (Modes.enableBinGz) {
             writeJsonToGzip(Modes.json_dir, "aircraft.binCraft", cb3, 1);
@@ -606,7 +614,7 @@ static void *jsonEntryPoint(void *arg) {
         }
 
         if (Modes.json_globe_index) {
-            struct char_buffer cb2 = generateGlobeBin(-1, 1, &pass_buffer);
+            struct char_buffer cb2 = apiGenerateGlobeBin(-1, 1, &pass_buffer);
             if (Modes.enableBinGz) {
                 writeJsonToGzip(Modes.json_dir, "globeMil_42777.binCraft", cb2, 1);
             }
@@ -710,7 +718,7 @@ static void *globeBinEntryPoint(void *arg) {
 
             int index = Modes.json_globe_indexes[j];
 
-            struct char_buffer cb2 = generateGlobeBin(index, 0, &pass_buffer);
+            struct char_buffer cb2 = apiGenerateGlobeBin(index, 0, &pass_buffer);
 
             if (Modes.enableBinGz) {
                 snprintf(filename, 31, "globe_%04d.binCraft", index);
@@ -722,7 +730,7 @@ static void *globeBinEntryPoint(void *arg) {
                 writeJsonToFile(Modes.json_dir, filename, ident(generateZstd(cctx, &zstd_buffer, cb2, 1)));
             }
 
-            struct char_buffer cb3 = generateGlobeBin(index, 1, &pass_buffer);
+            struct char_buffer cb3 = apiGenerateGlobeBin(index, 1, &pass_buffer);
 
             if (Modes.enableBinGz) {
                 snprintf(filename, 31, "globeMil_%04d.binCraft", index);
@@ -942,6 +950,10 @@ static void traceWriteTask(void *arg, threadpool_threadbuffers_t *buffer_group)
     // increment info->from to mark this part of the task as finshed
     for (int j = info->from; j < info->to; j++, info->from++) {
         for (a = Modes.aircraft[j]; a; a = a->next) {
+            if (a->traceLazy) {
+                // trace not restored from the state file yet or the lazy buffer not yet freed by traceMaintenance
+                continue;
+            }
             if (Modes.triggerPastDayTraceWrite && !a->initialTraceWriteDone) {
                 a->trace_writeCounter = 0xc0ffee;
                 a->trace_write |= WRECENT;
@@ -1267,6 +1279,7 @@ static void cleanup_and_exit(int code) {
     sfree(Modes.dev_name);
     sfree(Modes.filename);
     sfree(Modes.prom_file);
+    sfree(Modes.traceDictFile);
     sfree(Modes.json_dir);
     sfree(Modes.globe_history_dir);
     sfree(Modes.heatmap_dir);
@@ -1311,7 +1324,8 @@ static void cleanup_and_exit(int code) {
     ca_destroy(&Modes.aircraftActive);
 
     icaoFilterDestroy();
-    quickDestroy();
+    aircraftIndexDestroy();
+    slabDestroy();
 
     exit(code);
 }
@@ -1469,6 +1483,9 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptRaw:
             Modes.raw = 1;
             break;
+        case OptDemodThreads:
+            Modes.demodThreads = imax(1, atoi(arg));
+            break;
         case OptPreambleThreshold:
             Modes.preambleThreshold = (uint32_t) (imax(imin(strtoll(arg, NULL, 10), PREAMBLE_THRESHOLD_MAX), PREAMBLE_THRESHOLD_MIN));
             break;
@@ -1620,6 +1637,19 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptStateOnlyOnExit:
             Modes.state_only_on_exit = 1;
             break;
+        case OptStateLazyTraces:
+            Modes.stateLazyTraces = 1;
+            break;
+        case OptStateIncremental:
+            Modes.stateIncremental = 1;
+            break;
+        case OptTraceDict:
+            sfree(Modes.traceDictFile);
+            Modes.traceDictFile = strdup(arg);
+            break;
+        case OptTraceColumnar:
+            Modes.traceColumnar = 1;
+            break;
         case OptStateInterval:
             Modes.state_write_interval = (int64_t) (atof(arg) * 1.0 * SECONDS);
             if (Modes.state_write_interval < 59 * SECONDS) {
@@ -1787,6 +1817,18 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptApiShutdownDelay:
             Modes.apiShutdownDelay = atof(arg) * SECONDS;
             break;
+        case OptApiIncremental:
+            Modes.apiIncremental = atof(arg) * SECONDS;
+            break;
+        case OptApiSlowQuery:
+            Modes.apiSlowQuery = atof(arg) * 1000;
+            break;
+        case OptApiUpdateThreads:
+            Modes.apiUpdateThreads = imax(1, atoi(arg));
+            break;
+        case OptApiCacheSize:
+            Modes.apiCacheSize = (int64_t) (atof(arg) * 1024 * 1024);
+            break;
         case OptNetSbsInPorts:
             sfree(Modes.net_input_sbs_ports);
             Modes.net_input_sbs_ports = strdup(arg);
@@ -1829,6 +1871,9 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptDecodeThreads:
             Modes.decodeThreads = imax(1, atoi(arg));
             break;
+        case OptTrackShards:
+            Modes.trackShards = imax(0, atoi(arg));
+            break;
         case OptNetIngest:
             Modes.netIngest = 1;
             break;
@@ -2050,6 +2095,8 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
                         break;
                     case 'y': Modes.debug_position_timing = 1;
                         break;
+                    case 'z': Modes.debug_no_simd = 1;
+                        break;
 
                     default:
                         fprintf(stderr, "Unknown debugging flag: %c\n", *arg);
@@ -2380,10 +2427,10 @@ static void configAfterParse() {
     }
 }
 
-static void notask_save_blob(uint32_t blob, char *stateDir) {
+static void notask_save_blob(uint32_t blob, char *stateDir, int incremental) {
     threadpool_buffer_t pbuffer1 = { 0 };
     threadpool_buffer_t pbuffer2 = { 0 };
-    save_blob(blob, &pbuffer1, &pbuffer2, stateDir);
+    save_blob(blob, &pbuffer1, &pbuffer2, stateDir, incremental);
     free_threadpool_buffer(&pbuffer1);
     free_threadpool_buffer(&pbuffer2);
 }
@@ -2431,7 +2478,7 @@ static int checkWriteStateDir(char *baseDir) {
         writeInternalState();
     } else if (len == 2) {
         uint32_t suffix = strtol(tmp, NULL, 16);
-        notask_save_blob(suffix, baseDir);
+        notask_save_blob(suffix, baseDir, 0);
         fprintf(stderr, "save_blob: %02x\n", suffix);
     }
 
@@ -2536,6 +2583,8 @@ static void miscStuff(int64_t now) {
 
     checkSetGain();
 
+    traceDictTrain();
+
     // don't do everything at once ... this stuff isn't that time critical it'll get its turn
 
     if (checkWriteState()) {
@@ -2555,7 +2604,7 @@ static void miscStuff(int64_t now) {
             struct timespec watch;
             startWatch(&watch);
 
-            notask_save_blob(blob, Modes.state_dir);
+            notask_save_blob(blob, Modes.state_dir, Modes.stateIncremental);
 
             int64_t elapsed = stopWatch(&watch);
             if (elapsed > 0.5 * SECONDS || elapsed > blob_interval / 3) {
@@ -2781,6 +2830,8 @@ int main(int argc, char **argv) {
     checkNewDay(mstime());
     checkNewDayAcas(mstime());
 
+    traceDictInit();
+
     if (Modes.state_dir) {
         readInternalState();
         if (Modes.writeInternalState) {
@@ -2797,8 +2848,9 @@ int main(int argc, char **argv) {
 
     threadCreate(&Threads.misc, NULL, miscEntryPoint, NULL);
 
-    if (Modes.api || (Modes.json_dir && Modes.onlyBin < 2)) {
-        // provide a json buffer
+    if (Modes.api || Modes.json_dir) {
+        // provide a buffer of json fragments and binCraft records, serialized once per json interval
+        // aircraft.json, the globe files and the api are assembled from it
         Modes.apiUpdate = 1;
         apiBufferInit();
         if (Modes.api) {
@@ -2970,6 +3022,11 @@ int main(int argc, char **argv) {
         destroy_task_group(Modes.allTasks);
     }
 
+    if (Modes.demodPool) {
+        threadpool_destroy(Modes.demodPool);
+    }
+    demodulate2400Cleanup();
+
     if (Modes.tracePool) {
         threadpool_destroy(Modes.tracePool);
         destroy_task_group(Modes.traceTasks);
@@ -101,7 +101,9 @@
 #include "threadpool.h"
 #include <stdatomic.h>
 #include <zstd.h>
+#include <zdict.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 
 
 #include "compat/compat.h"
@@ -139,6 +141,7 @@
 
 // needs to be larger than OUT_BUF_SIZE above
 #define MODES_NET_SNDBUF_SIZE (64*1024)
+#define MODES_NET_SENDQ_PRIVATE (4*1024)
 #define MODES_NET_SNDBUF_MAX  (7)
 
 #define HEX_UNKNOWN (0xDEADBEEF)
@@ -321,6 +324,7 @@ typedef enum {
 #define LOCK_THREADS_MAX 64
 #define PERIODIC_UPDATE (1 * SECONDS)
 #define REMOVE_STALE_INTERVAL (1 * SECONDS)
+#define STATE_LAZY_RESTORE_BUDGET (2048) // --write-state-lazy-traces: traces restored per REMOVE_STALE_INTERVAL
 
 #define STAT_BUCKETS 90 // 90 * 10 seconds = 15 min (max interval in stats.json)
 
@@ -333,6 +337,9 @@ typedef enum {
 #define PING_BUCKETBASE (24) // milliseconds of first bucket
 #define PING_BUCKETMULT (1.2) // each bucket will grow by that factor
 
+#define API_QUERY_TYPES 8 // box, circle, closest, hexList, regList, callsign, typeList, all
+#define API_LATENCY_BUCKETS 104 // log-linear microsecond buckets, 4 per doubling up to 2^26 us
+
 #define PING_REDUCE (1500) // 1.5 seconds
 #define PING_REDUCE_DURATION (15 * SECONDS)
 
@@ -421,9 +428,11 @@ static inline void *malloc_or_exit(size_t alignment, size_t size, const char *fi
 
 #include "toString.h"
 #include "util.h"
+#include "slab.h"
 #include "fasthash.h"
 #include "anet.h"
 #include "net_io.h"
+#include "net_uring.h"
 #include "crc.h"
 #include "demod_2400.h"
 #include "stats.h"
@@ -487,6 +496,16 @@ struct messageBuffer {
     int alloc;
     int id;
     struct client *activeClient;
+    // decode worker state, only used with more than one decode thread
+    int epfd; // epoll instance for the input clients owned by this worker
+    int eventCount;
+    int maxEvents;
+    struct epoll_event *events;
+    int clientCount;
+    struct stats stats; // parsing stats of this worker, merged after each run
+    // output formats rendered once for all writers
+    struct encodedMessage *encoded;
+    char *slab[OUTPUT_FORMATS];
 };
 
 struct _Modes
@@ -539,6 +558,7 @@ struct _Modes
     struct net_service_group services_in; // Active services which primarily receive data
     struct net_service_group services_out; // Active services which primarily send data
     int exitNowEventfd;
+    int decodeWorkerEvent; // address used as epoll data for the decode worker epoll fds
     int exitSoonEventfd;
 
     int net_epfd; // epoll fd used for most network stuff
@@ -551,9 +571,15 @@ struct _Modes
     int decodeThreads;
     threadpool_t *decodePool;
     task_group_t *decodeTasks;
-    pthread_mutex_t decodeLock;
+    pthread_mutex_t decodeLock; // protects client bookkeeping and uat2esnt state between decode workers
     pthread_mutex_t trackLock;
     pthread_mutex_t outputLock;
+    int trackShards; // number of threads processing tracking in parallel (split by ICAO hash)
+    int8_t trackShardsRunning;
+    struct trackShard *trackShardList;
+    threadpool_t *trackShardPool;
+    task_group_t *trackShardTasks;
+    pthread_mutex_t trackSharedMutex; // protects state shared between aircraft while shards are running
 
     int max_fds;
     int max_fds_api;
@@ -618,9 +644,15 @@ struct _Modes
     int apiThreadCount;
     atomic_int apiWorkerCpuMicro;
     atomic_uint apiRequestCounter;
+    atomic_uint apiCacheHitCounter;
+    atomic_uint apiCacheMissCounter;
+    atomic_uint apiLatency[API_QUERY_TYPES][API_LATENCY_BUCKETS];
     atomic_int recentTraceWrites;
     atomic_int fullTraceWrites;
     atomic_int permTraceWrites;
+    atomic_int traceLazyCount; // aircraft with a trace not yet restored from the state file
+    atomic_int traceLazyBudget; // traces restored by traceMaintenance per trackRemoveStale run
+    int64_t traceLazyStart;
     struct net_service apiService;
     struct apiCon **apiListeners;
 
@@ -628,6 +660,10 @@ struct _Modes
     atomic_int *apiFlip;
     struct apiThread *apiThread;
     pthread_mutex_t apiFlipMutex; // mutex to read apiFlip
+    int apiUpdateThreads; // apiUpdate split into this many parts running in parallel
+    struct apiUpdatePart *apiUpdateParts;
+    threadpool_t *apiUpdatePool;
+    task_group_t *apiUpdateTasks;
 
     float messageRate;
     uint32_t messageRateAcc[MESSAGE_RATE_CALC_POINTS];
@@ -672,6 +708,7 @@ struct _Modes
     int8_t debug_send_uuid;
     int8_t debug_provoke_segfault;
     int8_t debug_position_timing;
+    int8_t debug_no_simd; // use the generic demodulator instead of the SIMD versions
     int8_t debug_lastStatus;
     int8_t debug_gps;
     int8_t debug_planefinder;
@@ -733,6 +770,8 @@ struct _Modes
     uint64_t receiver_focus;
 
     uint32_t preambleThreshold;
+    int demodThreads; // number of threads demodulating each sample buffer
+    threadpool_t *demodPool;
     uint32_t net_forward_min_messages;
     int net_output_flush_size; // Minimum Size of output data
     int32_t net_output_beast_reduce_interval; // Position update interval for data reduction
@@ -804,6 +843,16 @@ struct _Modes
     uint64_t dump_lastReceiverId;
     int8_t dump_reduce; // only dump beast that would be sent out according to reduce_interval
     int8_t state_only_on_exit;
+    int8_t stateLazyTraces;
+    int8_t stateIncremental; // periodic state writes only append changed aircraft
+    char *traceDictFile;
+    ZSTD_CDict *_Atomic traceCDict;
+    ZSTD_DDict *_Atomic traceDDict;
+    unsigned traceDictID;
+    atomic_uint traceDictMissing; // dictionary ID trace chunks in the state need but which isn't loaded
+    atomic_int traceDictSamplesDone;
+    int8_t traceColumnar; // columnar encode trace chunks before compressing them
+    int8_t traceColumnarLoaded; // the state loaded might contain columnar or dictionary compressed trace chunks
     int8_t free_aircraft;
     int64_t state_write_interval;
     char *prom_file;
@@ -878,6 +927,9 @@ struct _Modes
     ALIGNED struct distCoords rangeDirs[RANGEDIRS_IVALS][RANGEDIRS_BUCKETS];
 
     int64_t apiShutdownDelay;
+    int64_t apiIncremental; // reuse api entries of aircraft without new messages for up to this long (ms)
+    int64_t apiSlowQuery; // log API queries taking longer than this (microseconds)
+    int64_t apiCacheSize; // bytes for cached compressed api responses, split among the api threads
 };
 
 extern struct _Modes Modes;
@@ -1154,6 +1206,7 @@ enum {
     OptInteractiveTTL,
     OptRaw,
     OptPreambleThreshold,
+    OptDemodThreads,
     OptModeAc,
     OptModeAcAuto,
     OptForwardMlat,
@@ -1198,6 +1251,10 @@ enum {
     OptStateDir,
     OptStateInterval,
     OptStateOnlyOnExit,
+    OptStateLazyTraces,
+    OptStateIncremental,
+    OptTraceDict,
+    OptTraceColumnar,
     OptHeatmap,
     OptHeatmapDir,
     OptDumpBeastDir,
@@ -1237,6 +1294,10 @@ enum {
     OptNetJsonPortNoPos,
     OptNetApiPorts,
     OptApiShutdownDelay,
+    OptApiIncremental,
+    OptApiSlowQuery,
+    OptApiUpdateThreads,
+    OptApiCacheSize,
     OptTar1090UseApi,
     OptNetRoSize,
     OptNetRoInterval,
@@ -1252,6 +1313,7 @@ enum {
     OptSdrBufSize,
     OptGarbage,
     OptDecodeThreads,
+    OptTrackShards,
     OptUuidFile,
     OptRtlSdrEnableAgc,
     OptRtlSdrPpm,
@@ -1282,6 +1344,7 @@ enum {
 
 // This one needs modesMessage:
 #include "track.h"
+#include "trace_codec.h"
 #include "mode_s.h"
 #include "comm_b.h"
 
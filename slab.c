@@ -0,0 +1,344 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// slab.c: slab allocator for aircraft and size classed arenas for trace buffers
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "readsb.h"
+
+// slabs are mmap'ed and aligned to their size, which is a power of 2
+// a minimum of 256 kB keeps the number of mappings reasonable (vm.max_map_count)
+#define SLAB_MIN_BYTES (256 * 1024)
+#define SLAB_MIN_OBJECTS 8
+#define SLAB_HEADER 64
+
+// trace size classes: 4 per doubling from 32 bytes to 128 kB, multiples of 16
+// larger allocations use malloc
+#define TRACE_MIN_CLASS 32
+#define TRACE_MAX_CLASS (128 * 1024)
+#define TRACE_MAX_CLASSES 64
+
+struct slab {
+    struct slab *next; // partial or full list
+    struct slab *prev;
+    void *freeList; // freed objects, linked through their first bytes
+    char *unused; // objects never handed out start here
+    uint32_t used;
+};
+
+struct slabClass {
+    pthread_mutex_t mutex;
+    size_t objSize;
+    size_t slabBytes;
+    uint32_t perSlab;
+    struct slab *partial; // slabs with free objects, the fullest ones tend to be at the head
+    struct slab *full; // slabs without free objects, only kept for classDestroy()
+    struct slab *spare; // one empty slab kept around
+    int64_t slabs;
+    int64_t objects;
+    int64_t requested;
+};
+
+static struct {
+    int initialized;
+    struct slabClass aircraft;
+    struct slabClass trace[TRACE_MAX_CLASSES];
+    int traceClasses;
+
+    pthread_mutex_t largeMutex;
+    int64_t largeCount;
+    int64_t largeBytes;
+} slabs;
+
+static void classInit(struct slabClass *cls, size_t objSize) {
+    memset(cls, 0, sizeof(struct slabClass));
+    pthread_mutex_init(&cls->mutex, NULL);
+    cls->objSize = objSize;
+    cls->slabBytes = SLAB_MIN_BYTES;
+    while (cls->slabBytes < SLAB_HEADER + SLAB_MIN_OBJECTS * objSize) {
+        cls->slabBytes *= 2;
+    }
+    cls->perSlab = (cls->slabBytes - SLAB_HEADER) / objSize;
+}
+
+static void *mapAligned(size_t bytes) {
+    char *p = mmap(NULL, 2 * bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+    char *aligned = (char *) (((uintptr_t) p + bytes - 1) & ~((uintptr_t) bytes - 1));
+    if (aligned > p) {
+        munmap(p, aligned - p);
+    }
+    if (aligned + bytes < p + 2 * bytes) {
+        munmap(aligned + bytes, (p + 2 * bytes) - (aligned + bytes));
+    }
+    return aligned;
+}
+
+static void listUnlink(struct slab **list, struct slab *s) {
+    if (s->prev) {
+        s->prev->next = s->next;
+    } else {
+        *list = s->next;
+    }
+    if (s->next) {
+        s->next->prev = s->prev;
+    }
+    s->next = s->prev = NULL;
+}
+
+static void listPush(struct slab **list, struct slab *s) {
+    s->prev = NULL;
+    s->next = *list;
+    if (*list) {
+        (*list)->prev = s;
+    }
+    *list = s;
+}
+
+static void *classAlloc(struct slabClass *cls, size_t size) {
+    pthread_mutex_lock(&cls->mutex);
+
+    struct slab *s = cls->partial;
+    if (!s) {
+        if (cls->spare) {
+            s = cls->spare;
+            cls->spare = NULL;
+        } else {
+            s = mapAligned(cls->slabBytes);
+            if (!s) {
+                fprintf(stderr, "FATAL: slab allocation of %lld bytes failed: %s (insufficient memory?)\n",
+                        (long long) cls->slabBytes, strerror(errno));
+                exit(1);
+            }
+            memset(s, 0, sizeof(struct slab));
+            s->unused = (char *) s + SLAB_HEADER;
+            cls->slabs++;
+        }
+        listPush(&cls->partial, s);
+    }
+
+    void *obj;
+    if (s->freeList) {
+        obj = s->freeList;
+        s->freeList = *((void **) obj);
+    } else {
+        obj = s->unused;
+        s->unused += cls->objSize;
+    }
+    if (++s->used == cls->perSlab) {
+        listUnlink(&cls->partial, s);
+        listPush(&cls->full, s);
+    }
+
+    cls->objects++;
+    cls->requested += size;
+
+    pthread_mutex_unlock(&cls->mutex);
+    return obj;
+}
+
+static void classFree(struct slabClass *cls, void *obj, size_t size) {
+    struct slab *s = (struct slab *) ((uintptr_t) obj & ~((uintptr_t) cls->slabBytes - 1));
+
+    pthread_mutex_lock(&cls->mutex);
+
+    *((void **) obj) = s->freeList;
+    s->freeList = obj;
+
+    if (s->used-- == cls->perSlab) {
+        // was full, it's the fullest slab with free space now
+        listUnlink(&cls->full, s);
+        listPush(&cls->partial, s);
+    }
+    if (s->used == 0) {
+        listUnlink(&cls->partial, s);
+        if (!cls->spare) {
+            cls->spare = s;
+        } else {
+            munmap(s, cls->slabBytes);
+            cls->slabs--;
+        }
+    }
+
+    cls->objects--;
+    cls->requested -= size;
+
+    pthread_mutex_unlock(&cls->mutex);
+}
+
+static void classDestroy(struct slabClass *cls) {
+    while (cls->partial) {
+        struct slab *s = cls->partial;
+        listUnlink(&cls->partial, s);
+        munmap(s, cls->slabBytes);
+    }
+    while (cls->full) {
+        struct slab *s = cls->full;
+        listUnlink(&cls->full, s);
+        munmap(s, cls->slabBytes);
+    }
+    if (cls->spare) {
+        munmap(cls->spare, cls->slabBytes);
+    }
+    pthread_mutex_destroy(&cls->mutex);
+    memset(cls, 0, sizeof(struct slabClass));
+}
+
+void slabInit() {
+    if (slabs.initialized) {
+        return;
+    }
+    // cache line aligned aircraft
+    classInit(&slabs.aircraft, (sizeof(struct aircraft) + 63) / 64 * 64);
+
+    int n = 0;
+    size_t last = 0;
+    for (size_t base = TRACE_MIN_CLASS; base < TRACE_MAX_CLASS; base *= 2) {
+        for (int step = 0; step < 4; step++) {
+            size_t size = (base + base * step / 4 + 15) / 16 * 16;
+            if (size != last) {
+                classInit(&slabs.trace[n++], size);
+                last = size;
+            }
+        }
+    }
+    classInit(&slabs.trace[n++], TRACE_MAX_CLASS);
+    slabs.traceClasses = n;
+
+    pthread_mutex_init(&slabs.largeMutex, NULL);
+    slabs.initialized = 1;
+}
+
+void slabDestroy() {
+    if (!slabs.initialized) {
+        return;
+    }
+    classDestroy(&slabs.aircraft);
+    for (int i = 0; i < slabs.traceClasses; i++) {
+        classDestroy(&slabs.trace[i]);
+    }
+    pthread_mutex_destroy(&slabs.largeMutex);
+    memset(&slabs, 0, sizeof(slabs));
+}
+
+struct aircraft *aircraftAlloc() {
+    return classAlloc(&slabs.aircraft, sizeof(struct aircraft));
+}
+
+void aircraftFree(struct aircraft *a) {
+    classFree(&slabs.aircraft, a, sizeof(struct aircraft));
+}
+
+static struct slabClass *traceClass(size_t size) {
+    int lo = 0;
+    int hi = slabs.traceClasses - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (slabs.trace[mid].objSize < size) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return &slabs.trace[lo];
+}
+
+void *traceAlloc(size_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+    if (size > TRACE_MAX_CLASS) {
+        pthread_mutex_lock(&slabs.largeMutex);
+        slabs.largeCount++;
+        slabs.largeBytes += size;
+        pthread_mutex_unlock(&slabs.largeMutex);
+        return cmalloc(size);
+    }
+    return classAlloc(traceClass(size), size);
+}
+
+void traceFree(void *p, size_t size) {
+    if (!p) {
+        return;
+    }
+    if (size > TRACE_MAX_CLASS) {
+        pthread_mutex_lock(&slabs.largeMutex);
+        slabs.largeCount--;
+        slabs.largeBytes -= size;
+        pthread_mutex_unlock(&slabs.largeMutex);
+        free(p);
+        return;
+    }
+    classFree(traceClass(size), p, size);
+}
+
+struct classTotals {
+    int64_t slabs;
+    int64_t slabBytes;
+    int64_t objects;
+    int64_t objectBytes;
+    int64_t requested;
+};
+
+static void classAddTotals(struct slabClass *cls, struct classTotals *t) {
+    pthread_mutex_lock(&cls->mutex);
+    t->slabs += cls->slabs;
+    t->slabBytes += cls->slabs * cls->slabBytes;
+    t->objects += cls->objects;
+    t->objectBytes += cls->objects * cls->objSize;
+    t->requested += cls->requested;
+    pthread_mutex_unlock(&cls->mutex);
+}
+
+static char *appendTotals(char *p, char *end, const char *key, struct classTotals *t) {
+    // occupancy: slab memory handed out as objects
+    // fragmentation: slab memory not holding requested bytes (partially used slabs and size class rounding)
+    double occupancy = t->slabBytes ? t->objectBytes / (double) t->slabBytes : 0;
+    double fragmentation = t->slabBytes ? 1.0 - t->requested / (double) t->slabBytes : 0;
+    p = safe_snprintf(p, end, "\"%s\":{\"slabs\":%lld,\"slab_bytes\":%lld,\"objects\":%lld,\"object_bytes\":%lld,\"requested_bytes\":%lld"
+            ",\"occupancy\":%.3f,\"fragmentation\":%.3f",
+            key,
+            (long long) t->slabs, (long long) t->slabBytes, (long long) t->objects,
+            (long long) t->objectBytes, (long long) t->requested,
+            occupancy, fragmentation);
+    return p;
+}
+
+char *appendSlabStatsJson(char *p, char *end) {
+    if (!slabs.initialized) {
+        return p;
+    }
+    struct classTotals aircraft = { 0 };
+    classAddTotals(&slabs.aircraft, &aircraft);
+
+    struct classTotals trace = { 0 };
+    for (int i = 0; i < slabs.traceClasses; i++) {
+        classAddTotals(&slabs.trace[i], &trace);
+    }
+
+    pthread_mutex_lock(&slabs.largeMutex);
+    int64_t largeCount = slabs.largeCount;
+    int64_t largeBytes = slabs.largeBytes;
+    pthread_mutex_unlock(&slabs.largeMutex);
+
+    p = safe_snprintf(p, end, ",\n\"memory\":{");
+    p = appendTotals(p, end, "aircraft", &aircraft);
+    p = safe_snprintf(p, end, "},");
+    p = appendTotals(p, end, "trace", &trace);
+    p = safe_snprintf(p, end, ",\"large_allocs\":%lld,\"large_bytes\":%lld}}",
+            (long long) largeCount, (long long) largeBytes);
+    return p;
+}
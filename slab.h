@@ -0,0 +1,36 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+// slab allocator for struct aircraft and size classed arenas for trace buffers
+//
+// objects of one size class are carved out of large mmap'ed slabs, a slab is returned to
+// the OS as soon as it's empty (one empty slab per class is kept to avoid thrashing)
+// this keeps long lived and short lived allocations of different sizes from
+// fragmenting the glibc heap
+//
+// frees are sized: the caller passes the size it allocated, the slab is found by
+// aligning the pointer down to the slab size
+//
+// allocation failure is fatal (like cmalloc), the alloc functions don't return NULL
+//
+// all functions are thread safe
+
+struct aircraft;
+
+void slabInit();
+void slabDestroy();
+
+// not zeroed
+struct aircraft *aircraftAlloc();
+void aircraftFree(struct aircraft *a);
+
+// not zeroed, size 0 returns NULL
+void *traceAlloc(size_t size);
+// p may be NULL
+void traceFree(void *p, size_t size);
+#define tfree(x, size) do { traceFree((x), (size)); (x) = NULL; } while (0)
+
+// ,"memory":{...} for stats.json
+char *appendSlabStatsJson(char *p, char *end);
+
+#endif
@@ -62,6 +62,8 @@ void add_timespecs(const struct timespec *x, const struct timespec *y, struct ti
 
 static void display_range_histogram(struct stats *st);
 
+_Thread_local struct stats *stats_local;
+
 void display_stats(struct stats *st) {
     int j;
     time_t tt_start, tt_end;
@@ -318,6 +320,13 @@ void add_stats(const struct stats *st1, const struct stats *st2, struct stats *t
     }
 
     target->api_request_count = st1->api_request_count + st2->api_request_count;
+    target->api_cache_hits = st1->api_cache_hits + st2->api_cache_hits;
+    target->api_cache_misses = st1->api_cache_misses + st2->api_cache_misses;
+    for (int type = 0; type < API_QUERY_TYPES; type++) {
+        for (int bucket = 0; bucket < API_LATENCY_BUCKETS; bucket++) {
+            target->api_latency[type][bucket] = st1->api_latency[type][bucket] + st2->api_latency[type][bucket];
+        }
+    }
 
     target->recentTraceWrites = st1->recentTraceWrites + st2->recentTraceWrites;
     target->fullTraceWrites = st1->fullTraceWrites + st2->fullTraceWrites;
@@ -410,6 +419,13 @@ static void lockCurrent() {
     normalize_timespec(&Modes.stats_current.api_worker_cpu);
 
     Modes.stats_current.api_request_count += atomic_exchange(&Modes.apiRequestCounter, 0);
+    Modes.stats_current.api_cache_hits += atomic_exchange(&Modes.apiCacheHitCounter, 0);
+    Modes.stats_current.api_cache_misses += atomic_exchange(&Modes.apiCacheMissCounter, 0);
+    for (int type = 0; type < API_QUERY_TYPES; type++) {
+        for (int bucket = 0; bucket < API_LATENCY_BUCKETS; bucket++) {
+            Modes.stats_current.api_latency[type][bucket] += atomic_exchange(&Modes.apiLatency[type][bucket], 0);
+        }
+    }
 
     Modes.stats_current.recentTraceWrites += atomic_exchange(&Modes.recentTraceWrites, 0);
     Modes.stats_current.fullTraceWrites += atomic_exchange(&Modes.fullTraceWrites, 0);
@@ -496,6 +512,62 @@ static char * appendTypeCounts(char *p, char *end) {
     return p;
 }
 
+struct latencySummary {
+    uint64_t count;
+    double p50; // milliseconds
+    double p90;
+    double p99;
+    double max;
+};
+
+// percentiles are the upper bound of the bucket they fall into
+static struct latencySummary latencySummarize(uint32_t *hist) {
+    struct latencySummary res = { 0 };
+    for (int i = 0; i < API_LATENCY_BUCKETS; i++) {
+        res.count += hist[i];
+    }
+    if (!res.count) {
+        return res;
+    }
+    uint64_t rank50 = (res.count * 50 + 99) / 100;
+    uint64_t rank90 = (res.count * 90 + 99) / 100;
+    uint64_t rank99 = (res.count * 99 + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < API_LATENCY_BUCKETS; i++) {
+        if (!hist[i]) {
+            continue;
+        }
+        uint64_t before = seen;
+        seen += hist[i];
+        double bound = apiLatencyBucketMax(i) / 1000.0;
+        if (before < rank50 && seen >= rank50)
+            res.p50 = bound;
+        if (before < rank90 && seen >= rank90)
+            res.p90 = bound;
+        if (before < rank99 && seen >= rank99)
+            res.p99 = bound;
+        res.max = bound;
+    }
+    return res;
+}
+
+static char *appendLatencyJson(char *p, char *end, struct stats *st) {
+    char *start = p;
+    for (int type = 0; type < API_QUERY_TYPES; type++) {
+        struct latencySummary sum = latencySummarize(st->api_latency[type]);
+        if (!sum.count) {
+            continue;
+        }
+        p = safe_snprintf(p, end, "%s\"%s\":{\"count\":%llu,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}",
+                p == start ? ",\"latency\":{" : ",",
+                apiQueryTypeName(type), (unsigned long long) sum.count, sum.p50, sum.p90, sum.p99, sum.max);
+    }
+    if (p != start) {
+        p = safe_snprintf(p, end, "}");
+    }
+    return p;
+}
+
 static char * appendStatsJson(char *p, char *end, struct stats *st, const char *key) {
     int i;
 
@@ -586,6 +658,10 @@ static char * appendStatsJson(char *p, char *end, struct stats *st, const char *
         long long trace_json_cpu_millis_sum = 0;
         trace_json_cpu_millis_sum += (int64_t) st->trace_json_cpu.tv_sec * 1000UL + st->trace_json_cpu.tv_nsec / 1000000UL;
 
+        char latency[2048];
+        latency[0] = '\0';
+        appendLatencyJson(latency, latency + sizeof(latency), st);
+
         p = safe_snprintf(p, end,
                 ",\"cpr\":{\"surface\":%u"
                 ",\"airborne\":%u"
@@ -611,6 +687,9 @@ static char * appendStatsJson(char *p, char *end, struct stats *st, const char *
                 ",\"api_workers\":%lld"
                 ",\"api_update\":%lld"
                 ",\"remove_stale\":%lld}"
+                ",\"api\":{\"requests\":%llu"
+                ",\"cache_hits\":%llu"
+                ",\"cache_misses\":%llu%s}"
                 ",\"tracks\":{\"all\":%u"
                 ",\"single_message\":%u}"
                 ",\"messages\":%u"
@@ -644,6 +723,10 @@ static char * appendStatsJson(char *p, char *end, struct stats *st, const char *
             CPU_MILLIS(api_update),
             CPU_MILLIS(remove_stale),
 #undef CPU_MILLIS
+            (unsigned long long) st->api_request_count,
+            (unsigned long long) st->api_cache_hits,
+            (unsigned long long) st->api_cache_misses,
+            latency,
             st->unique_aircraft,
             st->single_message_aircraft,
             st->messages_total,
@@ -713,6 +796,8 @@ struct char_buffer generateStatsJson(int64_t now) {
 
     p = appendTypeCounts(p, end);
 
+    p = appendSlabStatsJson(p, end);
+
     p = appendStatsJson(p, end, &Modes.stats_1min, "last1min");
 
     p = appendStatsJson(p, end, &Modes.stats_5min, "last5min");
@@ -796,6 +881,17 @@ struct char_buffer generatePromFile(int64_t now) {
 #undef CPU_MILLIS
 
     p = safe_snprintf(p, end, "readsb_api_request_count %llu\n", (unsigned long long) st->api_request_count);
+    p = safe_snprintf(p, end, "readsb_api_cache_hits %llu\n", (unsigned long long) st->api_cache_hits);
+    p = safe_snprintf(p, end, "readsb_api_cache_misses %llu\n", (unsigned long long) st->api_cache_misses);
+    for (int type = 0; Modes.api && type < API_QUERY_TYPES; type++) {
+        struct latencySummary sum = latencySummarize(st->api_latency[type]);
+        const char *name = apiQueryTypeName(type);
+        p = safe_snprintf(p, end, "readsb_api_latency_%s_count %llu\n", name, (unsigned long long) sum.count);
+        p = safe_snprintf(p, end, "readsb_api_latency_%s_p50 %.3f\n", name, sum.p50);
+        p = safe_snprintf(p, end, "readsb_api_latency_%s_p90 %.3f\n", name, sum.p90);
+        p = safe_snprintf(p, end, "readsb_api_latency_%s_p99 %.3f\n", name, sum.p99);
+        p = safe_snprintf(p, end, "readsb_api_latency_%s_max %.3f\n", name, sum.max);
+    }
     p = safe_snprintf(p, end, "readsb_tracewrites_recent %u\n", st->recentTraceWrites);
     p = safe_snprintf(p, end, "readsb_tracewrites_full %u\n", st->fullTraceWrites);
     p = safe_snprintf(p, end, "readsb_tracewrites_perm %u\n", st->permTraceWrites);
@@ -93,6 +93,9 @@ struct stats
   struct timespec api_worker_cpu;
   struct timespec api_update_cpu;
   uint64_t api_request_count;
+  uint64_t api_cache_hits;
+  uint64_t api_cache_misses;
+  uint32_t api_latency[API_QUERY_TYPES][API_LATENCY_BUCKETS]; // request processing time by query type
   // remote messages:
   uint32_t remote_received_modeac;
   uint32_t remote_received_modes;
@@ -179,6 +182,10 @@ struct distCoords {
 } __attribute__ ((__packed__));
 
 void add_stats (const struct stats *st1, const struct stats *st2, struct stats *target);
+
+// threads accounting into a private copy of the stats (merged later) point this at their copy
+extern _Thread_local struct stats *stats_local;
+#define STATS_CURRENT (stats_local ? stats_local : &Modes.stats_current)
 void display_stats (struct stats *st);
 void reset_stats (struct stats *st);
 
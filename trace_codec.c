@@ -0,0 +1,410 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// trace_codec.c: columnar encoding of trace points
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "readsb.h"
+
+#define FLAG_BITS (16)
+
+// bytes of struct state after geom_rate (ias / roll / addrtype, receiverId with TRACKS_UUID)
+#define TAIL_OFFSET (offsetof(struct state, geom_rate) + sizeof(int16_t))
+#define TAIL_BYTES (sizeof(struct state) - TAIL_OFFSET)
+
+struct header {
+    uint64_t magic;
+    uint32_t points;
+} __attribute__ ((__packed__));
+
+// all columns are stored as byte planes: byte 0 of every value, then byte 1 of every value ...
+// small deltas leave the upper planes zero which zstd compresses to almost nothing,
+// while decoding stays free of data dependent branches (unlike varints)
+
+static inline int64_t signExtend(uint64_t v, int bits) {
+    return (int64_t) (v << (64 - bits)) >> (64 - bits);
+}
+
+static inline uint64_t zigzag(int64_t v) {
+    return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+    return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+static inline void putPlanes(unsigned char *p, int points, int i, uint64_t value, int bytes) {
+    for (int b = 0; b < bytes; b++) {
+        p[b * points + i] = value >> (8 * b);
+    }
+}
+
+// bytes is a constant after inlining, spelled out as the loop isn't unrolled at -O2
+static inline uint64_t getPlanes(const unsigned char *p, int points, int i, int bytes) {
+    p += i;
+    uint64_t value = p[0] | (uint64_t) p[points] << 8;
+    if (bytes >= 4) {
+        value |= (uint64_t) p[2 * points] << 16 | (uint64_t) p[3 * points] << 24;
+    }
+    if (bytes >= 6) {
+        value |= (uint64_t) p[4 * points] << 32 | (uint64_t) p[5 * points] << 40;
+    }
+    return value;
+}
+
+static inline uint32_t getFlags(const struct state *s) {
+    return s->on_ground
+        | s->stale << 1
+        | s->leg_marker << 2
+        | s->gs_valid << 3
+        | s->track_valid << 4
+        | s->baro_alt_valid << 5
+        | s->baro_rate_valid << 6
+        | s->geom_alt_valid << 7
+        | s->geom_rate_valid << 8
+        | s->roll_valid << 9
+        | s->ias_valid << 10
+        | s->padding << 11;
+}
+
+static inline void setFlags(struct state *s, uint32_t flags) {
+    s->on_ground = flags;
+    s->stale = flags >> 1;
+    s->leg_marker = flags >> 2;
+    s->gs_valid = flags >> 3;
+    s->track_valid = flags >> 4;
+    s->baro_alt_valid = flags >> 5;
+    s->baro_rate_valid = flags >> 6;
+    s->geom_alt_valid = flags >> 7;
+    s->geom_rate_valid = flags >> 8;
+    s->roll_valid = flags >> 9;
+    s->ias_valid = flags >> 10;
+    s->padding = flags >> 11;
+}
+
+// timestamp in the low 48 bits and the flags in getFlags order in the high 16 bits of the
+// first 64 bits of struct state (gcc / clang on little endian)
+// the whole word can then be read / written at once instead of 13 bitfields,
+// this is constant folded by the compiler
+static inline int wordLayout() {
+    struct state s;
+    uint64_t ts, onGround, padding;
+    memset(&s, 0, sizeof(s));
+    s.timestamp = -1;
+    memcpy(&ts, &s, sizeof(ts));
+    memset(&s, 0, sizeof(s));
+    s.on_ground = 1;
+    memcpy(&onGround, &s, sizeof(onGround));
+    memset(&s, 0, sizeof(s));
+    s.padding = 31;
+    memcpy(&padding, &s, sizeof(padding));
+    return ts == 0x0000ffffffffffffULL && onGround == 1ULL << 48 && padding == 31ULL << 59;
+}
+
+static inline void getTimestampFlags(const struct state *s, int64_t *ts, uint32_t *flags) {
+    if (wordLayout()) {
+        uint64_t word;
+        memcpy(&word, s, sizeof(word));
+        *ts = signExtend(word, 48);
+        *flags = word >> 48;
+    } else {
+        *ts = s->timestamp;
+        *flags = getFlags(s);
+    }
+}
+
+static inline void setTimestampFlags(struct state *s, int64_t ts, uint32_t flags) {
+    if (wordLayout()) {
+        uint64_t word = ((uint64_t) ts & 0x0000ffffffffffffULL) | (uint64_t) flags << 48;
+        memcpy(s, &word, sizeof(word));
+    } else {
+        s->timestamp = ts;
+        setFlags(s, flags);
+    }
+}
+
+// fields encoded as zigzag deltas to the previous point (field, bytes)
+// the deltas wrap around at the field width, decoding is exact for any value
+#define DELTA_FIELDS(F) \
+    F(lat, 4) \
+    F(lon, 4) \
+    F(baro_alt, 2) \
+    F(geom_alt, 2) \
+    F(gs, 2) \
+    F(track, 2) \
+    F(baro_rate, 2) \
+    F(geom_rate, 2)
+
+#define TS_BYTES (6)
+
+size_t traceCodecBound(int points) {
+    size_t perPoint = TS_BYTES;
+#define F(field, bytes) perPoint += bytes;
+    DELTA_FIELDS(F)
+#undef F
+    return sizeof(struct header)
+        + (size_t) points * perPoint
+        + FLAG_BITS * ((points + 7) / 8)
+        + (size_t) points * TAIL_BYTES
+        + (size_t) getFourStates(points) * sizeof(struct state_all);
+}
+
+size_t traceEncode(const fourState *src, int points, unsigned char *dst, size_t dstCapacity) {
+    if (points < 0 || points % SFOUR != 0 || dstCapacity < traceCodecBound(points)) {
+        return 0;
+    }
+    fourState *source = (fourState *) src;
+    unsigned char *p = dst;
+
+    struct header header = { .magic = TRACE_CODEC_MAGIC, .points = points };
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+
+    unsigned char *tsCol = p;
+    p += TS_BYTES * points;
+#define F(field, bytes) unsigned char *field##Col = p; p += bytes * points;
+    DELTA_FIELDS(F)
+#undef F
+    unsigned char *flagCol = p;
+    int planeBytes = (points + 7) / 8;
+    p += FLAG_BITS * planeBytes;
+    unsigned char *tailCol = p;
+    p += TAIL_BYTES * points;
+
+    // timestamps: delta of delta, the first point is stored as is
+    int64_t prevTs = 0;
+    int64_t prevDelta = 0;
+#define F(field, bytes) int64_t field = 0;
+    DELTA_FIELDS(F)
+#undef F
+    uint32_t flags[8] = { 0 };
+    for (int i = 0; i < points; i++) {
+        const struct state *s = getState(source, i);
+
+        int64_t ts;
+        getTimestampFlags(s, &ts, &flags[i % 8]);
+        int64_t delta = signExtend(ts - prevTs, 8 * TS_BYTES);
+        putPlanes(tsCol, points, i, zigzag(signExtend(delta - prevDelta, 8 * TS_BYTES)), TS_BYTES);
+        prevDelta = (i == 0) ? 0 : delta;
+        prevTs = ts;
+
+#define F(field, bytes) \
+        putPlanes(field##Col, points, i, zigzag(signExtend(s->field - field, 8 * bytes)), bytes); \
+        field = s->field;
+        DELTA_FIELDS(F)
+#undef F
+
+        if (i % 8 == 7 || i == points - 1) {
+            for (int bit = 0; bit < FLAG_BITS; bit++) {
+                uint32_t plane = 0;
+                for (int k = 0; k <= i % 8; k++) {
+                    plane |= ((flags[k] >> bit) & 1) << k;
+                }
+                flagCol[bit * planeBytes + i / 8] = plane;
+            }
+        }
+
+        for (size_t k = 0; k < TAIL_BYTES; k++) {
+            tailCol[k * points + i] = ((const unsigned char *) s)[TAIL_OFFSET + k];
+        }
+    }
+
+    int fours = getFourStates(points);
+    for (int j = 0; j < fours; j++) {
+        const unsigned char *all = (const unsigned char *) &src[j].zeroAll;
+        for (size_t k = 0; k < sizeof(struct state_all); k++) {
+            p[k * fours + j] = all[k];
+        }
+    }
+    p += fours * sizeof(struct state_all);
+
+    return p - dst;
+}
+
+// bit k of a byte to byte k of a word, for the flag bit planes
+#define SPREAD(x) (((x) & 1ULL) | ((x) >> 1 & 1ULL) << 8 | ((x) >> 2 & 1ULL) << 16 | ((x) >> 3 & 1ULL) << 24 \
+        | ((x) >> 4 & 1ULL) << 32 | ((x) >> 5 & 1ULL) << 40 | ((x) >> 6 & 1ULL) << 48 | ((x) >> 7 & 1ULL) << 56)
+#define SPREAD4(x) SPREAD(x), SPREAD(x + 1), SPREAD(x + 2), SPREAD(x + 3)
+#define SPREAD16(x) SPREAD4(x), SPREAD4(x + 4), SPREAD4(x + 8), SPREAD4(x + 12)
+#define SPREAD64(x) SPREAD16(x), SPREAD16(x + 16), SPREAD16(x + 32), SPREAD16(x + 48)
+static const uint64_t spreadBits[256] = { SPREAD64(0), SPREAD64(64), SPREAD64(128), SPREAD64(192) };
+
+// points are decoded in blocks, one column at a time
+#define DECODE_BLOCK (64)
+
+// values of n consecutive points from their byte planes
+// n and bytes are constants after inlining so the loops are vectorized
+static inline __attribute__((always_inline)) void getPlaneBlock(const unsigned char *p, int points, int n, int bytes, uint64_t *v) {
+    for (int k = 0; k < n; k++) {
+        v[k] = p[k];
+    }
+    for (int b = 1; b < bytes; b++) {
+        const unsigned char *plane = p + b * points;
+        for (int k = 0; k < n; k++) {
+            v[k] |= (uint64_t) plane[k] << (8 * b);
+        }
+    }
+}
+
+// same for values of up to 4 bytes, twice as many fit in a vector
+static inline __attribute__((always_inline)) void getPlaneBlock32(const unsigned char *p, int points, int n, int bytes, uint32_t *v) {
+    for (int k = 0; k < n; k++) {
+        v[k] = p[k];
+    }
+    for (int b = 1; b < bytes; b++) {
+        const unsigned char *plane = p + b * points;
+        for (int k = 0; k < n; k++) {
+            v[k] |= (uint32_t) plane[k] << (8 * b);
+        }
+    }
+}
+
+// zigzag deltas of n consecutive points, undone here so it's vectorized as well
+static inline __attribute__((always_inline)) void getDeltaBlock(const unsigned char *p, int points, int n, int bytes, uint64_t *v) {
+    getPlaneBlock(p, points, n, bytes, v);
+    for (int k = 0; k < n; k++) {
+        v[k] = (v[k] >> 1) ^ -(v[k] & 1);
+    }
+}
+
+static inline __attribute__((always_inline)) void getDeltaBlock32(const unsigned char *p, int points, int n, int bytes, uint32_t *v) {
+    getPlaneBlock32(p, points, n, bytes, v);
+    for (int k = 0; k < n; k++) {
+        v[k] = (v[k] >> 1) ^ -(v[k] & 1);
+    }
+}
+
+struct decodeState {
+    uint64_t prevTs;
+    uint64_t prevDelta;
+#define F(field, bytes) uint32_t field;
+    DELTA_FIELDS(F)
+#undef F
+};
+
+static inline __attribute__((always_inline)) void decodeBlock(const unsigned char *src, int points, int base, int n, fourState *dst, struct decodeState *ds) {
+    const unsigned char *p = src + sizeof(struct header);
+    struct state *st[DECODE_BLOCK];
+    uint64_t v[DECODE_BLOCK];
+    uint32_t flags[DECODE_BLOCK];
+
+    for (int k = 0; k < n; k++) {
+        st[k] = getState(dst, base + k);
+    }
+
+    getDeltaBlock(p + base, points, n, TS_BYTES, v);
+    p += TS_BYTES * points;
+#define F(field, bytes) const unsigned char *field##Col = p; p += bytes * points;
+    DELTA_FIELDS(F)
+#undef F
+    const unsigned char *flagCol = p;
+    int planeBytes = (points + 7) / 8;
+    p += FLAG_BITS * planeBytes;
+    const unsigned char *tailCol = p;
+
+    // flags of 8 points at a time from the bit planes
+    for (int k = 0; k < n; k += 8) {
+        uint64_t lo = 0;
+        uint64_t hi = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            lo |= spreadBits[flagCol[bit * planeBytes + (base + k) / 8]] << bit;
+            hi |= spreadBits[flagCol[(bit + 8) * planeBytes + (base + k) / 8]] << bit;
+        }
+        for (int m = 0; m < 8; m++) {
+            flags[k + m] = (lo >> (8 * m) & 0xff) | (hi >> (8 * m) & 0xff) << 8;
+        }
+    }
+
+    // the running values are kept in locals, they would be reloaded after every store to the states otherwise
+    // they wrap around, only the bits of the field width are stored
+    uint64_t prevTs = ds->prevTs;
+    uint64_t prevDelta = ds->prevDelta;
+    for (int k = 0; k < n; k++) {
+        uint64_t delta = prevDelta + v[k];
+        uint64_t ts = prevTs + delta;
+        setTimestampFlags(st[k], signExtend(ts, 8 * TS_BYTES), flags[k]);
+        prevDelta = (base + k == 0) ? 0 : delta;
+        prevTs = ts;
+    }
+    ds->prevTs = prevTs;
+    ds->prevDelta = prevDelta;
+
+    // all fields in one loop, their prefix sums are independent
+#define F(field, bytes) \
+    uint32_t field##V[DECODE_BLOCK]; \
+    getDeltaBlock32(field##Col + base, points, n, bytes, field##V); \
+    uint32_t field = ds->field;
+    DELTA_FIELDS(F)
+#undef F
+    for (int k = 0; k < n; k++) {
+#define F(field, bytes) \
+        field += field##V[k]; \
+        st[k]->field = signExtend(field, 8 * bytes);
+        DELTA_FIELDS(F)
+#undef F
+    }
+#define F(field, bytes) ds->field = field;
+    DELTA_FIELDS(F)
+#undef F
+
+    for (size_t off = 0; off < TAIL_BYTES; off += 8) {
+        int bytes = imin(8, TAIL_BYTES - off);
+        getPlaneBlock(tailCol + off * points + base, points, n, bytes, v);
+        for (int k = 0; k < n; k++) {
+            if (wordLayout()) {
+                memcpy((unsigned char *) st[k] + TAIL_OFFSET + off, &v[k], bytes);
+            } else {
+                for (int b = 0; b < bytes; b++) {
+                    ((unsigned char *) st[k])[TAIL_OFFSET + off + b] = v[k] >> (8 * b);
+                }
+            }
+        }
+    }
+}
+
+int traceDecode(const unsigned char *src, size_t len, fourState *dst, int maxPoints) {
+    struct header header;
+    if (len < sizeof(header)) {
+        return -1;
+    }
+    memcpy(&header, src, sizeof(header));
+
+    int points = header.points;
+    if (header.magic != TRACE_CODEC_MAGIC || points < 0 || points % SFOUR != 0 || points > maxPoints
+            || len != traceCodecBound(points)) {
+        return -1;
+    }
+
+    struct decodeState ds;
+    memset(&ds, 0, sizeof(ds));
+    int base = 0;
+    for (; base + DECODE_BLOCK <= points; base += DECODE_BLOCK) {
+        decodeBlock(src, points, base, DECODE_BLOCK, dst, &ds);
+    }
+    if (base < points) {
+        decodeBlock(src, points, base, points - base, dst, &ds);
+    }
+
+    int fours = getFourStates(points);
+    const unsigned char *p = src + len - fours * sizeof(struct state_all);
+    for (size_t k = 0; k < sizeof(struct state_all); k++) {
+        const unsigned char *column = p + k * fours;
+        unsigned char *all = (unsigned char *) dst + offsetof(fourState, zeroAll) + k;
+        for (int j = 0; j < fours; j++) {
+            all[j * sizeof(fourState)] = column[j];
+        }
+    }
+
+    return points;
+}
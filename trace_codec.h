@@ -0,0 +1,39 @@
+#ifndef TRACE_CODEC_H
+#define TRACE_CODEC_H
+
+// columnar encoding of trace points, applied before zstd when compressing trace chunks
+//
+// the points are split into columns:
+// timestamps as zigzag delta of delta
+// lat / lon / altitudes / gs / track / rates as zigzag deltas
+// the flag bits as bit planes, the remaining bytes of struct state and struct state_all as is
+// every column is byte transposed (byte n of every point next to each other)
+//
+// the encoded size is about the same as the raw states, the point is that zstd compresses it
+// a lot better
+//
+// decoding restores the points bit for bit
+
+// first 8 bytes of an encoded buffer, can't be the start of a struct state (negative timestamp)
+#define TRACE_CODEC_MAGIC (0xc01cfffffffffffeULL)
+
+// encoded size for points, at most stateBytes(points) + 20
+size_t traceCodecBound(int points);
+
+// points must be a multiple of SFOUR
+// returns the encoded size, 0 if dstCapacity is less than traceCodecBound(points)
+size_t traceEncode(const fourState *src, int points, unsigned char *dst, size_t dstCapacity);
+
+// returns the number of points decoded to dst, -1 on corrupt input or more than maxPoints
+int traceDecode(const unsigned char *src, size_t len, fourState *dst, int maxPoints);
+
+static inline int traceCodecEncoded(const void *src, size_t len) {
+    uint64_t magic;
+    if (len < sizeof(magic)) {
+        return 0;
+    }
+    memcpy(&magic, src, sizeof(magic));
+    return magic == TRACE_CODEC_MAGIC;
+}
+
+#endif
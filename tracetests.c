@@ -0,0 +1,176 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// tracetests.c - round trip tests for the columnar trace codec
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "readsb.h"
+
+#define TEST_POINTS (1024)
+
+static uint64_t rng = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t rnd() {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+// a plausible trace: small steps in position / altitude / time
+static void fillTrace(fourState *trace, int points) {
+    int64_t ts = 1700000000000LL;
+    int32_t lat = 51000000, lon = 700000;
+    int alt = 35000;
+    for (int i = 0; i < points; i++) {
+        struct state *s = getState(trace, i);
+        memset(s, 0, sizeof(*s));
+        ts += 500 + rnd() % 20000;
+        lat += (int32_t) (rnd() % 2001) - 1000;
+        lon += (int32_t) (rnd() % 2001) - 1000;
+        alt += (int) (rnd() % 201) - 100;
+        s->timestamp = ts;
+        s->lat = lat;
+        s->lon = lon;
+        s->baro_alt = alt * _alt_factor;
+        s->geom_alt = (alt + 125) * _alt_factor;
+        s->gs = 4500 + rnd() % 50;
+        s->track = 9000 + rnd() % 100;
+        s->baro_rate = (int) (rnd() % 1024) - 512;
+        s->geom_rate = s->baro_rate;
+        s->gs_valid = s->track_valid = s->baro_alt_valid = s->geom_alt_valid = 1;
+        s->stale = (rnd() % 16 == 0);
+        s->leg_marker = (i == points / 2);
+        s->ias = 250;
+        s->roll = -300;
+        s->addrtype = ADDR_ADSB_ICAO;
+        struct state_all *all = getStateAll(trace, i);
+        if (all) {
+            memset(all, 0, sizeof(*all));
+            memcpy(all->callsign, "DLH4AB  ", 8);
+            all->squawk = 0x7700;
+            all->callsign_valid = all->squawk_valid = 1;
+        }
+    }
+}
+
+// random flags including the padding bits, random bytes after geom_rate and in state_all, extreme values
+static void fillRandom(fourState *trace, int points) {
+    fillTrace(trace, points);
+    for (int i = 0; i < points; i++) {
+        struct state *s = getState(trace, i);
+        s->on_ground = rnd();
+        s->stale = rnd();
+        s->leg_marker = rnd();
+        s->gs_valid = rnd();
+        s->track_valid = rnd();
+        s->baro_alt_valid = rnd();
+        s->baro_rate_valid = rnd();
+        s->geom_alt_valid = rnd();
+        s->geom_rate_valid = rnd();
+        s->roll_valid = rnd();
+        s->ias_valid = rnd();
+        s->padding = rnd();
+        unsigned char *p = (unsigned char *) s;
+        for (size_t k = offsetof(struct state, geom_rate) + sizeof(int16_t); k < sizeof(struct state); k++) {
+            p[k] = rnd();
+        }
+        struct state_all *all = getStateAll(trace, i);
+        if (all) {
+            p = (unsigned char *) all;
+            for (size_t k = 0; k < sizeof(struct state_all); k++) {
+                p[k] = rnd();
+            }
+        }
+    }
+    getState(trace, 0)->lat = INT32_MIN;
+    getState(trace, 1)->lat = INT32_MAX;
+    getState(trace, 2)->timestamp = -((int64_t) 1 << 47);
+    getState(trace, 3)->timestamp = ((int64_t) 1 << 47) - 1;
+}
+
+static int roundTrip(const char *what, fourState *trace, int points) {
+    size_t bound = traceCodecBound(points);
+    unsigned char *encoded = malloc(bound);
+    fourState *decoded = malloc(stateBytes(points));
+    int ok = 1;
+
+    size_t len = traceEncode(trace, points, encoded, bound);
+    if (len == 0) {
+        fprintf(stderr, "%s: %d points: not encoded\n", what, points);
+        ok = 0;
+    }
+    if (len) {
+        memset(decoded, 0x55, stateBytes(points));
+        int res = traceDecode(encoded, len, decoded, points);
+        if (res != points || memcmp(decoded, trace, stateBytes(points)) != 0) {
+            fprintf(stderr, "%s: %d points: round trip failed (decoded %d)\n", what, points, res);
+            ok = 0;
+        }
+        if (traceDecode(encoded, len, decoded, points - SFOUR) != -1) {
+            fprintf(stderr, "%s: %d points: decoded more than maxPoints\n", what, points);
+            ok = 0;
+        }
+        // truncated input must be rejected
+        for (size_t cut = 0; cut < len; cut += 1 + len / 97) {
+            if (traceDecode(encoded, cut, decoded, points) != -1) {
+                fprintf(stderr, "%s: %d points: accepted input truncated to %zu of %zu bytes\n", what, points, cut, len);
+                ok = 0;
+                break;
+            }
+        }
+        // corrupt input may decode to garbage but must not crash (run with -fsanitize=address)
+        for (int k = 0; k < 64; k++) {
+            size_t pos = sizeof(uint64_t) + sizeof(uint32_t) + rnd() % (len - sizeof(uint64_t) - sizeof(uint32_t));
+            encoded[pos] ^= 1 << (rnd() % 8);
+            traceDecode(encoded, len, decoded, points);
+        }
+    }
+
+    free(encoded);
+    free(decoded);
+    return ok;
+}
+
+static int testTraceCodec() {
+    int ok = 1;
+    fourState *trace = malloc(stateBytes(TEST_POINTS));
+
+    int sizes[] = { SFOUR, 2 * SFOUR, 100, 256, TEST_POINTS };
+    for (unsigned k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        fillTrace(trace, sizes[k]);
+        ok = roundTrip("trace", trace, sizes[k]) && ok;
+    }
+    for (unsigned k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        fillRandom(trace, sizes[k]);
+        ok = roundTrip("random", trace, sizes[k]) && ok;
+    }
+
+    // not a multiple of SFOUR
+    unsigned char *encoded = malloc(traceCodecBound(8));
+    if (traceEncode(trace, 6, encoded, traceCodecBound(8)) != 0) {
+        fprintf(stderr, "encoded 6 points\n");
+        ok = 0;
+    }
+    free(encoded);
+
+    free(trace);
+    return ok;
+}
+
+int main(int __attribute__ ((unused)) argc, char __attribute__ ((unused)) **argv) {
+    int ok = 1;
+    ok = testTraceCodec() && ok;
+    return ok ? 0 : 1;
+}
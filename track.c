@@ -60,6 +60,17 @@ uint32_t modeAC_age[4096];
 
 #define PPforward if (0) {fprintf(stderr, "%s %d\n", __FILE__, __LINE__);}
 
+// state not belonging to a single aircraft (receivers, range outline, geomag)
+// needs to be locked while the tracking shards are running
+static inline void sharedLock() {
+    if (Modes.trackShardsRunning)
+        pthread_mutex_lock(&Modes.trackSharedMutex);
+}
+static inline void sharedUnlock() {
+    if (Modes.trackShardsRunning)
+        pthread_mutex_unlock(&Modes.trackSharedMutex);
+}
+
 static void showPositionDebug(struct aircraft *a, struct modesMessage *mm, int64_t now, double bad_lat, double bad_lon);
 static void position_bad(struct modesMessage *mm, struct aircraft *a);
 static void calc_wind(struct aircraft *a, int64_t now);
@@ -249,7 +260,7 @@ static int compare_validity(const data_validity *lhs, const data_validity *rhs)
         return 0;
 }
 
-static void update_range_histogram(struct aircraft *a, int64_t now) {
+static void update_range_histogram_locked(struct aircraft *a, int64_t now) {
 
     double lat = a->lat;
     double lon = a->lon;
@@ -294,10 +305,10 @@ static void update_range_histogram(struct aircraft *a, int64_t now) {
         }
     }
 
-    if (range > Modes.stats_current.distance_max)
-        Modes.stats_current.distance_max = range;
-    if (range < Modes.stats_current.distance_min)
-        Modes.stats_current.distance_min = range;
+    if (range > STATS_CURRENT->distance_max)
+        STATS_CURRENT->distance_max = range;
+    if (range < STATS_CURRENT->distance_min)
+        STATS_CURRENT->distance_min = range;
 
     int bucket = round(range / Modes.maxRange * RANGE_BUCKET_COUNT);
 
@@ -306,7 +317,13 @@ static void update_range_histogram(struct aircraft *a, int64_t now) {
     else if (bucket >= RANGE_BUCKET_COUNT)
         bucket = RANGE_BUCKET_COUNT - 1;
 
-    ++Modes.stats_current.range_histogram[bucket];
+    ++STATS_CURRENT->range_histogram[bucket];
+}
+
+static void update_range_histogram(struct aircraft *a, int64_t now) {
+    sharedLock();
+    update_range_histogram_locked(a, now);
+    sharedUnlock();
 }
 
 static int cpr_duplicate_check(int64_t now, struct aircraft *a, struct modesMessage *mm) {
@@ -434,7 +451,9 @@ static int speed_check(struct aircraft *a, datasource_t source, double lat, doub
         mm->pos_ignore = 1;
         // but count it as a received position towards receiver heuristics
         if (!Modes.userLocationValid) {
+            sharedLock();
             receiverPositionReceived(a, mm, lat, lon, now);
+            sharedUnlock();
         }
         if (elapsed > 200 && a->receiverId == mm->receiverId && (Modes.debug_cpr || Modes.debug_speed_check || a->addr == Modes.cpr_focus)) {
             // let speed_check continue for displaying this duplicate (at least for non-aggregated receivers)
@@ -626,10 +645,12 @@ static int speed_check(struct aircraft *a, datasource_t source, double lat, doub
     }
 
     if (!Modes.userLocationValid && (inrange || override)) {
+        sharedLock();
         if (receiverPositionReceived(a, mm, lat, lon, now) == RECEIVER_RANGE_BAD) {
             // far outside receiver area
             receiverRangeExceeded = 1;
         }
+        sharedUnlock();
     }
 
     if (!Modes.userLocationValid && !override && mm->source == SOURCE_ADSB) {
@@ -639,6 +660,7 @@ static int speed_check(struct aircraft *a, datasource_t source, double lat, doub
                 && a->pos_reliable_even >= Modes.position_persistence * 3 / 4
                 && a->trackUnreliable < 3
            ) {
+            sharedLock();
             struct receiver *r = receiverBad(mm->receiverId, a->addr, now);
             if (r && Modes.debug_garbage && r->badCounter > 6) {
                 fprintf(stderr, "hex: %06x id: %016"PRIx64" #good: %6d #bad: %3.0f trackDiff: %3.0f: %7.2fkm/%7.2fkm in %4.1f s, max %4.0f kt\n",
@@ -651,6 +673,7 @@ static int speed_check(struct aircraft *a, datasource_t source, double lat, doub
                        );
 
             }
+            sharedUnlock();
         }
 
     }
@@ -747,7 +770,7 @@ static int doGlobalCPR(struct aircraft *a, struct modesMessage *mm, double *lat,
     int result;
     int fflag = mm->cpr_odd;
     int surface = (mm->cpr_type == CPR_SURFACE);
-    struct receiver *receiver;
+    struct receiver *receiver = NULL;
     double reflat, reflon;
 
     // derive NIC, Rc from the worse of the two position
@@ -760,11 +783,16 @@ static int doGlobalCPR(struct aircraft *a, struct modesMessage *mm, double *lat,
         // find reference location
 
         int ref = 0;
+        if (!Modes.userLocationValid) {
+            sharedLock();
+            receiver = receiverGetReference(mm->receiverId, &reflat, &reflon, a, 0);
+            sharedUnlock();
+        }
         if (Modes.userLocationValid) {
             reflat = Modes.fUserLat;
             reflon = Modes.fUserLon;
             ref = 1;
-        } else if ((receiver = receiverGetReference(mm->receiverId, &reflat, &reflon, a, 0))) {
+        } else if (receiver) {
             //function sets reflat and reflon on success, nothing to do here.
             ref = 2;
         } else if (a->seen_pos && a->surfaceCPR_allow_ac_rel) {
@@ -821,7 +849,7 @@ static int doGlobalCPR(struct aircraft *a, struct modesMessage *mm, double *lat,
             }
 
             if (mm->source != SOURCE_MLAT) {
-                Modes.stats_current.cpr_global_range_checks++;
+                STATS_CURRENT->cpr_global_range_checks++;
                 if (Modes.debug_maxRange) {
                     showPositionDebug(a, mm, mm->sysTimestamp, *lat, *lon);
                 }
@@ -833,7 +861,7 @@ static int doGlobalCPR(struct aircraft *a, struct modesMessage *mm, double *lat,
     // check speed limit
     if (!speed_check(a, mm->source, *lat, *lon, mm, CPR_GLOBAL)) {
         if (mm->source != SOURCE_MLAT)
-            Modes.stats_current.cpr_global_speed_checks++;
+            STATS_CURRENT->cpr_global_speed_checks++;
         return -2;
     }
 
@@ -921,7 +949,7 @@ static int doLocalCPR(struct aircraft *a, struct modesMessage *mm, double *lat,
         double range = greatcircle(reflat, reflon, *lat, *lon, 0);
         if (range > range_limit) {
             if (mm->source != SOURCE_MLAT)
-                Modes.stats_current.cpr_local_range_checks++;
+                STATS_CURRENT->cpr_local_range_checks++;
             return (-1);
         }
     }
@@ -938,7 +966,7 @@ static int doLocalCPR(struct aircraft *a, struct modesMessage *mm, double *lat,
             }
 
             if (mm->source != SOURCE_MLAT) {
-                Modes.stats_current.cpr_local_range_checks++;
+                STATS_CURRENT->cpr_local_range_checks++;
                 if (Modes.debug_maxRange) {
                     showPositionDebug(a, mm, mm->sysTimestamp, *lat, *lon);
                 }
@@ -951,7 +979,7 @@ static int doLocalCPR(struct aircraft *a, struct modesMessage *mm, double *lat,
     // check speed limit
     if (!speed_check(a, mm->source, *lat, *lon, mm, CPR_LOCAL)) {
         if (mm->source != SOURCE_MLAT)
-            Modes.stats_current.cpr_local_speed_checks++;
+            STATS_CURRENT->cpr_local_speed_checks++;
         return -2;
     }
 
@@ -996,12 +1024,12 @@ static void setPosition(struct aircraft *a, struct modesMessage *mm, int64_t now
         return;
     }
 
-    Modes.stats_current.pos_by_type[mm->addrtype]++;
-    Modes.stats_current.pos_all++;
+    STATS_CURRENT->pos_by_type[mm->addrtype]++;
+    STATS_CURRENT->pos_all++;
 
     // mm->pos_bad should never arrive here, handle it just in case
     if (mm->cpr_valid && (mm->garbage || mm->pos_bad)) {
-        Modes.stats_current.pos_garbage++;
+        STATS_CURRENT->pos_garbage++;
         return;
     }
 
@@ -1033,7 +1061,7 @@ static void setPosition(struct aircraft *a, struct modesMessage *mm, int64_t now
 #endif
 
     if (mm->duplicate) {
-        Modes.stats_current.pos_duplicate++;
+        STATS_CURRENT->pos_duplicate++;
         return;
     }
 
@@ -1260,7 +1288,7 @@ static void updatePosition(struct aircraft *a, struct modesMessage *mm, int64_t
 
     if (surface) {
         if (mm->source != SOURCE_MLAT)
-            Modes.stats_current.cpr_surface++;
+            STATS_CURRENT->cpr_surface++;
 
         // Surface: 25 seconds if >25kt or speed unknown, 50 seconds otherwise
         if (mm->gs_valid && mm->gs.selected <= 25)
@@ -1269,7 +1297,7 @@ static void updatePosition(struct aircraft *a, struct modesMessage *mm, int64_t
             max_elapsed = 25000;
     } else {
         if (mm->source != SOURCE_MLAT)
-            Modes.stats_current.cpr_airborne++;
+            STATS_CURRENT->cpr_airborne++;
 
         // Airborne: determine depending on speed, fallback 10 seconds
         max_elapsed = cpr_global_airborne_max_elapsed(now, a);
@@ -1290,7 +1318,7 @@ static void updatePosition(struct aircraft *a, struct modesMessage *mm, int64_t
             // Global CPR failed because the position produced implausible results.
             // This is bad data.
             if (mm->source != SOURCE_MLAT)
-                Modes.stats_current.cpr_global_bad++;
+                STATS_CURRENT->cpr_global_bad++;
 
             mm->pos_bad = 1;
 
@@ -1306,16 +1334,16 @@ static void updatePosition(struct aircraft *a, struct modesMessage *mm, int64_t
             // No local reference for surface position available, or the two messages crossed a zone.
             // Nonfatal, try again later.
             if (mm->source != SOURCE_MLAT)
-                Modes.stats_current.cpr_global_skipped++;
+                STATS_CURRENT->cpr_global_skipped++;
         } else {
             if (accept_data(&a->position_valid, mm->source, mm, a, REDUCE_OFTEN)) {
                 if (mm->source != SOURCE_MLAT)
-                    Modes.stats_current.cpr_global_ok++;
+                    STATS_CURRENT->cpr_global_ok++;
 
                 globalCPR = 1;
             } else {
                 if (mm->source != SOURCE_MLAT)
-                    Modes.stats_current.cpr_global_skipped++;
+                    STATS_CURRENT->cpr_global_skipped++;
                 location_result = -2;
             }
         }
@@ -1339,20 +1367,20 @@ static void updatePosition(struct aircraft *a, struct modesMessage *mm, int64_t
             mm->decoded_lon = new_lon;
         } else if (location_result >= 0 && accept_data(&a->position_valid, mm->source, mm, a, REDUCE_OFTEN)) {
             if (mm->source != SOURCE_MLAT)
-                Modes.stats_current.cpr_local_ok++;
+                STATS_CURRENT->cpr_local_ok++;
             mm->cpr_relative = 1;
 
             if (location_result == 1) {
                 if (mm->source != SOURCE_MLAT)
-                    Modes.stats_current.cpr_local_aircraft_relative++;
+                    STATS_CURRENT->cpr_local_aircraft_relative++;
             }
             if (location_result == 2) {
                 if (mm->source != SOURCE_MLAT)
-                    Modes.stats_current.cpr_local_receiver_relative++;
+                    STATS_CURRENT->cpr_local_receiver_relative++;
             }
         } else {
             if (mm->source != SOURCE_MLAT)
-                Modes.stats_current.cpr_local_skipped++;
+                STATS_CURRENT->cpr_local_skipped++;
             location_result = -1;
         }
     }
@@ -1855,11 +1883,11 @@ static int accept_cpr(struct aircraft *a, struct modesMessage *mm) {
 // Receive new messages and update tracked aircraft state
 //
 
-struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
-    struct aircraft *res = NULL;
+// accounting not tied to a single aircraft, done serially before the shards run
+static void trackCountMessage(struct modesMessage *mm) {
     int64_t now = mm->sysTimestamp;
 
-    ++Modes.stats_current.messages_total;
+    ++STATS_CURRENT->messages_total;
 
     Modes.messageRateAcc[0]++;
     if (now > Modes.nextMessageRateCalc) {
@@ -1869,6 +1897,27 @@ struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
     if (mm->msgtype == DFTYPE_MODEAC) {
         // Mode A/C, just count it (we ignore SPI)
         modeAC_count[modeAToIndex(mm->squawkHex)]++;
+    }
+}
+
+static void countClientMessage(struct modesMessage *mm) {
+    if (mm->client) {
+        if (!mm->garbage) {
+            mm->client->messageCounter++;
+        }
+        mm->client->recentMessages++;
+    }
+}
+
+struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
+    struct aircraft *res = NULL;
+    int64_t now = mm->sysTimestamp;
+
+    if (!Modes.trackShardsRunning) {
+        trackCountMessage(mm);
+    }
+
+    if (mm->msgtype == DFTYPE_MODEAC) {
         res = NULL;
         goto exit;
     }
@@ -1913,6 +1962,11 @@ struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
         }
     }
 
+    if (a->traceLazyLen) {
+        // --write-state-lazy-traces: trace not restored yet, do it before it's modified
+        traceRestoreLazy(a, now);
+    }
+
     struct aircraft scratch;
     bool haveScratch = false;
     if (mm->cpr_valid || mm->sbs_pos_valid) {
@@ -1965,11 +2019,9 @@ struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
 
     a->messages++;
 
-    if (mm->client) {
-        if (!mm->garbage) {
-            mm->client->messageCounter++;
-        }
-        mm->client->recentMessages++;
+    if (!Modes.trackShardsRunning) {
+        // done after the shards have finished when running sharded
+        countClientMessage(mm);
     }
 
     // update addrtype
@@ -2356,13 +2408,17 @@ struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
                     PPforward;
                 }
                 memcpy(a->acas_ra, bytes, sizeof(a->acas_ra));
+                sharedLock();
                 logACASInfoShort(mm->addr, bytes, a, mm, mm->sysTimestamp);
+                sharedUnlock();
             }
         } else if (bytes && Modes.debug_ACAS
                 && checkAcasRaValid(bytes, mm, 1)
                 && (getbit(bytes, 9) || getbit(bytes, 27) || getbit(bytes, 28))) {
             // getbit checks for ARA/RAT/MTE, at least one must be set
+            sharedLock();
             logACASInfoShort(mm->addr, bytes, a, mm, mm->sysTimestamp);
+            sharedUnlock();
         }
     }
 
@@ -2544,7 +2600,9 @@ struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
     if (mm->msgtype == 11 && mm->IID == 0 && mm->correctedbits == 0) {
         double reflat;
         double reflon;
+        sharedLock();
         struct receiver *r = receiverGetReference(mm->receiverId, &reflat, &reflon, a, 1);
+        sharedUnlock();
         if (r) {
             if (now - a->rr_seen < 600 * SECONDS && fabs(a->lon - reflon) < 5 && fabs(a->lon - reflon) < 5) {
                 a->rr_lat = 0.1 * reflat + 0.9 * a->rr_lat;
@@ -2722,6 +2780,125 @@ exit:
     return res;
 }
 
+struct trackShard {
+    struct modesMessage **msgs;
+    int len;
+    int alloc;
+    struct stats stats;
+};
+
+void trackShardsInit() {
+    if (Modes.trackShards < 2)
+        return;
+
+    int n = Modes.trackShards;
+    pthread_mutex_init(&Modes.trackSharedMutex, NULL);
+    Modes.trackShardList = cmalloc(n * sizeof(struct trackShard));
+    memset(Modes.trackShardList, 0x0, n * sizeof(struct trackShard));
+    for (int i = 0; i < n; i++) {
+        struct trackShard *shard = &Modes.trackShardList[i];
+        reset_stats(&shard->stats);
+    }
+    Modes.trackShardTasks = allocate_task_group(n);
+    Modes.trackShardPool = threadpool_create(n, 0);
+}
+
+void trackShardsDestroy() {
+    if (Modes.trackShards < 2)
+        return;
+
+    threadpool_destroy(Modes.trackShardPool);
+    destroy_task_group(Modes.trackShardTasks);
+    for (int i = 0; i < Modes.trackShards; i++) {
+        sfree(Modes.trackShardList[i].msgs);
+    }
+    sfree(Modes.trackShardList);
+    pthread_mutex_destroy(&Modes.trackSharedMutex);
+}
+
+static void trackShardRun(void *arg, threadpool_threadbuffers_t *buffer_group) {
+    MODES_NOTUSED(buffer_group);
+    struct trackShard *shard = arg;
+
+    stats_local = &shard->stats;
+    for (int k = 0; k < shard->len; k++) {
+        trackUpdateFromMessage(shard->msgs[k]);
+    }
+    stats_local = NULL;
+}
+
+static inline int trackSkipMessage(struct modesMessage *mm) {
+    return (Modes.debug_yeet && mm->addr % 0x100 != 0xd);
+}
+
+void trackUpdateMessages(struct modesMessage *msgs, int len) {
+    int nShards = Modes.trackShards;
+
+    // displaying messages must happen in order, don't shard in that case
+    // debug_bogus creates aircraft for arbitrary addresses, also not possible sharded
+    if (nShards < 2 || len < 2 * nShards
+            || !Modes.quiet || Modes.show_only != BADDR || Modes.debug_7700 || Modes.debug_bogus) {
+        for (int k = 0; k < len; k++) {
+            struct modesMessage *mm = &msgs[k];
+            if (trackSkipMessage(mm)) {
+                continue;
+            }
+            trackUpdateFromMessage(mm);
+        }
+        return;
+    }
+
+    struct trackShard *shards = Modes.trackShardList;
+    for (int i = 0; i < nShards; i++) {
+        struct trackShard *shard = &shards[i];
+        shard->len = 0;
+        if (shard->alloc < len) {
+            sfree(shard->msgs);
+            shard->alloc = len;
+            shard->msgs = cmalloc(shard->alloc * sizeof(struct modesMessage *));
+        }
+    }
+
+    // each shard owns the aircraft hash buckets hashing to it,
+    // this way the messages for one aircraft are processed in order by the same thread
+    for (int k = 0; k < len; k++) {
+        struct modesMessage *mm = &msgs[k];
+        if (trackSkipMessage(mm)) {
+            continue;
+        }
+        trackCountMessage(mm);
+        struct trackShard *shard = &shards[addrHash(mm->addr, AIRCRAFT_HASH_BITS) % nShards];
+        shard->msgs[shard->len++] = mm;
+    }
+
+    threadpool_task_t *tasks = Modes.trackShardTasks->tasks;
+    for (int i = 0; i < nShards; i++) {
+        tasks[i].function = trackShardRun;
+        tasks[i].argument = &shards[i];
+    }
+
+    Modes.trackShardsRunning = 1;
+    threadpool_run(Modes.trackShardPool, tasks, nShards);
+    Modes.trackShardsRunning = 0;
+
+    for (int k = 0; k < len; k++) {
+        struct modesMessage *mm = &msgs[k];
+        if (trackSkipMessage(mm) || !mm->aircraft) {
+            continue;
+        }
+        // the aircraft index is shared by all shards, add the aircraft they created now
+        aircraftIndexAdd(mm->aircraft);
+        countClientMessage(mm);
+    }
+
+    // shard stats go to the stats of the thread draining the buffer
+    struct stats *current = STATS_CURRENT;
+    for (int i = 0; i < nShards; i++) {
+        add_stats(&shards[i].stats, current, current);
+        reset_stats(&shards[i].stats);
+    }
+}
+
 //
 // Periodic updates of tracking state
 //
@@ -2940,7 +3117,7 @@ static void activeUpdate(int64_t now) {
             }
         }
     }
-    quickInit();
+    aircraftIndexMaintain();
     pthread_mutex_unlock(&ca->change_mutex);
 }
 
@@ -2955,6 +3132,10 @@ void trackRemoveStale(int64_t now) {
     //fprintf(stderr, "activeUpdate\n");
     activeUpdate(now);
 
+    if (Modes.traceLazyCount > 0) {
+        atomic_store(&Modes.traceLazyBudget, STATE_LAZY_RESTORE_BUDGET);
+    }
+
     int taskCount;
     threadpool_task_t *tasks;
     task_info_t *infos;
@@ -3183,7 +3364,9 @@ static inline int declination(struct aircraft *a, double *dec, int64_t now) {
     double ti;
     double gv;
 
+    sharedLock();
     int res = geomag_calc(a->baro_alt * 0.0003048, a->lat, a->lon, year, dec, &dip, &ti, &gv);
+    sharedUnlock();
     if (res) {
         *dec = 0.0;
     } else {
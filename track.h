@@ -587,6 +587,15 @@ struct aircraft
 
   uint32_t trace_chunk_overall_bytes;
 
+  // --write-state-lazy-traces: trace as saved in the state file, parsed by traceRestoreLazy()
+  // traceLazyLen is 0 once restored, the buffer is then freed by traceMaintenance()
+  char *traceLazy;
+  uint32_t traceLazyLen;
+
+  // --write-state-incremental: what's in the state blob, see save_blob()
+  int64_t stateSavedSeen; // a->seen when last written, 0: not written yet
+  int64_t stateSavedChunkTs; // lastTimestamp of the newest trace chunk written, -1: write all chunks again
+
   int8_t initialTraceWriteDone;
 
 #if defined(PRINT_UUIDS)
@@ -712,6 +721,14 @@ void from_state_all(struct state_all *in, struct state *in2, struct aircraft *a
 struct modesMessage;
 struct aircraft *trackUpdateFromMessage (struct modesMessage *mm);
 
+/* Update aircraft state for a batch of messages.
+ * With --track-shards the messages are split by ICAO address hash and
+ * processed in parallel, messages for the same aircraft stay in order.
+ */
+void trackUpdateMessages(struct modesMessage *msgs, int len);
+void trackShardsInit();
+void trackShardsDestroy();
+
 void trackMatchAC(int64_t now);
 void trackRemoveStale(int64_t now);
 